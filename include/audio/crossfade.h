@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+namespace Audio
+{
+    // Crossfade_Curve enum, how the gains of the two tracks change over a crossfade
+    enum Crossfade_Curve
+    {
+        CROSSFADE_LINEAR,      // gains add up to 1, the middle of the fade is quieter for uncorrelated tracks
+        CROSSFADE_EQUAL_POWER  // cos / sin, the power adds up to 1, so the loudness stays even
+    };
+
+    // get the command line name of a curve
+    std::string crossfade_curve_name(Crossfade_Curve);
+
+    // parse a command line name into a curve, returns false if the name is unknown
+    bool parse_crossfade_curve(const std::string&, Crossfade_Curve&);
+
+    // parse a command line duration in seconds, like 2 or 1.5, returns false if it's bad
+    bool parse_crossfade_duration(const std::string&, double&);
+
+    /* Crossfade class
+     * Description: Crossfades consecutive tracks of interleaved float audio, played through it one after the other.
+     * Audio goes through a delay line before it's written, so when a track ends its last seconds are still in there,
+     * and the start of the next track is mixed into them. That way the end of a track doesn't have to be known in advance,
+     * and the whole crossfade is sample accurate. The delay line starts empty and grows by a quarter of what's pushed,
+     * so playback starts right away, and the decoder only has to run a little faster than real time to fill it again after a fade.
+     * A track shorter than the delay line gets a shorter fade. The time spent mixing is measured.
+     *
+     * How to use:
+     * 1. set() the duration, curve and audio format, 0 seconds turns it off, then push() passes audio straight through
+     * 2. push() the audio of a track, the writer is called with the audio that comes out of the delay line
+     * 3. start_fade() when a track ended by itself, the next track pushed is faded in
+     * 4. clear() when skipping, finish() at the end to write what's left
+     */
+    class Crossfade
+    {
+        public:
+            using Writer = std::function<int(const float*, std::size_t)>;
+
+            Crossfade();
+            Crossfade(const Crossfade&) = delete;
+
+            void set(double, Crossfade_Curve, int, int);
+
+            int push(const float*, std::size_t, const Writer&);
+            void start_fade();
+            int finish(const Writer&);
+            void clear();
+
+            bool enabled() const;
+            std::size_t delayed_frames() const;
+            int fades() const;
+            double mix_seconds() const;
+            double mixed_seconds() const;
+
+        private:
+            // blocks the gain curve is linearly interpolated over, short enough that equal power stays exact to far below a bit of 16 bit audio
+            static const std::size_t MIX_BLOCK_FRAMES{256};
+
+            // the delay line grows by one frame for every this many pushed
+            static const std::size_t GROWTH_DIVISOR{4};
+
+            void append(const float*, std::size_t);
+            int pop(std::size_t, const Writer&);
+            int mix(const float*, std::size_t, const Writer&);
+            void gains(double, float&, float&) const;
+
+            Crossfade_Curve m_curve;
+            int m_sample_rate;
+            int m_channel_count;
+
+            // the delay line, a ring of frames
+            std::vector<float> m_buffer;
+            std::size_t m_capacity;  // in frames
+            std::size_t m_start;     // oldest frame
+            std::size_t m_length;    // frames in the delay line
+            std::size_t m_target;    // length the delay line is kept at, it grows up to the capacity
+
+            // the mixed frames, written from here
+            std::vector<float> m_scratch;
+            std::vector<float> m_silence;
+
+            // the fade in progress, the frames of the previous track left in the delay line are faded out
+            bool m_fading;
+            std::size_t m_fade_length;
+            std::size_t m_fade_position;
+
+            int m_fades;
+            double m_mix_seconds;
+            unsigned long long m_mixed_frames;
+    };
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <atomic>
+
+namespace Audio
+{
+    // volume levels, in percent
+    const int MAX_VOLUME{100};
+    const int VOLUME_STEP{5};
+
+    // gets the gain of a volume level in percent, the level is cubed so the steps sound about even
+    float volume_gain(int);
+
+    // parse a volume command's argument, N sets the level, +N / -N change it, returns false if the argument is bad
+    bool parse_volume(const std::string&, int, int&);
+
+    /* Volume_Control class
+     * Description: The volume level in percent, changed from the terminal or keys on one thread, read by the thread playing audio.
+     * The volume is applied by a Gain on float audio, on an output that doesn't take float samples it isn't available,
+     * then changes are refused with a message instead of pretending to work
+     *
+     * How to use:
+     * 1. set_available() once the output is opened
+     * 2. command() every line read from the terminal, step() for a key
+     * 3. play at level()
+     */
+    class Volume_Control
+    {
+        public:
+            Volume_Control();
+            Volume_Control(const Volume_Control&) = delete;
+
+            void set_available(bool);
+
+            bool command(const std::string&);
+            void step(int);
+
+            int level() const;
+
+        private:
+            bool check_available() const;
+
+            std::atomic<int> m_level;
+            std::atomic<bool> m_available;
+    };
+
+    /* Gain class
+     * Description: Applies a gain to interleaved float audio and clips it, for volume and ReplayGain.
+     * A new gain isn't jumped to, the gain ramps there, a full scale change takes RAMP_MS, so changes don't click or crackle (zipper noise).
+     * At unity gain nothing is done at all, process() gives back the samples it was given, the output buffer is only used otherwise.
+     *
+     * How to use:
+     * 1. set_format() the sample rate and channels
+     * 2. set_gain() whenever the gain changes, 1 is unity, or reset() to jump to a gain where the audio doesn't continue, like a new track
+     * 3. process() audio, and play what it returns
+     */
+    class Gain
+    {
+        public:
+            Gain();
+            Gain(const Gain&) = delete;
+
+            void set_format(int, int);
+            void set_gain(float);
+            void reset(float);
+
+            const float *process(const float*, std::size_t);
+
+            bool unity() const;
+            float gain() const;
+
+        private:
+            // milliseconds a ramp from 0 to 1 takes
+            static const int RAMP_MS{20};
+
+            int m_channel_count;
+            std::size_t m_ramp_frames;
+
+            float m_target;   // the gain set
+            float m_current;  // the gain reached, moves towards the target
+            bool m_processed; // until something is processed, a new gain is used right away
+
+            std::vector<float> m_buffer;
+    };
+}
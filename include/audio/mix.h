@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Audio
+{
+    /* crossfade_mix function
+     * Description: mixes two blocks of float samples, each with its own gain ramping linearly from sample to sample:
+     * output[i] = first[i] * (first_gain + i * first_step) + second[i] * (second_gain + i * second_step)
+     * Interleaved channels just ramp along, the gain changes far too little between two channels of a frame to matter.
+     * With SSE, 4 samples are mixed at a time. output may be the same as first or second
+     */
+    void crossfade_mix(const float*, const float*, float*, std::size_t, float, float, float, float);
+
+    /* gain_clip function
+     * Description: applies a gain, ramping linearly from sample to sample, to float samples and clips them to [-1, 1]:
+     * output[i] = clamp(input[i] * (gain + i * step), -1, 1)
+     * With SSE, 4 samples are done at a time. output may be the same as input
+     */
+    void gain_clip(const float*, float*, std::size_t, float, float);
+}
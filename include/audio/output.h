@@ -0,0 +1,59 @@
+#pragma once
+
+#include <portaudio/portaudio.h>
+#include <audio/crossfade.h>
+#include <audio/gain.h>
+
+#include <cstddef>
+
+namespace Audio
+{
+    /* Output class
+     * Description: A playback stream and the stages audio goes through on the way to it: ReplayGain, the crossfade, then the volume.
+     * ReplayGain comes before the crossfade, so each track keeps its own gain while they're mixed, the volume after it,
+     * so volume changes are heard right away. The stages work on float samples, a stream in another format is written
+     * to as it is, and says so instead of pretending the stages are applied
+     *
+     * How to use:
+     * 1. open playback(), then set_format()
+     * 2. set_crossfade() once, set_replay_gain() for every track
+     * 3. play() audio in the stream's format, at the volume level
+     * 4. start_fade() when a track ends by itself, clear() when it's skipped
+     * 5. finish() at the end, for what the crossfade still holds
+     */
+    class Output
+    {
+        public:
+            Output();
+            Output(const Output&) = delete;
+
+            bool set_format();
+            void set_crossfade(double, Crossfade_Curve);
+            void set_replay_gain(bool, double, double);
+
+            PaError play(const void*, std::size_t, int);
+            PaError finish(int);
+
+            void start_fade();
+            void clear();
+
+            void print_statistics() const;
+
+            PortAudio::Stream_Playback &playback();
+            const Crossfade &crossfade() const;
+            bool float_output() const;
+
+        private:
+            PaError write(const float*, std::size_t, int);
+            PaError write_crossfaded(const float*, std::size_t, int);
+
+            PortAudio::Stream_Playback m_playback;
+
+            // the stream takes float samples, the stages are only used then
+            bool m_float_output;
+
+            Gain m_replay_gain;
+            Crossfade m_crossfade;
+            Gain m_volume;
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+#include <string>
+
+namespace Audio
+{
+    // Replay_Gain_Mode enum, which ReplayGain tags are used
+    enum Replay_Gain_Mode
+    {
+        REPLAY_GAIN_OFF,
+        REPLAY_GAIN_TRACK,  // every track is played at the same loudness
+        REPLAY_GAIN_ALBUM   // every album is played at the same loudness, the tracks of an album keep their differences
+    };
+
+    // get the command line name of a mode
+    std::string replay_gain_mode_name(Replay_Gain_Mode);
+
+    // parse a command line name into a mode, returns false if the name is unknown
+    bool parse_replay_gain_mode(const std::string&, Replay_Gain_Mode&);
+
+    /* read_replay_gain function
+     * Description: reads the ReplayGain of a file from its tags, REPLAYGAIN_TRACK_GAIN / _PEAK and REPLAYGAIN_ALBUM_GAIN / _PEAK
+     * (ID3v2 TXXX, Vorbis comments, APE), or R128_TRACK_GAIN / R128_ALBUM_GAIN (Opus). The album gain falls back to the track gain
+     */
+    bool read_replay_gain(const AVFormatContext*, const AVStream*, Replay_Gain_Mode, double&, double&);
+
+    // gets the linear gain of a ReplayGain in dB, lowered so the peak doesn't clip, a peak of 0 is unknown
+    float replay_gain_factor(double, double);
+}
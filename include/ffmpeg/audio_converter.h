@@ -0,0 +1,80 @@
+#pragma once
+
+#include <ffmpeg/resample.h>
+#include <ffmpeg/frame.h>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include <cstdint>
+
+namespace FFmpeg
+{
+    /* Audio_Converter class
+     * Description: Converts decoded audio to one fixed output format, sample rate and channel count, the format the audio device runs in.
+     * The Resample context is cached: it's only set up again when the input's format, sample rate or channel layout changes,
+     * so one file after the other with the same format goes through the same context. Input already in the output format isn't copied.
+     * Channels are mixed down or up by the resampler, e.g. 5.1 to stereo.
+     * The converted audio goes into one output buffer kept from call to call, it's only allocated again when a frame needs more room,
+     * so in steady state converting allocates nothing, allocations() counts them, late_allocations() the ones after the first frame.
+     * Setting the resampler up, and starting it over after a flush() or reset(), allocates in FFmpeg, restarts() counts the latter
+     *
+     * How to use:
+     * 1. set_output() to the stream's format
+     * 2. convert() every decoded frame, then write converted()
+     * 3. flush() at the end of every track, and write converted(), for the samples the resampler held back
+     * 4. reset() to throw away what the resampler holds, e.g. when skipping
+     */
+    class Audio_Converter
+    {
+        public:
+            Audio_Converter();
+            Audio_Converter(const Audio_Converter&) = delete;
+
+            void set_output(int, int, enum AVSampleFormat);
+
+            int convert(AVFrame*);
+            int flush();
+            int reset();
+
+            const AVFrame *converted() const;
+
+            int channel_count() const;
+            int sample_rate() const;
+            enum AVSampleFormat sample_format() const;
+            int reconfigurations() const;
+            int allocations() const;
+            int late_allocations() const;
+            int restarts() const;
+
+        private:
+            int configure(const AVFrame*, int64_t);
+            int reserve(int);
+            int resample(const uint8_t**, int);
+
+            Resample m_resampler;
+            Frame m_output;
+            int m_output_capacity; // samples per channel m_output's buffer holds
+
+            // the output of the last conversion, m_output, or the input if it didn't need converting
+            const AVFrame *m_converted;
+
+            int m_output_channel_count;
+            int64_t m_output_channel_layout;
+            int m_output_sample_rate;
+            enum AVSampleFormat m_output_format;
+
+            // what the resampler is set up for
+            int64_t m_input_channel_layout;
+            int m_input_sample_rate;
+            enum AVSampleFormat m_input_format;
+
+            int m_reconfigurations;
+            int m_allocations;      // of the output buffer
+            int m_late_allocations; // of the output buffer, growing one allocated before
+            int m_restarts;         // of the resampler, after a flush or reset
+    };
+}
@@ -7,6 +7,7 @@ extern "C"
 #include <libavutil/avutil.h>
 } 
 #include <string>
+#include <functional>
 
 namespace FFmpeg
 {
@@ -24,6 +25,10 @@ namespace FFmpeg
      * 5. call recive_frame(Frame) in a loop until it returns AVERROR(EAGAIN) inidicating the decoder needs more data // This function decodes the data fed to the decoder via send_packet(),
      * note this function outputs the decoded data into the passed AVFrame**
      * 6. Repeat step 4 & 5 until AVERROR_EOF is given by send_packet() indicating the end of the file has been reached
+     * 7. optionally call flush(), then receive_frame() until it returns AVERROR_EOF, to get the last frames the decoder held back
+     *
+     * Packets of other streams are normally thrown away by send_packet(). set_side_stream() hands the packets of one other stream
+     * to a function instead, so a second stream like subtitles can be decoded from the same demuxing without opening the file twice
      */
     class Decoder
     {
@@ -37,9 +42,12 @@ namespace FFmpeg
             int find_stream(enum AVMediaType);
             int init_codec_context(AVDictionary**, int);
             int send_packet();
+            int flush();
             int receive_frame(AVFrame**);
             void free_resources();
 
+            void set_side_stream(int, std::function<void(AVPacket*)>);
+
             const AVFormatContext *format_context() const;
 
             AVCodec *codec();
@@ -66,5 +74,9 @@ namespace FFmpeg
             std::string m_filename;
             int m_stream_number;
 
+            // stream whose packets are given to the side packet handler, -1 for none
+            int m_side_stream_number;
+            std::function<void(AVPacket*)> m_side_packet_handler;
+
     };
 }
@@ -28,6 +28,10 @@ namespace FFmpeg
 
             int copy(const AVFrame*);
 
+            int reference(const AVFrame*);
+
+            bool matches(enum AVPixelFormat, int, int) const;
+
             AVFrame *frame();
             const AVFrame *frame() const;
 
@@ -0,0 +1,44 @@
+#pragma once
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+namespace FFmpeg
+{
+    /* Subtitle_Decoder Class
+     * Description: Decodes a subtitle stream of a file that is already opened by a Decoder. It doesn't read the file itself,
+     * packets are passed in with decode(), usually from the Decoder's side stream handler, so the file is only demuxed once.
+     * Like the Decoder class no exceptions are used, functions return FFmpeg error codes, or -1111 if an allocation / lookup failed
+     *
+     * How to use: Assuming object has been constructed
+     * 1. call find_stream(format_context, related_stream) // finds the best subtitle stream, for the video stream given
+     * 2. call init_codec_context(format_context) // opens a decoder for the stream
+     * 3. call decode(packet, subtitle) for each packet of the stream, a subtitle was decoded if it returns a value > 0
+     * it has to be freed with avsubtitle_free()
+     */
+    class Subtitle_Decoder
+    {
+        public:
+            Subtitle_Decoder();
+            Subtitle_Decoder(const Subtitle_Decoder&) = delete;
+
+            ~Subtitle_Decoder();
+
+            int find_stream(const AVFormatContext*, int);
+            int init_codec_context(const AVFormatContext*);
+            int decode(AVPacket*, AVSubtitle*);
+            void free_resources();
+
+            const AVCodecContext *codec_context() const;
+
+            int stream_number() const;
+
+        private:
+            AVCodecContext *m_codec_ctx;
+
+            int m_stream_number;
+    };
+}
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <utility/ring_buffer.h>
+
 extern "C"
 {
 #include <portaudio.h>
 }
 
+#include <atomic>
+
 namespace PortAudio
 {
     // Initializes portaudio on construction and terminate portaudio on destruction
@@ -14,7 +18,14 @@ namespace PortAudio
         ~Initializer();
     };
 
-    // Class to handle audio playback
+    /* Stream_Playback class
+     * Description: Class to handle audio playback
+     * By default the stream is a blocking one, write() blocks in Pa_WriteStream until the device has room, so any hiccup of the writing thread
+     * is heard as an underrun. With a buffer duration set before opening the stream, it is a callback stream instead:
+     * write() copies into a lock-free ring buffer, and the real-time PortAudio callback plays from it, so the writing thread can fall
+     * behind by up to the buffer duration without being heard. The callback never locks or allocates, it plays silence if the buffer runs empty
+     * played_time() is how much of the written audio has been heard, from the stream's clock and the output latency, for syncing video to
+     */
     class Stream_Playback
     {
         public:
@@ -25,13 +36,17 @@ namespace PortAudio
 
             PaError set_host_api_index(PaHostApiIndex);
             PaError set_device_index(PaDeviceIndex);
+            void set_buffer_duration(double);
 
             PaError open_stream(int, PaSampleFormat, PaTime, int, PaStreamFlags);
+            PaError open_native_stream(PaTime, PaStreamFlags);
+            PaError reopen_stream(PaTime);
 
             PaError start_stream();
             PaError stop_stream();
 
             PaError write(const void*, unsigned long);
+            void drain();
             PaError reset();
 
             PaTime actual_latency();
@@ -42,10 +57,26 @@ namespace PortAudio
             PaTime suggested_latency() const;
             int sample_rate() const;
 
+            bool callback_mode() const;
+            double buffer_duration() const;
+            unsigned long buffered_frames() const;
+            unsigned long long frames_written() const;
+            unsigned long underruns() const;
+            unsigned long long underrun_frames() const;
+            unsigned long overruns() const;
+
+            double played_time() const;
+            PaTime output_latency() const;
+
             PaStream *stream();
             const PaStream *stream() const;
 
         private:
+            static int stream_callback(const void*, void*, unsigned long, const PaStreamCallbackTimeInfo*, PaStreamCallbackFlags, void*);
+            void fill_buffer(uint8_t*, unsigned long, const PaStreamCallbackTimeInfo*, PaStreamCallbackFlags);
+            void set_anchor(double, double);
+            unsigned long long played_frames() const;
+
             PaHostApiIndex m_host_api;
             PaDeviceIndex m_device;
 
@@ -55,7 +86,34 @@ namespace PortAudio
             PaSampleFormat m_sample_format;
             PaTime m_suggested_latency;
             int m_sample_rate;
+            PaStreamFlags m_flags;
 
             bool m_stream_stopped;
+
+            // callback mode, a buffer duration of 0 is a blocking stream
+            double m_buffer_duration;
+            Utility::Ring_Buffer m_ring_buffer;
+            uint8_t m_silence; // sample byte value of silence, unsigned 8 bit samples are centered at 128
+
+            // the buffer starts empty and is emptied at the end, running empty then isn't an underrun
+            std::atomic<bool> m_primed;
+            std::atomic<bool> m_draining;
+
+            // statistics, an underrun is a buffer the device played (partly) silent, an overrun is audio dropped because the buffer stayed full
+            std::atomic<unsigned long long> m_frames_written;
+            std::atomic<unsigned long> m_underruns;
+            std::atomic<unsigned long long> m_underrun_frames;
+            std::atomic<unsigned long> m_overruns;
+
+            // output latency reported by the opened stream, the time from writing a frame to hearing it
+            PaTime m_output_latency;
+
+            // where playback is: the frame at anchor position, in seconds, is heard at anchor time, on the stream's clock
+            // set by the callback or the writing thread, read by any thread, the sequence is odd while it's being changed
+            std::atomic<unsigned int> m_anchor_sequence;
+            std::atomic<double> m_anchor_time;     // negative until the stream plays something after starting
+            std::atomic<double> m_anchor_position;
+            std::atomic<double> m_start_position;  // position the stream was started at, everything before it was heard
+            std::atomic<unsigned long long> m_frames_read; // frames the callback took out of the ring buffer
     };
 }
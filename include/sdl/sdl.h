@@ -86,4 +86,28 @@ namespace SDL
             SDL_Texture *m_texture;
 
     };
+
+    // Surface class
+    // Description: A RAII wrapper around SDL_Surface*, usable with SDL functions
+    class Surface
+    {
+        public:
+            Surface();
+
+            Surface(const Surface&) = delete;
+
+            ~Surface();
+
+            operator SDL_Surface*();
+
+            SDL_Surface *operator =(SDL_Surface*);
+
+
+            SDL_Surface* surface();
+            const SDL_Surface* surface() const;
+
+        private:
+            SDL_Surface *m_surface;
+
+    };
 }
@@ -0,0 +1,40 @@
+#pragma once
+
+extern "C"
+{
+#include <SDL2/SDL.h>
+}
+
+#include <mutex>
+#include <atomic>
+
+namespace Utility
+{
+    /* Display_Info class
+     * Description: Caches the usable bounds of the display the video window is on, so they aren't queried for every video.
+     * It is filled once when the window is created, and updated from SDL display events and window move events,
+     * so a window moved to another monitor picks up that monitor's bounds.
+     * Updated by the SDL event thread and read by the video threads, which compare changes() to notice an update
+     */
+    class Display_Info
+    {
+        public:
+            Display_Info();
+            Display_Info(const Display_Info&) = delete;
+
+            bool update(SDL_Window*);
+            void set_resolution(const SDL_Rect&);
+
+            SDL_Rect resolution() const;
+            int display_index() const;
+            int changes() const;
+
+        private:
+            mutable std::mutex m_mutex;
+
+            SDL_Rect m_resolution;
+            int m_display_index;
+
+            std::atomic<int> m_changes;
+    };
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+
+namespace Utility
+{
+    /* Frame_Scheduler class
+     * Description: Waits until frames are due. It sleeps with clock_nanosleep until shortly before the target time and only spins
+     * for the rest, so the presenting thread doesn't keep a core busy. Target times can be lined up with the display's vsync interval.
+     * It keeps track of how late each wait woke up and of the CPU time spent waiting, so the two wait modes can be compared
+     */
+    class Frame_Scheduler
+    {
+        public:
+            Frame_Scheduler(bool);
+
+            void set_refresh_interval(double);
+
+            std::chrono::steady_clock::time_point align(std::chrono::steady_clock::time_point) const;
+
+            void wait_until(std::chrono::steady_clock::time_point);
+
+            void presented();
+
+            void print_statistics() const;
+
+            bool busy_wait() const;
+            double refresh_interval() const;
+
+        private:
+            bool m_busy_wait;
+
+            // 0 if vsync isn't used
+            double m_refresh_interval;
+
+            // estimate of a recent vsync edge, the others are whole refresh intervals away from it
+            std::chrono::steady_clock::time_point m_vsync_edge;
+            bool m_presented;
+
+            // statistics, lateness is how long after the target time a wait returned
+            int m_waits;
+            int m_late_frames;
+            double m_total_lateness;
+            double m_max_lateness;
+            double m_wait_time;
+            double m_wait_cpu_time;
+    };
+}
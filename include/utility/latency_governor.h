@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+namespace Utility
+{
+    // parse a latency option, milliseconds for a fixed latency or auto, returns false if it's bad
+    bool parse_latency(const std::string&, double&, bool&);
+
+    /* Latency_Governor class
+     * Description: Keeps track of the suggested latency to open the audio stream with. In automatic mode it starts low,
+     * is fed the stream's underrun count, and doubles the latency when the stream keeps running empty, until it's high enough
+     * or reaches MAX_LATENCY. It never goes back down, a machine that underran once will do it again. Every raise is logged.
+     * Fixed mode only counts the underruns
+     *
+     * How to use:
+     * 1. open the stream with latency()
+     * 2. record() the stream's underruns after writing to it
+     * 3. when record() returns true, reopen the stream with the new latency()
+     */
+    class Latency_Governor
+    {
+        public:
+            Latency_Governor(double, bool);
+
+            bool record(unsigned long, double);
+
+            double latency() const;
+            bool automatic() const;
+            unsigned long underruns() const;
+            int raises() const;
+
+        private:
+            double m_latency;
+            bool m_automatic;
+
+            unsigned long m_underruns;       // underruns recorded, over every stream
+            unsigned long m_stream_underruns;// the stream's count at the last record, a new stream counts from 0
+            int m_raises;
+
+            // underruns since the window started, too many in one window raise the latency
+            double m_window_start;
+            unsigned long m_window_underruns;
+    };
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Utility
+{
+    /* Ring_Buffer class
+     * Description: A lock-free single producer, single consumer ring buffer of interleaved audio frames.
+     * One thread writes decoded audio, another, the real-time PortAudio callback, reads it. Neither side ever locks, waits or allocates,
+     * they only see how much there is to read / room to write, so the caller decides what to do when the buffer runs empty or full.
+     *
+     * How to use:
+     * 1. allocate() the buffer before either thread uses it
+     * 2. the producer calls write() or write_planar(), the consumer calls read()
+     * 3. clear() only while neither thread is using the buffer
+     */
+    class Ring_Buffer
+    {
+        public:
+            Ring_Buffer();
+            Ring_Buffer(const Ring_Buffer&) = delete;
+
+            void allocate(std::size_t, int, int);
+            void clear();
+
+            std::size_t write(const uint8_t*, std::size_t);
+            std::size_t write_planar(const uint8_t *const*, std::size_t, std::size_t);
+            std::size_t read(uint8_t*, std::size_t);
+
+            std::size_t available() const;
+            std::size_t space() const;
+
+            std::size_t capacity() const;
+            int channel_count() const;
+            int sample_size() const;
+            int frame_size() const;
+
+        private:
+            std::vector<uint8_t> m_buffer;
+
+            std::size_t m_capacity; // in frames
+            int m_channel_count;
+            int m_sample_size;      // bytes per sample of one channel
+            int m_frame_size;       // bytes per frame, all channels
+
+            // frames ever written / read, they only grow, so full and empty can be told apart
+            // kept on separate cache lines, each is only written by one thread
+            alignas(64) std::atomic<std::size_t> m_write_position;
+            alignas(64) std::atomic<std::size_t> m_read_position;
+    };
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+
+namespace Utility
+{
+    // Image scaler presets, ordered from the cheapest to the best quality
+    enum Scaler_Preset
+    {
+        SCALER_FAST_BILINEAR,
+        SCALER_BILINEAR,
+        SCALER_BICUBIC,
+        SCALER_LANCZOS
+    };
+
+    // get the libswscale flags for a preset
+    int scaler_flags(Scaler_Preset);
+
+    // get the command line name of a preset
+    std::string scaler_name(Scaler_Preset);
+
+    // parse a command line name into a preset, returns false if the name is unknown
+    bool parse_scaler_preset(const std::string&, Scaler_Preset&);
+
+    /* Scaler_Governor class
+     * Description: Keeps track of which scaler preset to use. In automatic mode it is fed the time each image conversion took,
+     * and drops to a cheaper preset when conversion time nears the frame budget, then goes back up to the best preset
+     * once there is headroom again. Every switch is logged.
+     * Only one thread may call record, but any thread can read the current preset
+     */
+    class Scaler_Governor
+    {
+        public:
+            Scaler_Governor(Scaler_Preset, bool);
+
+            void set_frame_budget(double);
+
+            bool record(double);
+
+            Scaler_Preset preset() const;
+            int flags() const;
+            bool automatic() const;
+
+        private:
+            std::atomic<Scaler_Preset> m_preset;
+            Scaler_Preset m_best_preset;
+            bool m_automatic;
+
+            double m_frame_budget;
+            double m_average_time;
+            int m_frames_since_switch;
+    };
+}
@@ -23,10 +23,17 @@ namespace Utility
             int post();
             int wait();
 
+            int wait_for_count(int);
+            void interrupt();
+
         private:
 
             int m_count;
+            bool m_interrupted;
             std::mutex m_mutex;
             std::condition_variable m_condition_variable;
+
+            // for threads waiting on the count to reach a value, without taking from it
+            std::condition_variable m_count_condition_variable;
     };
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+namespace Utility
+{
+    /* Thread_Pool class
+     * Description: A small pool of worker threads used to split per frame work, like processing row bands of an image.
+     * The threads are started once and sleep until work is given to them, so no threads are created per frame.
+     * Only one thread should call run() at a time.
+     */
+    class Thread_Pool
+    {
+        public:
+            Thread_Pool(int);
+            Thread_Pool(const Thread_Pool&) = delete;
+
+            ~Thread_Pool();
+
+            void run(int, const std::function<void(int)>&);
+
+            int thread_count() const;
+
+        private:
+            void worker();
+
+            std::vector<std::thread> m_threads;
+
+            std::mutex m_mutex;
+            std::condition_variable m_work_condition_variable;
+            std::condition_variable m_done_condition_variable;
+
+            const std::function<void(int)> *m_task;
+            int m_task_count;
+            int m_next_task;
+            int m_tasks_done;
+            bool m_stopping;
+    };
+}
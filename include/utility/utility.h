@@ -9,12 +9,13 @@ extern "C"
 }
 
 #include <string>
+#include <vector>
 
 
 namespace Utility
 {
-    // Function to get screens native resolution
-    SDL_Rect get_native_resolution();
+    // Function to get the usable resolution of a display, by display index
+    SDL_Rect get_native_resolution(int);
 
     // prints the provided std::string message and the result of SDL_GetError()
     void print_error(const std::string&);
@@ -34,6 +35,10 @@ namespace Utility
     void portaudio_error_assert(bool, const std::string&, PaError);
 
     bool rescaling_needed(enum AVPixelFormat, enum AVPixelFormat&, uint32_t&);
+
+    // like above, but picks the cheapest path into a texture format the renderer supports natively, the renderer doesn't have to convert
+    // the last parameter is the renderer's texture formats from SDL_GetRendererInfo, if it's empty the choice is the same as above
+    bool rescaling_needed(enum AVPixelFormat, enum AVPixelFormat&, uint32_t&, const std::vector<uint32_t>&);
     bool valid_rescaling_input(enum AVPixelFormat);
 
     // downsize src resolution to >= dst resolution
@@ -45,4 +50,13 @@ namespace Utility
     // function to dictate weather resampling is needed
     bool resampling_needed(enum AVSampleFormat, enum AVSampleFormat&, PaSampleFormat&, bool&);
 
+    // the FFmpeg sample format of a PortAudio one, AV_SAMPLE_FMT_NONE if FFmpeg doesn't have it
+    enum AVSampleFormat ffmpeg_sample_format(PaSampleFormat);
+
+    // peak resident memory of the process in kilobytes, -1 if it can't be read
+    long peak_memory_usage();
+
+    // resets the peak resident memory, so peak_memory_usage only covers what comes after. Only works on Linux
+    void reset_peak_memory_usage();
+
 }
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <utility/thread_pool.h>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <string>
+
+namespace Video
+{
+    // Deinterlacing modes
+    // bob interpolates the missing field from the kept field, adaptive keeps the full detail
+    // in still areas and only interpolates where the picture moved since the previous frame, like yadif
+    enum Deinterlace_Mode
+    {
+        DEINTERLACE_OFF,
+        DEINTERLACE_BOB,
+        DEINTERLACE_ADAPTIVE
+    };
+
+    // get the command line name of a mode
+    std::string deinterlace_mode_name(Deinterlace_Mode);
+
+    // parse a command line name into a mode, returns false if the name is unknown
+    bool parse_deinterlace_mode(const std::string&, Deinterlace_Mode&);
+
+    // checks if a frame needs deinterlacing, either the frame or the stream it belongs to is flagged as interlaced
+    bool frame_interlaced(const AVFrame*, enum AVFieldOrder);
+
+    // checks if the top field of an interlaced frame comes first
+    bool top_field_first(const AVFrame*, enum AVFieldOrder);
+
+    /* Deinterlacer class
+     * Description: Deinterlaces frames with 8 bits per component, planar or packed. The kept field is copied and the other
+     * field is rebuilt line by line, the lines are split into bands that are processed in parallel by a Thread_Pool,
+     * the inner loops use SSE2 when available.
+     *
+     * How to use:
+     * 1. check the pixel format with supported()
+     * 2. call process(source_frame, destination_frame, top_field_first), destination_frame must already be allocated
+     * with the same pixel format and size as the source_frame
+     * Note: In adaptive mode a reference to the previous source frame is held, so the source frame must not be written to afterwards
+     */
+    class Deinterlacer
+    {
+        public:
+            Deinterlacer(Deinterlace_Mode, Utility::Thread_Pool&);
+            Deinterlacer(const Deinterlacer&) = delete;
+
+            ~Deinterlacer();
+
+            static bool supported(enum AVPixelFormat);
+
+            int process(const AVFrame*, AVFrame*, bool);
+
+            Deinterlace_Mode mode() const;
+
+        private:
+            Deinterlace_Mode m_mode;
+            Utility::Thread_Pool &m_thread_pool;
+
+            AVFrame *m_previous;
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Video
+{
+    /* Frame_Pacing class
+     * Description: Keeps statistics on how smoothly frames are presented. Every present is compared with the frame's pts:
+     * the interval between two presents should match the pts delta, and with vsync both should cover the same number of refreshes.
+     * Deviations go into a histogram, and into fine fixed buckets for percentiles, so memory and print() cost don't grow with the video. Vsyncs a frame stayed on screen too long are counted as repeated,
+     * and vsyncs it was shown too short as skipped. The A/V offset is how far a present was from the frame's time on the playback clock
+     */
+    class Frame_Pacing
+    {
+        public:
+            Frame_Pacing();
+
+            void set_refresh_interval(double);
+
+            void record(double, double);
+
+            void print() const;
+
+            int frames() const;
+
+        private:
+            // upper bounds of the deviation histogram buckets in milliseconds, the last bucket takes everything above
+            static const int HISTOGRAM_BUCKETS{8};
+            static const double HISTOGRAM_BOUNDS[HISTOGRAM_BUCKETS - 1];
+
+            // 0 if vsync isn't used
+            double m_refresh_interval;
+
+            int m_frames;
+            double m_first_present_time;
+            double m_first_frame_time;
+            double m_last_present_time;
+            double m_last_frame_time;
+
+            // percentile buckets, PERCENTILE_RESOLUTION milliseconds wide, the last bucket takes everything above
+            static const int PERCENTILE_BUCKETS{2000};
+            static const double PERCENTILE_RESOLUTION;
+
+            // absolute difference between the present interval and the pts delta
+            long m_deviation_count;
+            long m_percentile_buckets[PERCENTILE_BUCKETS];
+            double m_max_deviation;
+            int m_histogram[HISTOGRAM_BUCKETS];
+
+            long m_repeated_vsyncs;
+            long m_skipped_vsyncs;
+
+            // vsyncs presentation is ahead (negative) or behind of the first frame's timing, after counting repeats and skips
+            long m_vsync_slip;
+
+            // largest A/V offset, keeps its sign, positive means video was late
+            double m_max_av_offset;
+    };
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+#include <libavutil/rational.h>
+}
+
+#include <cstdint>
+
+namespace Video
+{
+    /* Frame_Timing class
+     * Description: Gives every decoded frame of a stream a usable timestamp, in the stream's timebase.
+     * The frame's best_effort_timestamp is used when there is one, so variable frame rate video keeps its own timing.
+     * Frames without one, or with one that goes backwards, get an estimated timestamp: the previous one plus the frame's
+     * packet duration, or the last interval seen between real timestamps, or else the rational average frame rate.
+     * Estimates from the frame rate are counted from the last real timestamp, so a run of them doesn't drift
+     */
+    class Frame_Timing
+    {
+        public:
+            Frame_Timing(const AVStream*);
+
+            int64_t timestamp(const AVFrame*);
+
+            double frame_rate() const;
+            double frame_duration() const;
+            double timebase() const;
+            int estimated_timestamps() const;
+
+        private:
+            AVRational m_time_base;
+
+            // nominal frame rate, the average frame rate if the stream has one
+            AVRational m_frame_rate;
+
+            int64_t m_last_timestamp;
+            int64_t m_last_interval;
+
+            // timestamp frame rate estimates are counted from, and how many frames were estimated since
+            int64_t m_anchor_timestamp;
+            int m_frames_since_anchor;
+
+            int m_estimated_timestamps;
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <portaudio/portaudio.h>
+
+#include <mutex>
+#include <chrono>
+
+namespace Video
+{
+    /* Master_Clock class
+     * Description: The playback clock video frames are scheduled against, in seconds on the streams' timeline.
+     * While audio plays it follows the audio output, the time of the first audio frame plus how much of the audio has been heard,
+     * so video stays in sync with what is heard, however the audio device's clock drifts from the system one, and it waits with the audio
+     * when the audio runs late. Without audio, or once the audio ends, it runs on the steady clock from where it was.
+     *
+     * How to use:
+     * 1. start() it at the first frame's time
+     * 2. set_audio_source() once the audio stream has started, clear_audio_source() before the stream is closed
+     * 3. pause() and resume() around pauses, only needed for the steady clock, a stopped audio stream stands still by itself
+     * 4. time() gets the current playback time, from any thread
+     */
+    class Master_Clock
+    {
+        public:
+            Master_Clock();
+            Master_Clock(const Master_Clock&) = delete;
+
+            void start(double);
+
+            void set_audio_source(const PortAudio::Stream_Playback*, double);
+            void clear_audio_source();
+
+            void pause();
+            void resume();
+
+            double time();
+
+            bool audio_master();
+
+        private:
+            double wall_time(std::chrono::steady_clock::time_point) const;
+
+            std::mutex m_mutex;
+
+            // audio playback, and the time of its first frame, nullptr if the steady clock is used
+            const PortAudio::Stream_Playback *m_audio;
+            double m_audio_start_time;
+
+            // steady clock, the media time at a point in time, kept up to date with the audio clock while audio plays
+            std::chrono::steady_clock::time_point m_wall_start;
+            double m_wall_start_time;
+
+            bool m_paused;
+            std::chrono::steady_clock::time_point m_pause_start;
+    };
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+namespace Video
+{
+    // Subtitle_Image struct, a decoded bitmap subtitle with all it's rectangles composited into one ARGB image
+    struct Subtitle_Image
+    {
+        // seconds on the stream's timeline, end_time is infinity if the subtitle lasts until the next one
+        double start_time;
+        double end_time;
+
+        // position and size of the image on the subtitle canvas
+        int x;
+        int y;
+        int width;
+        int height;
+
+        // 32 bit ARGB in native byte order, like SDL_PIXELFORMAT_ARGB8888, empty for a subtitle that clears the screen
+        std::vector<uint32_t> pixels;
+    };
+
+    /* Subtitle_Overlay class
+     * Description: Keeps the bitmap subtitles decoded ahead by the decoder thread, and picks the one to show for each video frame.
+     * Subtitles are converted from palette images to ARGB once when they are added, update() tells the presenting thread
+     * whether the shown subtitle changed, so the overlay texture is only uploaded when it did
+     */
+    class Subtitle_Overlay
+    {
+        public:
+            Subtitle_Overlay();
+            Subtitle_Overlay(const Subtitle_Overlay&) = delete;
+
+            void set_canvas_size(int, int);
+
+            void add(const AVSubtitle&);
+
+            bool update(double);
+
+            const Subtitle_Image *current() const;
+
+            int canvas_width() const;
+            int canvas_height() const;
+            int changes() const;
+
+        private:
+            std::mutex m_mutex;
+
+            // the resolution subtitle positions are relative to, usually the video's
+            int m_canvas_width;
+            int m_canvas_height;
+
+            // decoded subtitles that haven't started yet, in start order. Only touched with the mutex held
+            std::deque<Subtitle_Image> m_pending;
+
+            // only used by the presenting thread
+            Subtitle_Image m_current;
+            bool m_showing;
+            int m_changes;
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <utility/thread_pool.h>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <string>
+#include <vector>
+
+namespace Video
+{
+    // Tone mapping curves, used to squeeze HDR brightness into the SDR range
+    enum Tone_Map_Curve
+    {
+        TONE_MAP_OFF,
+        TONE_MAP_HABLE,
+        TONE_MAP_REINHARD,
+        TONE_MAP_BT2390
+    };
+
+    // get the command line name of a curve
+    std::string tone_map_curve_name(Tone_Map_Curve);
+
+    // parse a command line name into a curve, returns false if the name is unknown
+    bool parse_tone_map_curve(const std::string&, Tone_Map_Curve&);
+
+    // checks if a frame holds HDR video, a PQ or HLG transfer function
+    bool hdr_frame(const AVFrame*);
+
+    /* Tone_Mapper class
+     * Description: Converts 10 bit PQ / HLG frames in BT.2020 to 8 bit BT.709 YUV420P frames of the same size.
+     * Transfer functions, the tone mapping curve and the output gamma are all precomputed into lookup tables, which are
+     * rebuilt only when the transfer function or peak brightness changes. With SSE2, 4 blocks of 2x2 pixels are processed
+     * side by side, one block per lane, only the table lookups are done per lane since SSE2 has no gather. Rows of blocks are split
+     * across a Thread_Pool.
+     *
+     * How to use:
+     * 1. check the frame with hdr_frame() and the pixel format with supported()
+     * 2. call process(source_frame, destination_frame), destination_frame must be an allocated YUV420P frame with the same size
+     */
+    class Tone_Mapper
+    {
+        public:
+            Tone_Mapper(Tone_Map_Curve, Utility::Thread_Pool&);
+            Tone_Mapper(const Tone_Mapper&) = delete;
+
+            static bool supported(enum AVPixelFormat);
+
+            int process(const AVFrame*, AVFrame*);
+
+            Tone_Map_Curve curve() const;
+
+        private:
+            void build_tables(enum AVColorTransferCharacteristic, double);
+            void process_rows(const AVFrame*, AVFrame*, int, int);
+
+            Tone_Map_Curve m_curve;
+            Utility::Thread_Pool &m_thread_pool;
+
+            // what the tables are built for
+            enum AVColorTransferCharacteristic m_transfer;
+            double m_peak;
+
+            // peak brightness of the signal, 1.0 is SDR white
+            float m_signal_peak;
+
+            // nonlinear signal -> linear light, relative to SDR white
+            std::vector<float> m_linearize_table;
+
+            // HLG only, scene luminance -> system gamma gain (the HLG OOTF)
+            std::vector<float> m_hlg_gain_table;
+
+            // linear brightness -> tone mapping gain
+            std::vector<float> m_curve_table;
+
+            // square root of linear light -> BT.709 gamma encoded
+            std::vector<float> m_gamma_table;
+    };
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <utility/thread_pool.h>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <cstdint>
+
+namespace Video
+{
+    /* Yuv_To_Rgb class
+     * Description: Converts 8 bit YUV420P frames to 32 bit BGRX pixels (AV_PIX_FMT_BGR0, SDL's XRGB8888 on little endian machines),
+     * without scaling. Used to write frames straight into a window surface when there is no GPU.
+     * The BT.601 / BT.709 matrix and limited / full range are taken from each frame, and the coefficients are kept as 16 bit fixed point,
+     * so SSE2 converts 8 pixels of a row at a time. Rows are split across a Thread_Pool.
+     *
+     * How to use:
+     * 1. check the pixel format with supported()
+     * 2. call process(source_frame, pixels, pitch), pixels must have room for source_frame's width and height
+     */
+    class Yuv_To_Rgb
+    {
+        public:
+            Yuv_To_Rgb(Utility::Thread_Pool&);
+            Yuv_To_Rgb(const Yuv_To_Rgb&) = delete;
+
+            static bool supported(enum AVPixelFormat);
+
+            int process(const AVFrame*, uint8_t*, int);
+
+        private:
+            void set_matrix(const AVFrame*);
+            void process_rows(const AVFrame*, uint8_t*, int, int, int);
+
+            Utility::Thread_Pool &m_thread_pool;
+
+            // what the coefficients are set up for
+            enum AVColorSpace m_colorspace;
+            enum AVColorRange m_range;
+            int m_height;
+
+            // fixed point coefficients, in 1/8192ths
+            int16_t m_luma_offset;
+            int16_t m_luma;
+            int16_t m_red_v;
+            int16_t m_green_u;
+            int16_t m_green_v;
+            int16_t m_blue_u;
+    };
+}
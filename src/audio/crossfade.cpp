@@ -0,0 +1,291 @@
+#include <audio/crossfade.h>
+#include <audio/mix.h>
+
+#include <string>
+#include <cstdlib>
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+namespace Audio
+{
+    // get the command line name of a curve
+    std::string crossfade_curve_name(Crossfade_Curve curve)
+    {
+        switch(curve)
+        {
+            case CROSSFADE_LINEAR:
+                return "linear";
+
+            case CROSSFADE_EQUAL_POWER:
+            default:
+                return "equal-power";
+        }
+    }
+
+    // parse a command line name into a curve, returns false if the name is unknown
+    bool parse_crossfade_curve(const std::string &name, Crossfade_Curve &curve)
+    {
+        for(int i{CROSSFADE_LINEAR}; i <= CROSSFADE_EQUAL_POWER; ++i)
+        {
+            if(name == crossfade_curve_name(static_cast<Crossfade_Curve>(i)))
+            {
+                curve = static_cast<Crossfade_Curve>(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // parse a command line duration in seconds, like 2 or 1.5, returns false if it's bad
+    bool parse_crossfade_duration(const std::string &seconds, double &duration)
+    {
+        if(seconds.empty() || seconds.size() > 6 || seconds.find_first_not_of("0123456789.") != std::string::npos ||
+           std::count(seconds.begin(), seconds.end(), '.') > 1 || seconds == ".")
+        {
+            return false;
+        }
+
+        duration = std::atof(seconds.c_str());
+
+        return true;
+    }
+
+    // Constructor
+    Crossfade::Crossfade() :
+        m_curve{CROSSFADE_EQUAL_POWER}, m_sample_rate{0}, m_channel_count{0},
+        m_buffer{}, m_capacity{0}, m_start{0}, m_length{0}, m_target{0},
+        m_scratch{}, m_silence{},
+        m_fading{false}, m_fade_length{0}, m_fade_position{0},
+        m_fades{0}, m_mix_seconds{0.0}, m_mixed_frames{0}
+    {}
+
+    /* set function
+     * Description: sets the crossfade up, and allocates the delay line, anything in it is dropped
+     * Parameter: duration - seconds the tracks overlap, 0 turns crossfading off
+     * Parameter: curve - how the gains change
+     * Parameter: sample_rate - sample rate of the audio
+     * Parameter: channel_count - channels of the interleaved audio
+     */
+    void Crossfade::set(double duration, Crossfade_Curve curve, int sample_rate, int channel_count)
+    {
+        m_curve = curve;
+        m_sample_rate = sample_rate;
+        m_channel_count = channel_count;
+
+        m_capacity = static_cast<std::size_t>(std::lround(std::max(duration, 0.0) * sample_rate));
+
+        m_buffer.assign(m_capacity * channel_count, 0.0f);
+        m_scratch.assign(MIX_BLOCK_FRAMES * channel_count, 0.0f);
+        m_silence.assign(MIX_BLOCK_FRAMES * channel_count, 0.0f);
+
+        clear();
+    }
+
+    /* push function
+     * Description: plays audio of the current track through the crossfade, during a fade it's mixed with the end of the previous track
+     * Parameter: samples - interleaved float frames
+     * Parameter: frames - the number of frames
+     * Parameter: writer - called with the frames that are ready to be played, a negative return value stops the push
+     * Return: the writer's negative return value, or 0
+     */
+    int Crossfade::push(const float *samples, std::size_t frames, const Writer &writer)
+    {
+        if(!enabled())
+        {
+            return frames ? writer(samples, frames) : 0;
+        }
+
+        int error{0};
+        std::size_t offset{0};
+
+        // the start of the track fades in over the end of the previous one, those frames are done and written right away
+        while(m_fading && offset != frames && error >= 0)
+        {
+            std::size_t count{std::min({frames - offset, m_length, m_capacity - m_start, MIX_BLOCK_FRAMES})};
+
+            error = mix(samples + offset * m_channel_count, count, writer);
+            offset += count;
+        }
+
+        // the rest goes through the delay line
+        while(offset != frames && error >= 0)
+        {
+            std::size_t count{std::min(frames - offset, m_capacity - m_length)};
+
+            // full, the oldest frames make room
+            if(count == 0)
+            {
+                error = pop(std::min(frames - offset, m_length), writer);
+                continue;
+            }
+
+            append(samples + offset * m_channel_count, count);
+            offset += count;
+
+            m_target = std::min(m_capacity, m_target + std::max(count / GROWTH_DIVISOR, static_cast<std::size_t>(1)));
+
+            if(m_length > m_target)
+            {
+                error = pop(m_length - m_target, writer);
+            }
+        }
+
+        return error;
+    }
+
+    // the next frames pushed are of a new track, they fade in over what's in the delay line, which fades out
+    void Crossfade::start_fade()
+    {
+        // a track shorter than the fade doesn't start another one, the next track carries on with the fade
+        if(!enabled() || m_fading || m_length == 0)
+        {
+            return;
+        }
+
+        m_fading = true;
+        m_fade_length = m_length;
+        m_fade_position = 0;
+        m_fades++;
+
+        // the new track fills the delay line from scratch
+        m_target = 0;
+    }
+
+    /* finish function
+     * Description: writes everything left in the delay line, a fade that didn't finish fades out to silence
+     * Parameter: writer - called with the frames
+     * Return: the writer's negative return value, or 0
+     */
+    int Crossfade::finish(const Writer &writer)
+    {
+        int error{0};
+
+        while(m_fading && error >= 0)
+        {
+            std::size_t count{std::min({m_length, m_capacity - m_start, MIX_BLOCK_FRAMES})};
+
+            error = mix(m_silence.data(), count, writer);
+        }
+
+        if(error >= 0)
+        {
+            error = pop(m_length, writer);
+        }
+
+        clear();
+
+        return error;
+    }
+
+    // drops the delay line, for when playback skips somewhere else
+    void Crossfade::clear()
+    {
+        m_start = 0;
+        m_length = 0;
+        m_target = 0;
+        m_fading = false;
+    }
+
+    // copies frames onto the end of the delay line, there has to be room
+    void Crossfade::append(const float *samples, std::size_t frames)
+    {
+        std::size_t end{(m_start + m_length) % m_capacity};
+        std::size_t first_part{std::min(frames, m_capacity - end)};
+
+        std::copy(samples, samples + first_part * m_channel_count, m_buffer.begin() + end * m_channel_count);
+        std::copy(samples + first_part * m_channel_count, samples + frames * m_channel_count, m_buffer.begin());
+
+        m_length += frames;
+    }
+
+    // writes the oldest frames of the delay line
+    int Crossfade::pop(std::size_t frames, const Writer &writer)
+    {
+        int error{0};
+
+        while(frames != 0 && error >= 0)
+        {
+            std::size_t count{std::min(frames, m_capacity - m_start)};
+
+            error = writer(&m_buffer[m_start * m_channel_count], count);
+
+            m_start = (m_start + count) % m_capacity;
+            m_length -= count;
+            frames -= count;
+        }
+
+        return error;
+    }
+
+    /* mix function
+     * Description: mixes frames of the new track with as many of the oldest frames in the delay line, and writes them.
+     * The gains are worked out exactly at both ends of the block, and ramp linearly in between
+     * Parameter: samples - the new track's frames, count of them, no more than MIX_BLOCK_FRAMES and the frames up to the end of the ring
+     */
+    int Crossfade::mix(const float *samples, std::size_t count, const Writer &writer)
+    {
+        float out_start{0.0f};
+        float in_start{0.0f};
+        float out_end{0.0f};
+        float in_end{0.0f};
+
+        gains(static_cast<double>(m_fade_position) / m_fade_length, out_start, in_start);
+        gains(static_cast<double>(m_fade_position + count) / m_fade_length, out_end, in_end);
+
+        std::size_t sample_count{count * m_channel_count};
+        float steps{static_cast<float>(sample_count)};
+
+        auto mix_start{std::chrono::steady_clock::now()};
+
+        crossfade_mix(&m_buffer[m_start * m_channel_count], samples, m_scratch.data(), sample_count,
+                      out_start, (out_end - out_start) / steps, in_start, (in_end - in_start) / steps);
+
+        std::chrono::duration<double> mix_time{std::chrono::steady_clock::now() - mix_start};
+        m_mix_seconds += mix_time.count();
+        m_mixed_frames += count;
+
+        m_start = (m_start + count) % m_capacity;
+        m_length -= count;
+        m_fade_position += count;
+
+        // all of the previous track is played
+        if(m_length == 0)
+        {
+            m_fading = false;
+        }
+
+        return writer(m_scratch.data(), count);
+    }
+
+    // gets the gains of the track fading out and the one fading in, at a position between 0 and 1 of the fade
+    void Crossfade::gains(double position, float &out_gain, float &in_gain) const
+    {
+        const double HALF_PI{1.57079632679489661923};
+
+        if(m_curve == CROSSFADE_LINEAR)
+        {
+            out_gain = static_cast<float>(1.0 - position);
+            in_gain = static_cast<float>(position);
+        }
+
+        else
+        {
+            out_gain = static_cast<float>(std::cos(position * HALF_PI));
+            in_gain = static_cast<float>(std::sin(position * HALF_PI));
+        }
+    }
+
+    // gets if tracks are crossfaded
+    bool Crossfade::enabled() const { return m_capacity != 0; }
+
+    // getters //
+    std::size_t Crossfade::delayed_frames() const { return m_length; }
+    int Crossfade::fades() const { return m_fades; }
+    double Crossfade::mix_seconds() const { return m_mix_seconds; }
+    double Crossfade::mixed_seconds() const { return m_sample_rate ? static_cast<double>(m_mixed_frames) / m_sample_rate : 0.0; }
+}
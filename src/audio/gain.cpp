@@ -0,0 +1,230 @@
+#include <audio/gain.h>
+#include <audio/mix.h>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+namespace Audio
+{
+    // gets the gain of a volume level in percent, the level is cubed so the steps sound about even
+    float volume_gain(int volume)
+    {
+        float level{static_cast<float>(std::min(std::max(volume, 0), MAX_VOLUME)) / MAX_VOLUME};
+
+        return level * level * level;
+    }
+
+    /* parse_volume function
+     * Parameter: argument - N, +N or -N, in percent
+     * Parameter: volume - the current level
+     * Parameter: new_volume - set to the new level, kept between 0 and MAX_VOLUME
+     * Return: false if the argument is bad
+     */
+    bool parse_volume(const std::string &argument, int volume, int &new_volume)
+    {
+        bool relative{!argument.empty() && (argument[0] == '+' || argument[0] == '-')};
+        std::string amount{relative ? argument.substr(1) : argument};
+
+        if(amount.empty() || amount.size() > 3 || amount.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return false;
+        }
+
+        int value{std::stoi(amount)};
+
+        if(relative)
+        {
+            value = argument[0] == '+' ? volume + value : volume - value;
+        }
+
+        new_volume = std::min(std::max(value, 0), MAX_VOLUME);
+
+        return true;
+    }
+
+    // Constructor, full volume, available until the output says otherwise
+    Volume_Control::Volume_Control() :
+        m_level{MAX_VOLUME}, m_available{true}
+    {}
+
+    // sets if the output can apply the volume
+    void Volume_Control::set_available(bool available)
+    {
+        std::atomic_store<bool>(&m_available, available);
+    }
+
+    // prints why the volume can't be changed, if it can't, returns false then
+    bool Volume_Control::check_available() const
+    {
+        if(!std::atomic_load<bool>(&m_available))
+        {
+            std::cout << "Volume isn't available, the audio device doesn't take float samples" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    /* command function
+     * Description: handles the volume commands, volume prints the level, volume N, volume +N and volume -N change it
+     * Parameter: command - a line read from the terminal
+     * Return: false if it isn't a volume command
+     */
+    bool Volume_Control::command(const std::string &command)
+    {
+        if(command != "volume" && command.rfind("volume ", 0) != 0)
+        {
+            return false;
+        }
+
+        if(!check_available())
+        {
+            return true;
+        }
+
+        if(command == "volume")
+        {
+            std::cout << "Volume: " << level() << "%" << std::endl;
+            return true;
+        }
+
+        int volume{0};
+
+        if(parse_volume(command.substr(7), level(), volume))
+        {
+            std::atomic_store<int>(&m_level, volume);
+            std::cout << "Volume: " << volume << "%" << std::endl;
+        }
+
+        else
+        {
+            std::cout << "Invalid volume, use volume N, volume +N or volume -N, in percent" << std::endl;
+        }
+
+        return true;
+    }
+
+    // changes the volume by a number of percent, kept between 0 and MAX_VOLUME
+    void Volume_Control::step(int step)
+    {
+        if(!check_available())
+        {
+            return;
+        }
+
+        int volume{std::min(std::max(level() + step, 0), MAX_VOLUME)};
+
+        std::atomic_store<int>(&m_level, volume);
+        std::cout << "Volume: " << volume << "%" << std::endl;
+    }
+
+    // gets the level in percent
+    int Volume_Control::level() const
+    {
+        return std::atomic_load<int>(&m_level);
+    }
+
+    // Constructor
+    Gain::Gain() :
+        m_channel_count{1}, m_ramp_frames{1}, m_target{1.0f}, m_current{1.0f}, m_processed{false}, m_buffer{}
+    {}
+
+    /* set_format function
+     * Description: sets the format of the audio processed
+     * Parameter: sample_rate - sample rate of the audio
+     * Parameter: channel_count - channels of the interleaved audio
+     */
+    void Gain::set_format(int sample_rate, int channel_count)
+    {
+        m_channel_count = channel_count;
+        m_ramp_frames = std::max(static_cast<std::size_t>(sample_rate) * RAMP_MS / 1000, static_cast<std::size_t>(1));
+    }
+
+    // sets the gain to ramp to, the first gain set before anything is processed is used right away
+    void Gain::set_gain(float gain)
+    {
+        m_target = gain;
+
+        if(!m_processed)
+        {
+            m_current = gain;
+        }
+    }
+
+    // sets the gain without a ramp, for a track boundary, where the previous gain must not reach into the new track
+    void Gain::reset(float gain)
+    {
+        m_target = gain;
+        m_current = gain;
+    }
+
+    /* process function
+     * Description: applies the gain to interleaved frames
+     * Parameter: samples - the frames
+     * Parameter: frames - the number of frames
+     * Return: samples at unity gain, otherwise the frames with the gain applied, valid until the next call
+     */
+    const float *Gain::process(const float *samples, std::size_t frames)
+    {
+        m_processed = true;
+
+        if(unity())
+        {
+            return samples;
+        }
+
+        std::size_t sample_count{frames * m_channel_count};
+
+        // only grows, and only until it fits the largest frame
+        if(m_buffer.size() < sample_count)
+        {
+            m_buffer.resize(sample_count);
+        }
+
+        std::size_t done{0};
+
+        if(m_current != m_target)
+        {
+            float distance{m_target - m_current};
+            std::size_t ramp_frames{static_cast<std::size_t>(std::ceil(std::fabs(distance) * m_ramp_frames))};
+
+            // the ramp ends in this block, the step is made to land right on the target
+            if(ramp_frames <= frames)
+            {
+                done = std::max(ramp_frames, static_cast<std::size_t>(1));
+                gain_clip(samples, m_buffer.data(), done * m_channel_count, m_current, distance / (done * m_channel_count));
+                m_current = m_target;
+            }
+
+            else
+            {
+                float step{(distance > 0.0f ? 1.0f : -1.0f) / (m_ramp_frames * m_channel_count)};
+
+                done = frames;
+                gain_clip(samples, m_buffer.data(), sample_count, m_current, step);
+                m_current += step * sample_count;
+            }
+        }
+
+        if(done != frames)
+        {
+            gain_clip(samples + done * m_channel_count, m_buffer.data() + done * m_channel_count, (frames - done) * m_channel_count, m_current, 0.0f);
+        }
+
+        return m_buffer.data();
+    }
+
+    // gets if the gain is 1 and not ramping, the audio is then passed through untouched
+    bool Gain::unity() const
+    {
+        return m_current == 1.0f && m_target == 1.0f;
+    }
+
+    // getters //
+    float Gain::gain() const { return m_target; }
+}
@@ -0,0 +1,97 @@
+#include <audio/mix.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include <cstddef>
+
+namespace Audio
+{
+    /* crossfade_mix function
+     * Parameter: first - the samples fading one way, usually out
+     * Parameter: second - the samples fading the other way, usually in
+     * Parameter: output - where the mix goes
+     * Parameter: count - number of samples, all channels
+     * Parameter: first_gain - gain of first's first sample
+     * Parameter: first_step - how much first's gain changes per sample
+     * Parameter: second_gain - gain of second's first sample
+     * Parameter: second_step - how much second's gain changes per sample
+     */
+    void crossfade_mix(const float *first, const float *second, float *output, std::size_t count,
+                       float first_gain, float first_step, float second_gain, float second_step)
+    {
+        std::size_t i{0};
+
+#ifdef __SSE__
+        // the gains are worked out from the sample index, so rounding errors don't add up along the block
+        const __m128 first_base{_mm_set1_ps(first_gain)};
+        const __m128 first_steps{_mm_set1_ps(first_step)};
+        const __m128 second_base{_mm_set1_ps(second_gain)};
+        const __m128 second_steps{_mm_set1_ps(second_step)};
+        const __m128 four{_mm_set1_ps(4.0f)};
+
+        __m128 index{_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)};
+
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128 gain_one{_mm_add_ps(first_base, _mm_mul_ps(index, first_steps))};
+            __m128 gain_two{_mm_add_ps(second_base, _mm_mul_ps(index, second_steps))};
+
+            __m128 mixed{_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(first + i), gain_one),
+                                    _mm_mul_ps(_mm_loadu_ps(second + i), gain_two))};
+
+            _mm_storeu_ps(output + i, mixed);
+
+            index = _mm_add_ps(index, four);
+        }
+#endif
+
+        // whatever is left, or everything without SSE
+        for(; i != count; ++i)
+        {
+            float position{static_cast<float>(i)};
+
+            output[i] = first[i] * (first_gain + position * first_step) + second[i] * (second_gain + position * second_step);
+        }
+    }
+
+    /* gain_clip function
+     * Parameter: input - the samples
+     * Parameter: output - where the samples with the gain applied go
+     * Parameter: count - number of samples, all channels
+     * Parameter: gain - gain of the first sample
+     * Parameter: step - how much the gain changes per sample, 0 for a constant gain
+     */
+    void gain_clip(const float *input, float *output, std::size_t count, float gain, float step)
+    {
+        std::size_t i{0};
+
+#ifdef __SSE__
+        const __m128 base{_mm_set1_ps(gain)};
+        const __m128 steps{_mm_set1_ps(step)};
+        const __m128 four{_mm_set1_ps(4.0f)};
+        const __m128 high{_mm_set1_ps(1.0f)};
+        const __m128 low{_mm_set1_ps(-1.0f)};
+
+        __m128 index{_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)};
+
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128 gains{_mm_add_ps(base, _mm_mul_ps(index, steps))};
+            __m128 samples{_mm_mul_ps(_mm_loadu_ps(input + i), gains)};
+
+            _mm_storeu_ps(output + i, _mm_max_ps(_mm_min_ps(samples, high), low));
+
+            index = _mm_add_ps(index, four);
+        }
+#endif
+
+        for(; i != count; ++i)
+        {
+            float sample{input[i] * (gain + static_cast<float>(i) * step)};
+
+            output[i] = sample > 1.0f ? 1.0f : (sample < -1.0f ? -1.0f : sample);
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#include <audio/output.h>
+#include <audio/crossfade.h>
+#include <audio/gain.h>
+#include <audio/replay_gain.h>
+#include <portaudio/portaudio.h>
+
+#include <cstddef>
+#include <cmath>
+#include <iostream>
+
+namespace Audio
+{
+    // Constructor
+    Output::Output() :
+        m_playback{}, m_float_output{false}, m_replay_gain{}, m_crossfade{}, m_volume{}
+    {}
+
+    /* set_format function
+     * Description: sets the stages up for the opened stream's format
+     * Return: false if the stream doesn't take float samples, then there is no ReplayGain, crossfading or volume
+     */
+    bool Output::set_format()
+    {
+        m_float_output = m_playback.sample_format() == paFloat32;
+
+        m_replay_gain.set_format(m_playback.sample_rate(), m_playback.channel_count());
+        m_volume.set_format(m_playback.sample_rate(), m_playback.channel_count());
+
+        if(!m_float_output)
+        {
+            std::cout << "The audio device doesn't take float samples, volume, ReplayGain and crossfading are off" << std::endl;
+        }
+
+        return m_float_output;
+    }
+
+    // sets the crossfade between tracks that end by themselves, 0 seconds turns it off, it's always off without float samples
+    void Output::set_crossfade(double duration, Crossfade_Curve curve)
+    {
+        m_crossfade.set(m_float_output ? duration : 0.0, curve, m_playback.sample_rate(), m_playback.channel_count());
+
+        if(m_crossfade.enabled())
+        {
+            std::cout << "Crossfade: " << duration << " seconds, " << crossfade_curve_name(curve) << std::endl;
+        }
+    }
+
+    /* set_replay_gain function
+     * Description: sets the ReplayGain of the track played next, and prints it
+     * The gain is jumped to, not ramped, so the previous track's gain doesn't reach into the first milliseconds of this one
+     * Parameter: has_replay_gain - false if the track has no ReplayGain tags, or they aren't used, it's played as it is
+     * Parameter: gain - the gain in dB
+     * Parameter: peak - the peak, 0 if unknown
+     */
+    void Output::set_replay_gain(bool has_replay_gain, double gain, double peak)
+    {
+        if(!has_replay_gain)
+        {
+            m_replay_gain.reset(1.0f);
+            return;
+        }
+
+        if(!m_float_output)
+        {
+            m_replay_gain.reset(1.0f);
+
+            std::cout << "ReplayGain: " << gain << " dB, peak " << peak << ", not applied, the audio device doesn't take float samples" << std::endl;
+            return;
+        }
+
+        m_replay_gain.reset(replay_gain_factor(gain, peak));
+
+        std::cout << "ReplayGain: " << gain << " dB, peak " << peak
+                  << ", gain applied: " << 20.0 * std::log10(m_replay_gain.gain()) << " dB" << std::endl;
+    }
+
+    /* play function
+     * Description: plays audio in the stream's format, which is interleaved, float audio goes through the stages
+     * Parameter: data - the audio
+     * Parameter: frames - the number of frames
+     * Parameter: volume - the volume in percent
+     * Return: a PortAudio error, paOutputUnderflowed if a blocking stream ran empty before the write
+     */
+    PaError Output::play(const void *data, std::size_t frames, int volume)
+    {
+        if(frames == 0)
+        {
+            return 0;
+        }
+
+        if(!m_float_output)
+        {
+            return m_playback.write(data, frames);
+        }
+
+        const float *samples{m_replay_gain.process(static_cast<const float*>(data), frames)};
+
+        if(!m_crossfade.enabled())
+        {
+            return write(samples, frames, volume);
+        }
+
+        return m_crossfade.push(samples, frames, [this, volume](const float *mixed, std::size_t mixed_frames)
+                                { return write_crossfaded(mixed, mixed_frames, volume); });
+    }
+
+    // plays what the crossfade still holds of the last track, at the volume in percent
+    PaError Output::finish(int volume)
+    {
+        return m_crossfade.finish([this, volume](const float *samples, std::size_t frames) { return write_crossfaded(samples, frames, volume); });
+    }
+
+    // the track ended by itself, the next one played fades in over its end
+    void Output::start_fade()
+    {
+        m_crossfade.start_fade();
+    }
+
+    // the track was skipped, the end of it still in the crossfade isn't played
+    void Output::clear()
+    {
+        m_crossfade.clear();
+    }
+
+    // prints the number of crossfades and what mixing them cost, if there were any
+    void Output::print_statistics() const
+    {
+        if(m_crossfade.fades() == 0)
+        {
+            return;
+        }
+
+        double mixed_seconds{m_crossfade.mixed_seconds()};
+
+        std::cout << "Crossfades: " << m_crossfade.fades() << ", " << mixed_seconds << " seconds mixed, mixing cost: "
+                  << (mixed_seconds > 0.0 ? m_crossfade.mix_seconds() * 1000000.0 / mixed_seconds : 0.0) << " us per second of audio" << std::endl;
+    }
+
+    // writes float frames to the stream at the volume in percent
+    PaError Output::write(const float *samples, std::size_t frames, int volume)
+    {
+        m_volume.set_gain(volume_gain(volume));
+
+        return m_playback.write(m_volume.process(samples, frames), frames);
+    }
+
+    // writes float frames coming out of the crossfade, an underrun isn't an error there, so the crossfade keeps going
+    PaError Output::write_crossfaded(const float *samples, std::size_t frames, int volume)
+    {
+        PaError error{write(samples, frames, volume)};
+
+        return error == paOutputUnderflowed ? 0 : error;
+    }
+
+    // getters //
+    PortAudio::Stream_Playback &Output::playback() { return m_playback; }
+    const Crossfade &Output::crossfade() const { return m_crossfade; }
+    bool Output::float_output() const { return m_float_output; }
+}
@@ -0,0 +1,137 @@
+#include <audio/replay_gain.h>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavutil/dict.h>
+}
+
+#include <string>
+#include <cstdlib>
+#include <cmath>
+
+namespace Audio
+{
+    // get the command line name of a mode
+    std::string replay_gain_mode_name(Replay_Gain_Mode mode)
+    {
+        switch(mode)
+        {
+            case REPLAY_GAIN_TRACK:
+                return "track";
+
+            case REPLAY_GAIN_ALBUM:
+                return "album";
+
+            case REPLAY_GAIN_OFF:
+            default:
+                return "off";
+        }
+    }
+
+    // parse a command line name into a mode, returns false if the name is unknown
+    bool parse_replay_gain_mode(const std::string &name, Replay_Gain_Mode &mode)
+    {
+        for(int i{REPLAY_GAIN_OFF}; i <= REPLAY_GAIN_ALBUM; ++i)
+        {
+            if(name == replay_gain_mode_name(static_cast<Replay_Gain_Mode>(i)))
+            {
+                mode = static_cast<Replay_Gain_Mode>(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // looks a tag up in the stream's tags, then in the file's, the lookup ignores case, returns nullptr if neither has it
+    static const char *find_tag(const AVFormatContext *format_context, const AVStream *stream, const char *key)
+    {
+        const AVDictionaryEntry *entry{av_dict_get(stream->metadata, key, nullptr, 0)};
+
+        if(!entry)
+        {
+            entry = av_dict_get(format_context->metadata, key, nullptr, 0);
+        }
+
+        return entry ? entry->value : nullptr;
+    }
+
+    // reads a gain in dB and a peak, a gain tag looks like "-6.48 dB", the peak is left alone if there is no peak tag
+    static bool read_tags(const AVFormatContext *format_context, const AVStream *stream, const char *gain_key, const char *peak_key, double &gain, double &peak)
+    {
+        const char *gain_tag{find_tag(format_context, stream, gain_key)};
+
+        if(!gain_tag)
+        {
+            return false;
+        }
+
+        gain = std::strtod(gain_tag, nullptr);
+
+        const char *peak_tag{find_tag(format_context, stream, peak_key)};
+
+        if(peak_tag)
+        {
+            peak = std::strtod(peak_tag, nullptr);
+        }
+
+        return true;
+    }
+
+    // reads an R128 gain, a Q7.8 number in dB relative to -23 LUFS, 5 dB quieter than the ReplayGain reference level
+    static bool read_r128_tag(const AVFormatContext *format_context, const AVStream *stream, const char *gain_key, double &gain)
+    {
+        const char *gain_tag{find_tag(format_context, stream, gain_key)};
+
+        if(!gain_tag)
+        {
+            return false;
+        }
+
+        gain = std::strtol(gain_tag, nullptr, 10) / 256.0 + 5.0;
+
+        return true;
+    }
+
+    /* read_replay_gain function
+     * Parameter: format_context - the opened file
+     * Parameter: stream - the audio stream played
+     * Parameter: mode - track or album gain
+     * Parameter: gain - set to the gain in dB
+     * Parameter: peak - set to the peak sample, 1 is full scale, 0 if unknown
+     * Return: true if the file has ReplayGain tags, false if it hasn't, or the mode is off
+     */
+    bool read_replay_gain(const AVFormatContext *format_context, const AVStream *stream, Replay_Gain_Mode mode, double &gain, double &peak)
+    {
+        peak = 0.0;
+
+        if(mode == REPLAY_GAIN_OFF)
+        {
+            return false;
+        }
+
+        if(mode == REPLAY_GAIN_ALBUM &&
+           (read_tags(format_context, stream, "REPLAYGAIN_ALBUM_GAIN", "REPLAYGAIN_ALBUM_PEAK", gain, peak) ||
+            read_r128_tag(format_context, stream, "R128_ALBUM_GAIN", gain)))
+        {
+            return true;
+        }
+
+        return read_tags(format_context, stream, "REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_TRACK_PEAK", gain, peak) ||
+               read_r128_tag(format_context, stream, "R128_TRACK_GAIN", gain);
+    }
+
+    // gets the linear gain of a ReplayGain in dB, lowered so the peak doesn't clip, a peak of 0 is unknown
+    float replay_gain_factor(double gain, double peak)
+    {
+        double factor{std::pow(10.0, gain / 20.0)};
+
+        if(peak > 0.0 && factor * peak > 1.0)
+        {
+            factor = 1.0 / peak;
+        }
+
+        return static_cast<float>(factor);
+    }
+}
@@ -0,0 +1,276 @@
+#include <ffmpeg/audio_converter.h>
+#include <ffmpeg/resample.h>
+#include <ffmpeg/frame.h>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/error.h>
+#include <libswresample/swresample.h>
+}
+
+#include <cstdint>
+#include <cerrno>
+
+namespace FFmpeg
+{
+    // Constructor
+    Audio_Converter::Audio_Converter() :
+        m_resampler{}, m_output{}, m_output_capacity{0}, m_converted{nullptr},
+        m_output_channel_count{0}, m_output_channel_layout{0}, m_output_sample_rate{0}, m_output_format{AV_SAMPLE_FMT_NONE},
+        m_input_channel_layout{0}, m_input_sample_rate{0}, m_input_format{AV_SAMPLE_FMT_NONE},
+        m_reconfigurations{0}, m_allocations{0}, m_late_allocations{0}, m_restarts{0}
+    {}
+
+    /* set_output function
+     * Description: sets the format frames are converted to, the resampler is set up again with the next frame
+     * Parameter: channel_count - output channels, they get the default layout for that count
+     * Parameter: sample_rate - output sample rate
+     * Parameter: format - output sample format
+     */
+    void Audio_Converter::set_output(int channel_count, int sample_rate, enum AVSampleFormat format)
+    {
+        m_output_channel_count = channel_count;
+        m_output_channel_layout = av_get_default_channel_layout(channel_count);
+        m_output_sample_rate = sample_rate;
+        m_output_format = format;
+
+        m_input_format = AV_SAMPLE_FMT_NONE;
+
+        // the output buffer is in the old format
+        m_output_capacity = 0;
+    }
+
+    /* configure function
+     * Description: sets the resampler up for the input frame's format, the samples the old setup held back are dropped, well under a millisecond
+     * Return: negative FFmpeg error on failure, a value >= 0 on success
+     */
+    int Audio_Converter::configure(const AVFrame *input, int64_t input_channel_layout)
+    {
+        m_input_channel_layout = input_channel_layout;
+        m_input_sample_rate = input->sample_rate;
+        m_input_format = static_cast<enum AVSampleFormat>(input->format);
+
+        m_resampler = swr_alloc_set_opts(m_resampler,                 // resampling context, reused
+                                         m_output_channel_layout,      // out channel layout
+                                         m_output_format,              // out sample format
+                                         m_output_sample_rate,         // out sample rate
+                                         m_input_channel_layout,       // in channel layout
+                                         m_input_format,               // in sample format
+                                         m_input_sample_rate,          // in sample rate
+                                         0,                            // log offset
+                                         nullptr);                     // log context
+        if(!m_resampler)
+        {
+            m_input_format = AV_SAMPLE_FMT_NONE;
+            return AVERROR(ENOMEM);
+        }
+
+        if(!m_output)
+        {
+            m_output = av_frame_alloc();
+            if(!m_output)
+            {
+                return AVERROR(ENOMEM);
+            }
+        }
+
+        m_reconfigurations++;
+
+        int error{swr_init(m_resampler)};
+        if(error < 0)
+        {
+            m_input_format = AV_SAMPLE_FMT_NONE;
+        }
+
+        return error;
+    }
+
+    /* reserve function
+     * Description: makes sure the output buffer holds the given number of samples, only allocates if it doesn't yet
+     * Parameter: sample_count - samples per channel
+     * Return: negative FFmpeg error on failure, a value >= 0 on success
+     */
+    int Audio_Converter::reserve(int sample_count)
+    {
+        if(sample_count <= m_output_capacity)
+        {
+            return 0;
+        }
+
+        av_frame_unref(m_output);
+
+        m_output->channel_layout = m_output_channel_layout;
+        m_output->channels = m_output_channel_count;
+        m_output->sample_rate = m_output_sample_rate;
+        m_output->format = static_cast<int>(m_output_format);
+        m_output->nb_samples = sample_count;
+
+        int error{av_frame_get_buffer(m_output, 0)};
+        if(error < 0)
+        {
+            m_output_capacity = 0;
+            return error;
+        }
+
+        // a frame bigger than any before it
+        if(m_output_capacity != 0)
+        {
+            m_late_allocations++;
+        }
+
+        m_output_capacity = sample_count;
+        m_allocations++;
+
+        return error;
+    }
+
+    /* resample function
+     * Description: resamples into the output buffer with swr_convert, the buffer is reused, swr_convert_frame would allocate a new one every call
+     * Parameter: input - the input's channel pointers, nullptr to get what the resampler holds back
+     * Parameter: input_sample_count - samples per channel in the input
+     * Return: negative FFmpeg error on failure, a value >= 0 on success
+     */
+    int Audio_Converter::resample(const uint8_t **input, int input_sample_count)
+    {
+        // the most the resampler can give for this input, with what it holds back
+        int sample_count{swr_get_out_samples(m_resampler, input_sample_count)};
+        if(sample_count < 0)
+        {
+            return sample_count;
+        }
+
+        int error{reserve(sample_count)};
+        if(error < 0)
+        {
+            return error;
+        }
+
+        // nothing was ever converted, there is no buffer to give
+        if(m_output_capacity == 0)
+        {
+            m_output->nb_samples = 0;
+            m_converted = m_output;
+            return 0;
+        }
+
+        int converted_count{swr_convert(m_resampler, m_output->extended_data, m_output_capacity, input, input_sample_count)};
+        if(converted_count < 0)
+        {
+            return converted_count;
+        }
+
+        m_output->nb_samples = converted_count;
+        m_converted = m_output;
+
+        return converted_count;
+    }
+
+    /* convert function
+     * Description: converts a frame to the output format, the result is in converted() until the next call
+     * Parameter: input - a decoded frame, a missing channel layout is filled in
+     * Return: negative FFmpeg error on failure, a value >= 0 on success
+     */
+    int Audio_Converter::convert(AVFrame *input)
+    {
+        m_converted = nullptr;
+
+        // some files, like .wav files, have no channel layout
+        int64_t input_channel_layout{static_cast<int64_t>(input->channel_layout)};
+        if(input_channel_layout == 0 || av_get_channel_layout_nb_channels(input->channel_layout) != input->channels)
+        {
+            input_channel_layout = av_get_default_channel_layout(input->channels);
+        }
+
+        // already in the output format, and there's nothing left in the resampler to come first
+        if(input->format == m_output_format && input->sample_rate == m_output_sample_rate && input_channel_layout == m_output_channel_layout &&
+           (m_input_format == AV_SAMPLE_FMT_NONE || swr_get_delay(m_resampler, m_output_sample_rate) == 0))
+        {
+            m_converted = input;
+            return 0;
+        }
+
+        int error{0};
+
+        if(input->format != m_input_format || input->sample_rate != m_input_sample_rate || input_channel_layout != m_input_channel_layout)
+        {
+            error = configure(input, input_channel_layout);
+            if(error < 0)
+            {
+                return error;
+            }
+        }
+
+        return resample(const_cast<const uint8_t**>(input->extended_data), input->nb_samples);
+    }
+
+    /* flush function
+     * Description: gets the samples the resampler still holds back, into converted(), call at the end of a track,
+     * the resampler is ready for the next one after
+     * Return: negative FFmpeg error on failure, a value >= 0 on success
+     */
+    int Audio_Converter::flush()
+    {
+        m_converted = nullptr;
+
+        if(m_input_format == AV_SAMPLE_FMT_NONE)
+        {
+            return 0;
+        }
+
+        int error{resample(nullptr, 0)};
+        if(error < 0)
+        {
+            return error;
+        }
+
+        // a flushed resampler pads its input, it has to start over before taking more
+        m_restarts++;
+        error = swr_init(m_resampler);
+        if(error < 0)
+        {
+            m_input_format = AV_SAMPLE_FMT_NONE;
+        }
+
+        return error;
+    }
+
+    /* reset function
+     * Description: throws away the samples the resampler holds back, the setup and output buffer are kept,
+     * converted() is cleared
+     * Return: negative FFmpeg error on failure, a value >= 0 on success
+     */
+    int Audio_Converter::reset()
+    {
+        m_converted = nullptr;
+
+        if(m_input_format == AV_SAMPLE_FMT_NONE)
+        {
+            return 0;
+        }
+
+        // setting it up again clears it
+        m_restarts++;
+        int error{swr_init(m_resampler)};
+        if(error < 0)
+        {
+            m_input_format = AV_SAMPLE_FMT_NONE;
+        }
+
+        return error;
+    }
+
+    // gets the converted frame, nullptr if the last conversion failed
+    const AVFrame *Audio_Converter::converted() const { return m_converted; }
+
+    // getters //
+    int Audio_Converter::channel_count() const { return m_output_channel_count; }
+    int Audio_Converter::sample_rate() const { return m_output_sample_rate; }
+    enum AVSampleFormat Audio_Converter::sample_format() const { return m_output_format; }
+    int Audio_Converter::reconfigurations() const { return m_reconfigurations; }
+    int Audio_Converter::allocations() const { return m_allocations; }
+    int Audio_Converter::late_allocations() const { return m_late_allocations; }
+    int Audio_Converter::restarts() const { return m_restarts; }
+}
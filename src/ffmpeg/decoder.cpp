@@ -8,6 +8,7 @@ extern "C"
 }
 
 #include <string>
+#include <functional>
 
 namespace FFmpeg
 {
@@ -16,7 +17,7 @@ namespace FFmpeg
     Decoder::Decoder() :
         m_fmt_ctx{nullptr}, m_codec{nullptr}, m_codec_ctx{nullptr},
         m_packet{nullptr}, m_frame{nullptr}, m_filename{"DECODER CLASS DEFAULT FILENAME"}, 
-        m_stream_number{-1}
+        m_stream_number{-1}, m_side_stream_number{-1}, m_side_packet_handler{}
     {}
 
     // Deconstructor
@@ -155,6 +156,12 @@ namespace FFmpeg
             // if the data contained in the packet is not from the right stream
             if(m_packet->stream_index != m_stream_number)
             {
+                // packets of the side stream are given to it's handler first
+                if(m_packet->stream_index == m_side_stream_number && m_side_packet_handler)
+                {
+                    m_side_packet_handler(m_packet);
+                }
+
                 // unreference the packet
                 av_packet_unref(m_packet);
             }
@@ -180,6 +187,16 @@ namespace FFmpeg
         return error;
     }
 
+    /* flush() function
+     * Description: tells the decoder the end of the stream was reached, once send_packet() returned AVERROR_EOF.
+     * receive_frame() then returns the frames the decoder still holds back, and AVERROR_EOF after the last one
+     * Return: FFmpeg error code, or a value >= 0 on success
+     */
+    int Decoder::flush()
+    {
+        return avcodec_send_packet(m_codec_ctx, nullptr);
+    }
+
     /* receive_frame() function
      * Description: Reads a frame from the decoder and puts into output_frame
      * Paramter: output_frame - the output for the read frame
@@ -236,6 +253,21 @@ namespace FFmpeg
 
         m_filename = "DECODER CLASS DEFAULT FILENAME";
         m_stream_number = -1;
+
+        m_side_stream_number = -1;
+        m_side_packet_handler = nullptr;
+    }
+
+    /* set_side_stream function
+     * Description: makes send_packet() give the packets of another stream to handler, instead of just throwing them away
+     * The handler is called on the thread calling send_packet(), and must not keep the packet, it is unreferenced afterwards
+     * Parameter: stream_number - the index of the other stream, -1 to stop handing out packets
+     * Parameter: handler - the function to call with each packet of the stream
+     */
+    void Decoder::set_side_stream(int stream_number, std::function<void(AVPacket*)> handler)
+    {
+        m_side_stream_number = stream_number;
+        m_side_packet_handler = handler;
     }
 
 
@@ -38,13 +38,21 @@ namespace FFmpeg
     // Parameter: width - width of the image to allocate
     // Parameter: height - height of the image to allocate
     // Returns: -1111 if failed to allocate the AVFrame, otherwise FFmpeg error code, a value >= 0 on success
-    // If called more than once on the same frame memory will be leaked
+    // If called more than once on the same frame the old image buffer is released and a new one is allocated
     int Frame::allocate(enum AVPixelFormat pixel_format, int width, int height)
     {
-        m_frame = av_frame_alloc();
-        if(!m_frame)
+        if(m_frame)
         {
-            return -1111;
+            av_frame_unref(m_frame);
+        }
+
+        else
+        {
+            m_frame = av_frame_alloc();
+            if(!m_frame)
+            {
+                return -1111;
+            }
         }
 
         int error{0};
@@ -71,6 +79,38 @@ namespace FFmpeg
         return error;
     }
 
+    // reference function
+    // Description: makes m_frame reference the image of src_frame instead of copying it, the old image is released first
+    // Returns: -1111 if failed to allocate the AVFrame, otherwise FFmpeg error code, a value >= 0 on success
+    int Frame::reference(const AVFrame *src_frame)
+    {
+        if(m_frame)
+        {
+            av_frame_unref(m_frame);
+        }
+
+        else
+        {
+            m_frame = av_frame_alloc();
+            if(!m_frame)
+            {
+                return -1111;
+            }
+        }
+
+        return av_frame_ref(m_frame, src_frame);
+    }
+
+    // checks if m_frame holds a writable image buffer with the given parameters
+    // a buffer still shared with another frame, like one referenced from the decoder, never matches
+    bool Frame::matches(enum AVPixelFormat pixel_format, int width, int height) const
+    {
+        return m_frame && m_frame->buf[0] && av_frame_is_writable(m_frame) &&
+               m_frame->format == static_cast<int>(pixel_format) &&
+               m_frame->width == width &&
+               m_frame->height == height;
+    }
+
     // getters //
     AVFrame *Frame::frame() { return m_frame; }
     const AVFrame *Frame::frame() const { return m_frame; }
@@ -0,0 +1,142 @@
+#include <ffmpeg/subtitle_decoder.h>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+}
+
+namespace FFmpeg
+{
+    // checks if a codec decodes into bitmaps, only those subtitles can be shown as an overlay
+    static bool bitmap_subtitle_codec(enum AVCodecID codec_id)
+    {
+        return codec_id == AV_CODEC_ID_HDMV_PGS_SUBTITLE || // Blu-ray
+               codec_id == AV_CODEC_ID_DVB_SUBTITLE ||      // DVB broadcasts
+               codec_id == AV_CODEC_ID_DVD_SUBTITLE;        // DVD
+    }
+
+    // Constructor
+    Subtitle_Decoder::Subtitle_Decoder() : m_codec_ctx{nullptr}, m_stream_number{-1}
+    {}
+
+    // Deconstructor
+    Subtitle_Decoder::~Subtitle_Decoder()
+    {
+        free_resources();
+    }
+
+    /* find_stream function
+     * Description: Finds a bitmap subtitle stream (PGS, DVB or DVD) in the opened file, a stream marked as default is preferred
+     * Parameter: format_context - the format context of the opened file
+     * Parameter: related_stream - the video stream the subtitles are for, only used for a stream's program if there are several
+     * Return: AVERROR_STREAM_NOT_FOUND if the file has no bitmap subtitle stream, otherwise the stream index
+     */
+    int Subtitle_Decoder::find_stream(const AVFormatContext *format_context, int related_stream)
+    {
+        int error{av_find_best_stream(const_cast<AVFormatContext*>(format_context), AVMEDIA_TYPE_SUBTITLE, -1, related_stream, nullptr, 0)};
+
+        // the best subtitle stream may be a text one, then look for the first default, or any, bitmap stream
+        if(error < 0 || !bitmap_subtitle_codec(format_context->streams[error]->codecpar->codec_id))
+        {
+            error = AVERROR_STREAM_NOT_FOUND;
+
+            for(unsigned int i{0}; i != format_context->nb_streams; ++i)
+            {
+                const AVStream *stream{format_context->streams[i]};
+
+                if(stream->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE || !bitmap_subtitle_codec(stream->codecpar->codec_id))
+                {
+                    continue;
+                }
+
+                if(error < 0 || (stream->disposition & AV_DISPOSITION_DEFAULT))
+                {
+                    error = static_cast<int>(i);
+                }
+
+                if(stream->disposition & AV_DISPOSITION_DEFAULT)
+                {
+                    break;
+                }
+            }
+        }
+
+        m_stream_number = error >= 0 ? error : -1;
+
+        return error;
+    }
+
+    /* init_codec_context() function
+     * Description: Initializes an AVCodecContext for decoding the selected subtitle stream
+     * Parameter: format_context - the format context of the opened file
+     * Return: -1111 on failed AVCodecContext allocation, or failed to find a AVCodec for decoding, otherwise FFmpeg error code, or a value >= 0 on success
+     */
+    int Subtitle_Decoder::init_codec_context(const AVFormatContext *format_context)
+    {
+        const AVStream *stream{format_context->streams[m_stream_number]};
+
+        const AVCodec *codec{avcodec_find_decoder(stream->codecpar->codec_id)};
+        if(!codec)
+        {
+            return -1111;
+        }
+
+        m_codec_ctx = avcodec_alloc_context3(codec);
+        if(!m_codec_ctx)
+        {
+            return -1111;
+        }
+
+        int error{0};
+
+        error = avcodec_parameters_to_context(m_codec_ctx, stream->codecpar);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        // subtitle timestamps come out in AV_TIME_BASE units, the decoder needs the stream's timebase for that
+        m_codec_ctx->pkt_timebase = stream->time_base;
+
+        error = avcodec_open2(m_codec_ctx, codec, nullptr);
+
+        return error;
+    }
+
+    /* decode function
+     * Description: decodes a packet of the subtitle stream
+     * Parameter: packet - a packet of the selected stream
+     * Parameter: subtitle - output, has to be freed with avsubtitle_free() if a subtitle was decoded
+     * Return: FFmpeg error code on failure, 0 if the packet didn't complete a subtitle, a value > 0 if a subtitle was decoded
+     */
+    int Subtitle_Decoder::decode(AVPacket *packet, AVSubtitle *subtitle)
+    {
+        int got_subtitle{0};
+
+        int error{avcodec_decode_subtitle2(m_codec_ctx, subtitle, &got_subtitle, packet)};
+        if(error < 0)
+        {
+            return error;
+        }
+
+        return got_subtitle;
+    }
+
+    // Frees all allocated / initialized resources
+    void Subtitle_Decoder::free_resources()
+    {
+        if(m_codec_ctx)
+        {
+            avcodec_free_context(&m_codec_ctx);
+        }
+
+        m_stream_number = -1;
+    }
+
+    // Getters //
+    const AVCodecContext *Subtitle_Decoder::codec_context() const { return m_codec_ctx; }
+
+    int Subtitle_Decoder::stream_number() const { return m_stream_number; }
+}
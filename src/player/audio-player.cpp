@@ -1,8 +1,21 @@
 #include <ffmpeg/decoder.h>
-#include <ffmpeg/resample.h>
+#include <ffmpeg/audio_converter.h>
 #include <ffmpeg/frame.h>
 #include <portaudio/portaudio.h>
 #include <utility/utility.h>
+#include <utility/ring_buffer.h>
+#include <utility/latency_governor.h>
+#include <audio/crossfade.h>
+#include <audio/gain.h>
+#include <audio/replay_gain.h>
+#include <audio/output.h>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/dict.h>
+#include <libavutil/samplefmt.h>
+}
 
 #include <iostream>
 #include <string>
@@ -16,6 +29,11 @@
 #include <vector>
 #include <algorithm>
 #include <ctime>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <deque>
+#include <chrono>
 
 void interrupt_signal(int signal)
 {
@@ -31,10 +49,93 @@ void terminate_signal(int signal)
     std::exit(1);
 }
 
-void listen_thread_func(std::atomic<bool>*, std::atomic<bool>*, std::size_t*, std::condition_variable*);
+// Track struct, an opened file being decoded
+struct Track
+{
+    std::size_t index; // index of the file
+
+    FFmpeg::Decoder decoder;
+
+    // the frame to play next, owned by the decoder
+    AVFrame *decoded_frame;
+
+    // the end of the file was reached, and the decoder was told so
+    bool flushed;
+
+    int channel_count;
+    int sample_rate;
+
+    // encoder delay still to skip, it may cover more than one frame, and the delay / padding samples skipped so far
+    int64_t skip_samples;
+    int64_t skipped_delay;
+    int64_t skipped_padding;
+
+    // ReplayGain read from the tags, in dB, and the peak, 0 if unknown
+    bool has_replay_gain;
+    double replay_gain;
+    double replay_gain_peak;
+};
+
+// Track_Mark struct, where in the decoded audio a track starts or ends, the output reports it when it plays up to there
+struct Track_Mark
+{
+    unsigned long long position; // frames into the decoded audio
+    bool end;                    // the end of a track decoded to its end, otherwise the start of a track
+    std::size_t index;
+
+    // start of a track
+    int channel_count;
+    int sample_rate;
+    bool has_replay_gain;
+    double replay_gain;
+    double replay_gain_peak;
+
+    // end of a track
+    int64_t skipped_delay;
+    int64_t skipped_padding;
+};
+
+// Decode_Ahead struct, the audio decoded ahead of the output by the decoding thread, so slow reads and decodes aren't heard.
+// The decoding thread converts the tracks into the buffer in the stream's format, the output only plays from it
+struct Decode_Ahead
+{
+    Utility::Ring_Buffer buffer;
+
+    std::mutex mutex;
+    std::condition_variable changed; // audio was written or read, a mark added, or the decoding thread was told to stop
+
+    // guarded by the mutex
+    std::deque<Track_Mark> marks;
+    std::size_t start_index;  // track the decoding thread starts at
+    bool finished;            // every track is decoded
+    bool stop;                // the output wants the decoding thread to stop, to start again at start_index
+    bool stopped;             // the decoding thread stopped, the buffer can be emptied
+    bool quit;
+
+    // decoding thread only, or restart_decoding() while it's stopped, read once it's joined
+    FFmpeg::Audio_Converter converter;
+    Audio::Replay_Gain_Mode replay_gain_mode;
+    double decode_seconds;   // spent opening, decoding and converting
+    double decoded_seconds;  // audio decoded
+};
+
+void listen_thread_func(std::atomic<bool>*, std::atomic<bool>*, std::atomic<long>*, const std::atomic<std::size_t>*, std::condition_variable*, Audio::Volume_Control*);
 
 void shuffle_vector(std::vector<std::string>&);
 
+void decode_thread_func(Decode_Ahead*, const std::vector<std::string>*);
+void restart_decoding(Decode_Ahead&, std::size_t);
+void add_mark(Decode_Ahead&, const Track_Mark&);
+bool write_decoded(Decode_Ahead&, const AVFrame*, unsigned long long&);
+
+int open_track(Track&, const std::string&, Audio::Replay_Gain_Mode);
+int decode_frame(Track&);
+void trim_frame(AVFrame*, int, int);
+int convert_frame(Track&, FFmpeg::Audio_Converter&);
+
+// frames the output plays at a time from the decoded audio
+const std::size_t OUTPUT_BLOCK_FRAMES{1024};
+
 int main(int argc, char **argv)
 {
     if(argc < 2)
@@ -42,6 +143,10 @@ int main(int argc, char **argv)
         std::cerr << "Invalid Usage" << std::endl;
         std::cerr << "Valid Usage: " << argv[0] << " <shuffle> <files1> <file2> <file3> ..." << std::endl;
         std::cerr << "To shuffle: --shuffle" << std::endl;;
+        std::cerr << "To crossfade tracks: --crossfade=SECONDS --crossfade-curve=linear|equal-power" << std::endl;
+        std::cerr << "To apply ReplayGain: --replaygain=off|track|album" << std::endl;
+        std::cerr << "To decode further ahead: --decode-ahead=MS, default 1000" << std::endl;
+        std::cerr << "To set the output latency: --latency=MS, default 50, or --latency=auto to start low and raise it after underruns" << std::endl;
         return 1;
     }
 
@@ -49,6 +154,18 @@ int main(int argc, char **argv)
 
     bool shuffling{false};
 
+    double crossfade_duration{0.0};
+    Audio::Crossfade_Curve crossfade_curve{Audio::CROSSFADE_EQUAL_POWER};
+
+    Audio::Replay_Gain_Mode replay_gain_mode{Audio::REPLAY_GAIN_OFF};
+
+    // milliseconds of audio decoded ahead of the output
+    int decode_ahead_ms{1000};
+
+    // suggested output latency in seconds, or the one automatic mode starts at
+    double latency{0.05};
+    bool automatic_latency{false};
+
     for(int i{1}; i != argc; ++i)
     {
         std::string current_file{argv[i]};
@@ -58,6 +175,55 @@ int main(int argc, char **argv)
             shuffling = true;
         }
 
+        else if(current_file.rfind("--crossfade=", 0) == 0)
+        {
+            if(!Audio::parse_crossfade_duration(current_file.substr(12), crossfade_duration))
+            {
+                std::cerr << "Bad crossfade duration: " << current_file.substr(12) << std::endl;
+                return 1;
+            }
+        }
+
+        else if(current_file.rfind("--crossfade-curve=", 0) == 0)
+        {
+            if(!Audio::parse_crossfade_curve(current_file.substr(18), crossfade_curve))
+            {
+                std::cerr << "Unknown crossfade curve: " << current_file.substr(18) << std::endl;
+                return 1;
+            }
+        }
+
+        else if(current_file.rfind("--replaygain=", 0) == 0)
+        {
+            if(!Audio::parse_replay_gain_mode(current_file.substr(13), replay_gain_mode))
+            {
+                std::cerr << "Unknown ReplayGain mode: " << current_file.substr(13) << std::endl;
+                return 1;
+            }
+        }
+
+        else if(current_file.rfind("--decode-ahead=", 0) == 0)
+        {
+            std::string amount{current_file.substr(15)};
+
+            if(amount.empty() || amount.size() > 6 || amount.find_first_not_of("0123456789") != std::string::npos || std::stoi(amount) == 0)
+            {
+                std::cerr << "Bad decode ahead amount: " << amount << std::endl;
+                return 1;
+            }
+
+            decode_ahead_ms = std::stoi(amount);
+        }
+
+        else if(current_file.rfind("--latency=", 0) == 0)
+        {
+            if(!Utility::parse_latency(current_file.substr(10), latency, automatic_latency))
+            {
+                std::cerr << "Bad latency: " << current_file.substr(10) << std::endl;
+                return 1;
+            }
+        }
+
         else
         {
             files.push_back(current_file);
@@ -83,228 +249,324 @@ int main(int argc, char **argv)
     std::cout << "play" << std::endl;
     std::cout << "next" << std::endl;
     std::cout << "prev" << std::endl;
+    std::cout << "volume [N|+N|-N]" << std::endl;
+
+    // the stream is opened once, in the device's own format, and stays open from one track to the next, so they follow each other without a gap
+    Audio::Output output{};
+    PortAudio::Stream_Playback &playback{output.playback()};
+
+    // set by the listening thread
+    Audio::Volume_Control volume{};
+
+    std::atomic<bool> paused{false};
+    std::atomic<bool> skipping{false};
+    std::condition_variable cv{};
+    std::mutex mutex{};
+
+    // the track playing, only the playback loop changes it, and publishes it for the listening thread
+    std::size_t i{0};
+    std::atomic<std::size_t> playing_index{0};
+
+    // tracks to move by, asked for by the listening thread, the playback loop takes it when skipping
+    std::atomic<long> skip_request{0};
+
+    // one listening thread for all tracks
+    std::thread listen_thread{listen_thread_func,
+                              &paused,
+                              &skipping,
+                              &skip_request,
+                              &playing_index,
+                              &cv,
+                              &volume};
+    listen_thread.detach();
+
+    PaError stream_error{0};
+
+    // use default host api
+    stream_error = playback.set_host_api_index(-1);
+    Utility::portaudio_error_assert((stream_error >= 0), "Failed to set host api", stream_error);
+
+    // set device index
+    stream_error = playback.set_device_index(-1);
+    Utility::portaudio_error_assert((stream_error >= 0), "Failed to set device", stream_error);
+
+    // counts the underruns, and in automatic mode raises the latency when they keep happening
+    Utility::Latency_Governor latency_governor{latency, automatic_latency};
+
+    stream_error = playback.open_native_stream(latency_governor.latency(), paNoFlag);
+    Utility::portaudio_error_assert((stream_error >= 0), "Failed to open stream", stream_error);
+
+    stream_error = playback.start_stream();
+    Utility::portaudio_error_assert((stream_error >= 0), "Failed to start playback stream", stream_error);
+
+    std::cout << "Output: " << playback.channel_count() << " channels, " << playback.sample_rate() << " Hz, "
+              << av_get_sample_fmt_name(Utility::ffmpeg_sample_format(playback.sample_format())) << ", latency: " << playback.actual_latency() << std::endl;
+
+    // tracks that end by themselves are crossfaded into the next one, the mixing and gains are done on the converted float audio
+    output.set_format();
+    volume.set_available(output.float_output());
+    output.set_crossfade(crossfade_duration, crossfade_curve);
+
+    // the tracks are decoded on their own thread, ahead of the output, the output only plays what's decoded
+    Decode_Ahead ahead{};
+    ahead.buffer.allocate(static_cast<std::size_t>(playback.sample_rate()) * decode_ahead_ms / 1000,
+                          playback.channel_count(), Pa_GetSampleSize(playback.sample_format()));
+    ahead.start_index = 0;
+    ahead.finished = false;
+    ahead.stop = false;
+    ahead.stopped = false;
+    ahead.quit = false;
+    ahead.replay_gain_mode = replay_gain_mode;
+    ahead.decode_seconds = 0.0;
+    ahead.decoded_seconds = 0.0;
+
+    // every track is converted to the stream's format, the resampler is only set up again when the source format changes
+    ahead.converter.set_output(playback.channel_count(), playback.sample_rate(), Utility::ffmpeg_sample_format(playback.sample_format()));
+
+    std::thread decode_thread{decode_thread_func, &ahead, &files};
+
+    std::vector<uint8_t> block(OUTPUT_BLOCK_FRAMES * ahead.buffer.frame_size());
+    unsigned long long frames_read{0};
+
+    // how far ahead decoding stays, from when the buffer first filled up, after starting or skipping
+    bool buffer_filled{false};
+    bool fill_measured{false};
+    std::size_t lowest_fill{ahead.buffer.capacity()};
+    unsigned long times_empty{0};
 
-    for(std::size_t i{0}; i != files.size(); ++i)
+    while(1)
     {
-        FFmpeg::Decoder decoder{};
-        FFmpeg::Resample resampler{};
+        if(std::atomic_load<bool>(&paused))
+        {
+            // stop the playback stream, decoding goes on until the buffer is full
+            stream_error = playback.stop_stream();
+            Utility::portaudio_error_assert((stream_error >= 0), "Failed to stop playback stream", stream_error);
 
-        int error{0};
+            if(!std::atomic_load<bool>(&skipping))
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                cv.wait(lock);
+                lock.unlock();
+
+                // start the stream
+                if(!std::atomic_load<bool>(&skipping))
+                {
+                    stream_error = playback.start_stream();
+                    Utility::portaudio_error_assert((stream_error >= 0), "Failed to start playback stream", stream_error);
+                }
+            }
+        }
 
-        // open the file
-        error = decoder.init_format_context(files.at(i), nullptr);
-        Utility::error_assert((error >= 0), "Failed to open file", error);
+        // the listening thread paused playback to skip, the track skipped to plays right away, without the end of this one
+        if(std::atomic_load<bool>(&skipping))
+        {
+            std::atomic_store<bool>(&skipping, false);
+            std::atomic_store<bool>(&paused, false);
 
-        // find a stream
-        error = decoder.find_stream(AVMEDIA_TYPE_AUDIO);
-        Utility::error_assert((error >= 0), "Failed to find stream", error);
+            output.clear();
 
-        // start the decoder
-        error = decoder.init_codec_context(nullptr, 1);
-        Utility::error_assert((error >= 0), "Failed to initialize codec", error);
+            // next asks for +1, prev for -1, skips asked for in a row add up
+            long skip{std::atomic_exchange<long>(&skip_request, 0)};
 
-        bool end_of_file_reached{false};
+            if(skip < 0 && static_cast<std::size_t>(-skip) > i)
+            {
+                skip = -static_cast<long>(i);
+            }
 
-        // fill the decoder
-        AVFrame *decoded_frame{nullptr};
-        FFmpeg::Frame resampled_frame{};
-        while(error != AVERROR(EAGAIN))
-        {
-            error = decoder.send_packet();
-            if(error == AVERROR_EOF)
+            std::size_t next{i + skip};
+
+            if(next >= files.size())
             {
-                end_of_file_reached = true;
+                break;
             }
 
-            Utility::error_assert((error == AVERROR(EAGAIN) || error >= 0), "Failed to send packet to decoder", error);
+            i = next;
+            std::atomic_store<std::size_t>(&playing_index, i);
+
+            // what's decoded ahead is thrown away
+            restart_decoding(ahead, next);
+            frames_read = 0;
+            buffer_filled = false;
+
+            stream_error = playback.start_stream();
+            Utility::portaudio_error_assert((stream_error >= 0), "Failed to start playback stream", stream_error);
+
+            continue;
         }
 
-        error = decoder.receive_frame(&decoded_frame);
-        Utility::error_assert((error >= 0), "Failed to receive frame from decoder", error);
+        std::unique_lock<std::mutex> lock{ahead.mutex};
 
-        error = 0;
+        // playback got to the start or end of a track
+        while(!ahead.marks.empty() && ahead.marks.front().position <= frames_read)
+        {
+            Track_Mark mark{ahead.marks.front()};
+            ahead.marks.pop_front();
+            lock.unlock();
 
-        PortAudio::Stream_Playback playback{};
+            if(mark.end)
+            {
+                // the track ended by itself, the next one fades in over its end
+                output.start_fade();
 
-        // use default host api
-        error = playback.set_host_api_index(-1);
-        Utility::portaudio_error_assert((error >= 0), "Failed to set host api", error);
+                if(mark.skipped_delay != 0 || mark.skipped_padding != 0)
+                {
+                    std::cout << "Skipped " << mark.skipped_delay << " samples of encoder delay and "
+                              << mark.skipped_padding << " samples of padding" << std::endl;
+                }
+            }
 
-        // set device index
-        error = playback.set_device_index(-1);
-        Utility::portaudio_error_assert((error >= 0), "Failed to set device", error);
+            else
+            {
+                i = mark.index;
+                std::atomic_store<std::size_t>(&playing_index, i);
 
-        enum AVSampleFormat FFMPEG_INPUT_FORMAT{static_cast<enum AVSampleFormat>(decoded_frame->format)};
-        enum AVSampleFormat FFMPEG_OUTPUT_FORMAT;
-        PaSampleFormat PORTAUDIO_OUTPUT_FORMAT;
-        bool SAMPLES_INTERLEAVED{false};
+                std::cout << "Now Playing: " << files.at(i) << std::endl;
 
-        // determine if resampling is needed, and get the PORTAUDIO_OUTPUT_FORMAT
-        bool RESAMPLING_NEEDED{ Utility::resampling_needed(FFMPEG_INPUT_FORMAT, FFMPEG_OUTPUT_FORMAT, PORTAUDIO_OUTPUT_FORMAT, SAMPLES_INTERLEAVED) };
+                if(mark.sample_rate != playback.sample_rate() || mark.channel_count != playback.channel_count())
+                {
+                    std::cout << "Converting " << mark.channel_count << " channels, " << mark.sample_rate << " Hz" << std::endl;
+                }
 
-        // open a playback stream
-        error = playback.open_stream(decoded_frame->channels,   // number of output channels
-                                     PORTAUDIO_OUTPUT_FORMAT,   // output format
-                                     0.05,                      // suggested latency -1.0 for default
-                                     decoded_frame->sample_rate,// sample rate
-                                     paNoFlag);                 // flags
-        Utility::portaudio_error_assert((error >= 0), "Failed to open stream", error);
+                // tracks without ReplayGain tags are played as they are
+                output.set_replay_gain(mark.has_replay_gain, mark.replay_gain, mark.replay_gain_peak);
+            }
 
-        // varialbes to hold channel layout and sample rate, for resampling, involves less overall calculations
-        int64_t CHANNEL_LAYOUT{av_get_default_channel_layout(decoded_frame->channels)};
-        int SAMPLE_RATE{decoded_frame->sample_rate};
+            lock.lock();
+        }
+
+        bool finished{ahead.finished};
+        std::size_t available{ahead.buffer.available()};
 
-        // setup resampler if appropriate
-        if(RESAMPLING_NEEDED)
+        if(available == 0)
         {
-            resampled_frame = av_frame_alloc();
-            if(!resampled_frame)
+            // every track is played
+            if(finished && ahead.marks.empty())
             {
-                std::cerr << "Failed to allocate resampled frame" << std::endl;
+                break;
             }
 
-            // create the resampler
-            resampler = swr_alloc_set_opts(resampler,                      // resampling context
-                                           CHANNEL_LAYOUT,                 // out channel layout
-                                           FFMPEG_OUTPUT_FORMAT,           // out sample format
-                                           SAMPLE_RATE,                    // out sample rate
-                                           CHANNEL_LAYOUT,                 // in channel layout
-                                           FFMPEG_INPUT_FORMAT,            // in sample format
-                                           SAMPLE_RATE,                    // in sample rate
-                                           0,                              // log offset
-                                           nullptr);                       // log context
-            if(!resampler)
+            // decoding didn't keep up, the output waits for it
+            if(buffer_filled && !finished)
             {
-                std::cerr << "Failed to setup resampler" << std::endl;    
-                return 1;
+                ++times_empty;
+                lowest_fill = 0;
+                buffer_filled = false;
             }
 
-            // initialize the resampler
-            error = swr_init(resampler);
-            Utility::error_assert((error >= 0), "Failed to initialize resampler", error);
+            // not for long, so pausing and skipping still work while decoding is stuck
+            ahead.changed.wait_for(lock, std::chrono::milliseconds{50}, [&ahead, frames_read]()
+            {
+                return ahead.buffer.available() != 0 || ahead.finished || (!ahead.marks.empty() && ahead.marks.front().position <= frames_read);
+            });
+
+            continue;
         }
 
-        std::atomic<bool> paused{false};
-        std::atomic<bool> skipping{false};
-        std::condition_variable cv{};
-        std::mutex mutex{};
+        // up to the next mark, so it's reported when its audio is played
+        std::size_t frames{std::min(available, OUTPUT_BLOCK_FRAMES)};
 
-        // create the listening thread
-        std::thread listen_thread{listen_thread_func,
-                                  &paused,
-                                  &skipping,
-                                  &i,
-                                  &cv};
-        listen_thread.detach();
+        if(!ahead.marks.empty())
+        {
+            frames = static_cast<std::size_t>(std::min<unsigned long long>(frames, ahead.marks.front().position - frames_read));
+        }
 
-        std::cout << "Now Playing: " << files.at(i) << std::endl;
+        lock.unlock();
 
-        // start the stream
-        error = playback.start_stream();
-        Utility::portaudio_error_assert((error >= 0), "Failed to start playback stream", error);
+        if(available == ahead.buffer.capacity())
+        {
+            buffer_filled = true;
+        }
 
-        std::cout << "Latency: " << playback.actual_latency() << std::endl;
+        // at the end the buffer runs down by itself
+        if(buffer_filled && !finished)
+        {
+            lowest_fill = std::min(lowest_fill, available);
+            fill_measured = true;
+        }
 
+        frames = ahead.buffer.read(block.data(), frames);
+        frames_read += frames;
 
-        // main loop
-        while(error != AVERROR(EAGAIN) || !end_of_file_reached)
+        // the mutex is only taken so the decoding thread can't miss the room made
         {
-            if(std::atomic_load<bool>(&paused))
-            {
-                // stop the playback stream
-                error = playback.stop_stream();
-                Utility::portaudio_error_assert((error >= 0), "Failed to start playback stream", error);
+            std::lock_guard<std::mutex> guard{ahead.mutex};
+        }
+        ahead.changed.notify_all();
 
-                if(std::atomic_load<bool>(&skipping))
-                {
-                    break;
-                }
+        stream_error = output.play(block.data(), frames, volume.level());
+        Utility::portaudio_error_assert((stream_error == paOutputUnderflowed || stream_error >= 0), "Failed to play frame", stream_error);
 
-                std::unique_lock<std::mutex> lock{mutex};
-                cv.wait(lock);
-                lock.unlock();
+        // the stream is reopened with a bigger buffer after playing what it has
+        if(latency_governor.record(playback.underruns(), static_cast<double>(playback.frames_written()) / playback.sample_rate()))
+        {
+            stream_error = playback.reopen_stream(latency_governor.latency());
+            Utility::portaudio_error_assert((stream_error >= 0), "Failed to reopen stream", stream_error);
 
-                if(std::atomic_load<bool>(&skipping))
-                {
-                    break;
-                }
+            std::cout << "Output latency: " << playback.actual_latency() * 1000.0 << " ms" << std::endl;
+        }
+    }
 
-                // start the stream
-                error = playback.start_stream();
-                Utility::portaudio_error_assert((error >= 0), "Failed to start playback stream", error);
-            }
+    // stopping plays what's left of the last track
+    if(!playback.steam_stopped())
+    {
+        stream_error = output.finish(volume.level());
+        Utility::portaudio_error_assert((stream_error >= 0), "Failed to play frame", stream_error);
 
-            if(RESAMPLING_NEEDED)
-            {
-                // set needed values
-                resampled_frame->channel_layout = CHANNEL_LAYOUT;
-                resampled_frame->sample_rate = SAMPLE_RATE;
-                resampled_frame->format = static_cast<int>(FFMPEG_OUTPUT_FORMAT);
+        stream_error = playback.stop_stream();
+        Utility::portaudio_error_assert((stream_error >= 0), "Failed to stop playback stream", stream_error);
+    }
 
-                // a odd thing seems to happen with .wav files where the channel layout is 0
-                // so we have to calculate and set it otherwise we get errors when resampling
-                decoded_frame->channel_layout = CHANNEL_LAYOUT;
+    // the decoding thread is done, or still decoding when the last track was skipped
+    {
+        std::lock_guard<std::mutex> guard{ahead.mutex};
+        ahead.quit = true;
+    }
+    ahead.changed.notify_all();
 
-                // resample frame
-                error = swr_convert_frame(resampler, resampled_frame, decoded_frame);
-                Utility::error_assert((error >= 0), "Failed to resample frame", error);
+    decode_thread.join();
 
-                // play audio
-                if(SAMPLES_INTERLEAVED)
-                {
-                    error = playback.write(resampled_frame->extended_data[0], resampled_frame->nb_samples);
-                }
+    std::cout << "Decode ahead: " << decode_ahead_ms << " ms buffer";
 
-                else
-                {
-                    error = playback.write(resampled_frame->extended_data, resampled_frame->nb_samples);
-                }
+    if(ahead.decode_seconds > 0.0)
+    {
+        std::cout << ", decoding ran " << ahead.decoded_seconds / ahead.decode_seconds << " times faster than real time";
+    }
 
-                Utility::portaudio_error_assert((error == -9980 || error >= 0), "Failed to play resampled frame", error); // -9980 == underrun
+    if(fill_measured)
+    {
+        std::cout << ", lowest fill " << lowest_fill * 1000.0 / playback.sample_rate() << " ms";
+    }
 
-                av_frame_unref(resampled_frame);
-            }
+    std::cout << ", ran empty " << times_empty << " times" << std::endl;
 
-            else
-            {
-                // play audio
-                if(SAMPLES_INTERLEAVED) 
-                { 
-                    error = playback.write(decoded_frame->extended_data[0], decoded_frame->nb_samples); 
-                }
+    // the output buffer is reused, only a frame bigger than any before it allocates, the resampler restarts after every track
+    if(ahead.converter.reconfigurations() != 0)
+    {
+        std::cout << "Resampler: " << ahead.converter.reconfigurations() << " setups, " << ahead.converter.restarts() << " restarts, "
+                  << ahead.converter.allocations() << " output buffer allocations, " << ahead.converter.late_allocations() << " after the first frame" << std::endl;
+    }
 
-                else 
-                { 
-                    error = playback.write(decoded_frame->extended_data, decoded_frame->nb_samples); 
-                }
+    // reopening the stream keeps its count
+    std::cout << "Output: " << playback.underruns() << " underruns, latency " << playback.actual_latency() * 1000.0 << " ms";
 
-                Utility::portaudio_error_assert((error == -9980 || error >= 0), "Failed to play frame", error); // -9980 == underrun
-            }
+    if(latency_governor.automatic())
+    {
+        std::cout << " (automatic, raised " << latency_governor.raises() << " times)";
+    }
 
-            error = 0;
-            while(!end_of_file_reached && error != AVERROR(EAGAIN))
-            {
-                error = decoder.send_packet();
-                if(error == AVERROR_EOF)
-                {
-                    end_of_file_reached = true;
-                    break;
-                }
-                Utility::error_assert((error == AVERROR(EAGAIN) || error >= 0), "Failed to send packet to decoder", error);
-            }
+    std::cout << std::endl;
 
-            error = decoder.receive_frame(&decoded_frame);
-            Utility::error_assert((error == AVERROR(EAGAIN) || error >= 0), "Failed to receive packet from decoder", error);
-        }
+    output.print_statistics();
 
-    }
     return 0;
 }
 
 void listen_thread_func(std::atomic<bool> *paused,    // boolean indicating if playback is paused
                         std::atomic<bool> *skipping,  // boolean indicating if skipping to next track or previous track
-                        std::size_t *loop_index,      // current track / loop index
-                        std::condition_variable *cv)  // condition variable to wake up playback thread
+                        std::atomic<long> *skip_request,                // tracks to move by, taken by the playback loop
+                        const std::atomic<std::size_t> *playing_index,  // track playing
+                        std::condition_variable *cv,  // condition variable to wake up playback thread
+                        Audio::Volume_Control *volume) // volume commands
 {
 
     std::string command{};
@@ -333,6 +595,8 @@ void listen_thread_func(std::atomic<bool> *paused,    // boolean indicating if p
 
         else if(command == "next")
         {
+            std::atomic_fetch_add<long>(skip_request, 1);
+
             if(std::atomic_load<bool>(paused))
             {
                 std::atomic_store<bool>(skipping, true);
@@ -348,15 +612,15 @@ void listen_thread_func(std::atomic<bool> *paused,    // boolean indicating if p
 
         else if(command == "prev")
         {
-            if((*loop_index) == 0)
+            if(std::atomic_load<std::size_t>(playing_index) == 0)
             {
                 std::cout << "Already at first track" << std::endl;
             }
 
             else
             {
+                std::atomic_fetch_sub<long>(skip_request, 1);
 
-                (*loop_index) -= 2;
                 if(std::atomic_load<bool>(paused))
                 {
                     std::atomic_store<bool>(skipping, true);
@@ -372,7 +636,8 @@ void listen_thread_func(std::atomic<bool> *paused,    // boolean indicating if p
 
         }
 
-        else
+        // volume, volume N, volume +N, volume -N
+        else if(!volume->command(command))
         {
             std::cout << "Unkown command" << std::endl;
         }
@@ -385,3 +650,394 @@ void shuffle_vector(std::vector<std::string> &files)
 
     std::shuffle(files.begin(), files.end(), mt);
 }
+
+/* open_track function
+ * Description: opens a file, sets up its audio decoder and decodes the first frame
+ * Parameter: track - a new Track
+ * Parameter: filename - the file to open
+ * Parameter: replay_gain_mode - which ReplayGain tags are read
+ * Return: negative FFmpeg error on failure, a value >= 0 on success
+ */
+int open_track(Track &track, const std::string &filename, Audio::Replay_Gain_Mode replay_gain_mode)
+{
+    int error{0};
+
+    track.decoded_frame = nullptr;
+    track.has_replay_gain = false;
+    track.flushed = false;
+    track.skip_samples = 0;
+    track.skipped_delay = 0;
+    track.skipped_padding = 0;
+
+    // open the file
+    error = track.decoder.init_format_context(filename, nullptr);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    // find a stream
+    error = track.decoder.find_stream(AVMEDIA_TYPE_AUDIO);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    track.has_replay_gain = Audio::read_replay_gain(track.decoder.format_context(),
+                                                    track.decoder.format_context()->streams[track.decoder.stream_number()],
+                                                    replay_gain_mode, track.replay_gain, track.replay_gain_peak);
+
+    // the decoder reports the encoder delay and padding of MP3 (LAME / Xing headers) and AAC (iTunSMPB / edit lists) instead of
+    // skipping it itself, convert_frame() skips it, the delay can be longer than one frame
+    AVDictionary *codec_options{nullptr};
+    av_dict_set(&codec_options, "flags2", "+skip_manual", 0);
+
+    // start the decoder
+    error = track.decoder.init_codec_context(&codec_options, 1);
+    av_dict_free(&codec_options);
+
+    if(error < 0)
+    {
+        return error;
+    }
+
+    error = decode_frame(track);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    track.channel_count = track.decoded_frame->channels;
+    track.sample_rate = track.decoded_frame->sample_rate;
+
+    return error;
+}
+
+/* decode_frame function
+ * Description: decodes the next frame of a track into its decoded_frame, reading packets from the file as the decoder needs them.
+ * At the end of the file the decoder is flushed, so the frames it held back are played too, the last one usually carries the padding
+ * Parameter: track - an opened track
+ * Return: AVERROR_EOF after the last frame, a negative FFmpeg error on failure, a value >= 0 on success
+ */
+int decode_frame(Track &track)
+{
+    int error{track.decoder.receive_frame(&track.decoded_frame)};
+
+    while(error == AVERROR(EAGAIN))
+    {
+        if(track.flushed)
+        {
+            return AVERROR_EOF;
+        }
+
+        error = track.decoder.send_packet();
+
+        if(error == AVERROR_EOF)
+        {
+            error = track.decoder.flush();
+            track.flushed = true;
+        }
+
+        // AVERROR(EAGAIN) means the decoder is full, the packet is sent again next time
+        if(error < 0 && error != AVERROR(EAGAIN))
+        {
+            return error;
+        }
+
+        error = track.decoder.receive_frame(&track.decoded_frame);
+    }
+
+    return error;
+}
+
+// reads a little endian 32 bit value, like the ones in skip samples side data
+static uint32_t read_le32(const uint8_t *data)
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+/* trim_frame function
+ * Description: drops samples from the start and end of a decoded frame, without copying, by moving its data pointers
+ * Parameter: frame - the frame
+ * Parameter: start - samples to drop from the start
+ * Parameter: end - samples to drop from the end
+ */
+void trim_frame(AVFrame *frame, int start, int end)
+{
+    enum AVSampleFormat format{static_cast<enum AVSampleFormat>(frame->format)};
+    bool planar{av_sample_fmt_is_planar(format) != 0};
+
+    int plane_count{planar ? frame->channels : 1};
+    int offset{start * av_get_bytes_per_sample(format) * (planar ? 1 : frame->channels)};
+
+    for(int plane{0}; plane != plane_count; ++plane)
+    {
+        frame->extended_data[plane] += offset;
+
+        // with more channels than data has room for, extended_data is an array of its own, and data has copies of the first pointers
+        if(frame->extended_data != frame->data && plane < AV_NUM_DATA_POINTERS)
+        {
+            frame->data[plane] += offset;
+        }
+    }
+
+    frame->nb_samples -= start + end;
+}
+
+/* convert_frame function
+ * Description: converts the track's decoded frame to the stream's format, without the samples of encoder delay and padding,
+ * so one track's audio ends exactly where the next one's starts
+ * Parameter: track - the track, its decoded_frame is converted
+ * Parameter: converter - converts to the stream's format
+ * Return: a negative FFmpeg error on failure, 0 if there is nothing to play, a value > 0 if the converter's output has the frame
+ */
+int convert_frame(Track &track, FFmpeg::Audio_Converter &converter)
+{
+    AVFrame *frame{track.decoded_frame};
+
+    // decoded only for the decoder to get going, e.g. priming frames
+    if(frame->flags & AV_FRAME_FLAG_DISCARD)
+    {
+        track.skipped_delay += frame->nb_samples;
+        return 0;
+    }
+
+    int sample_count{frame->nb_samples};
+    int padding{0};
+
+    // skip samples side data: uint32le samples to skip from the start, uint32le samples to discard from the end
+    const AVFrameSideData *skip_data{av_frame_get_side_data(frame, AV_FRAME_DATA_SKIP_SAMPLES)};
+    if(skip_data && skip_data->size >= 8)
+    {
+        track.skip_samples += read_le32(skip_data->data);
+
+        padding = static_cast<int>(std::min<uint32_t>(read_le32(skip_data->data + 4), sample_count));
+        sample_count -= padding;
+        track.skipped_padding += padding;
+    }
+
+    int delay{static_cast<int>(std::min<int64_t>(track.skip_samples, sample_count))};
+    sample_count -= delay;
+    track.skip_samples -= delay;
+    track.skipped_delay += delay;
+
+    if(sample_count == 0)
+    {
+        return 0;
+    }
+
+    // trimmed before converting, the resampler may change the sample rate
+    if(delay != 0 || padding != 0)
+    {
+        trim_frame(frame, delay, padding);
+    }
+
+    int error{converter.convert(frame)};
+
+    return error < 0 ? error : 1;
+}
+
+// gets the seconds passed since a point in time
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+
+    return elapsed.count();
+}
+
+// decodes the tracks from start_index on into the buffer, until it's told to quit, a stop makes it start again at the new start_index
+void decode_thread_func(Decode_Ahead *ahead, const std::vector<std::string> *files)
+{
+    std::unique_lock<std::mutex> lock{ahead->mutex};
+
+    while(!ahead->quit)
+    {
+        std::size_t index{ahead->start_index};
+        lock.unlock();
+
+        // position of the next frame written, the buffer is empty when decoding starts
+        unsigned long long position{0};
+        bool stopped{false};
+
+        for(; index < files->size() && !stopped; ++index)
+        {
+            auto busy_start{std::chrono::steady_clock::now()};
+
+            Track track{};
+            track.index = index;
+
+            int error{open_track(track, files->at(index), ahead->replay_gain_mode)};
+
+            if(error < 0)
+            {
+                Utility::print_error("Failed to open " + files->at(index), error);
+                continue;
+            }
+
+            Track_Mark start_mark{};
+            start_mark.position = position;
+            start_mark.end = false;
+            start_mark.index = index;
+            start_mark.channel_count = track.channel_count;
+            start_mark.sample_rate = track.sample_rate;
+            start_mark.has_replay_gain = track.has_replay_gain;
+            start_mark.replay_gain = track.replay_gain;
+            start_mark.replay_gain_peak = track.replay_gain_peak;
+
+            add_mark(*ahead, start_mark);
+
+            // until the decoder has given every frame of the file
+            while(error >= 0)
+            {
+                error = convert_frame(track, ahead->converter);
+                Utility::error_assert((error >= 0), "Failed to resample frame", error);
+
+                ahead->decode_seconds += seconds_since(busy_start);
+
+                if(error > 0)
+                {
+                    ahead->decoded_seconds += static_cast<double>(ahead->converter.converted()->nb_samples) / ahead->converter.sample_rate();
+
+                    if(!write_decoded(*ahead, ahead->converter.converted(), position))
+                    {
+                        stopped = true;
+                        break;
+                    }
+                }
+
+                busy_start = std::chrono::steady_clock::now();
+                error = decode_frame(track);
+            }
+
+            if(stopped)
+            {
+                break;
+            }
+
+            // what the resampler still holds back of the track goes before its end mark, the next track starts clean
+            int flush_error{ahead->converter.flush()};
+            Utility::error_assert((flush_error >= 0), "Failed to flush resampler", flush_error);
+
+            if(!write_decoded(*ahead, ahead->converter.converted(), position))
+            {
+                stopped = true;
+                break;
+            }
+
+            if(error != AVERROR_EOF)
+            {
+                Utility::print_error("Failed to decode " + files->at(index), error);
+                continue;
+            }
+
+            Track_Mark end_mark{};
+            end_mark.position = position;
+            end_mark.end = true;
+            end_mark.index = index;
+            end_mark.skipped_delay = track.skipped_delay;
+            end_mark.skipped_padding = track.skipped_padding;
+
+            add_mark(*ahead, end_mark);
+        }
+
+        if(!stopped)
+        {
+            lock.lock();
+            ahead->finished = true;
+            ahead->changed.notify_all();
+        }
+
+        else
+        {
+            lock.lock();
+        }
+
+        // waits for the output to start decoding somewhere else, or to quit
+        ahead->changed.wait(lock, [ahead]() { return ahead->stop || ahead->quit; });
+
+        if(ahead->quit)
+        {
+            break;
+        }
+
+        ahead->stopped = true;
+        ahead->changed.notify_all();
+
+        ahead->changed.wait(lock, [ahead]() { return !ahead->stop || ahead->quit; });
+    }
+}
+
+/* restart_decoding function
+ * Description: stops the decoding thread, throws away what's decoded ahead, and has it start again at another track
+ * Parameter: ahead - the decoded audio, the output must not be reading from it
+ * Parameter: index - the track to start at
+ */
+void restart_decoding(Decode_Ahead &ahead, std::size_t index)
+{
+    std::unique_lock<std::mutex> lock{ahead.mutex};
+
+    ahead.stop = true;
+    ahead.changed.notify_all();
+
+    ahead.changed.wait(lock, [&ahead]() { return ahead.stopped; });
+
+    // the decoding thread waits, nothing uses the buffer, or the converter
+    ahead.buffer.clear();
+    ahead.marks.clear();
+
+    // what the resampler held back belongs to the track skipped
+    int error{ahead.converter.reset()};
+    Utility::error_assert((error >= 0), "Failed to reset resampler", error);
+
+    ahead.start_index = index;
+    ahead.finished = false;
+    ahead.stopped = false;
+    ahead.stop = false;
+
+    ahead.changed.notify_all();
+}
+
+// adds the start or end of a track, for the output to report when it gets there
+void add_mark(Decode_Ahead &ahead, const Track_Mark &mark)
+{
+    {
+        std::lock_guard<std::mutex> guard{ahead.mutex};
+        ahead.marks.push_back(mark);
+    }
+
+    ahead.changed.notify_all();
+}
+
+/* write_decoded function
+ * Description: writes converted audio into the buffer, waits for the output to make room when it's full
+ * Parameter: ahead - the decoded audio
+ * Parameter: converted - the converter's output, in the stream's format, may be nullptr
+ * Parameter: position - position of the first frame, moved past the frames written
+ * Return: false if the output wants decoding to stop, not everything may be written then
+ */
+bool write_decoded(Decode_Ahead &ahead, const AVFrame *converted, unsigned long long &position)
+{
+    const uint8_t *data{converted ? converted->extended_data[0] : nullptr};
+    std::size_t frames{converted && converted->nb_samples > 0 ? static_cast<std::size_t>(converted->nb_samples) : 0};
+
+    std::unique_lock<std::mutex> lock{ahead.mutex};
+
+    while(frames != 0 && !ahead.stop && !ahead.quit)
+    {
+        std::size_t written{ahead.buffer.write(data, frames)};
+
+        data += written * ahead.buffer.frame_size();
+        frames -= written;
+        position += written;
+
+        ahead.changed.notify_all();
+
+        if(frames != 0)
+        {
+            ahead.changed.wait(lock, [&ahead]() { return ahead.buffer.space() != 0 || ahead.stop || ahead.quit; });
+        }
+    }
+
+    return !ahead.stop && !ahead.quit;
+}
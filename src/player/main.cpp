@@ -27,24 +27,60 @@
 #include <csignal>
 #include <atomic>
 #include <algorithm>
+#include <cmath>
 #include <random>
 #include <vector>
+#include <memory>
 
 #include <ffmpeg/decoder.h>
 #include <ffmpeg/frame.h>
 #include <ffmpeg/scale.h>
 #include <ffmpeg/resample.h>
+#include <ffmpeg/audio_converter.h>
+#include <ffmpeg/subtitle_decoder.h>
 #include <portaudio/portaudio.h>
 #include <sdl/sdl.h>
 #include <utility/semaphore.h>
 #include <utility/utility.h>
+#include <utility/scaler_governor.h>
+#include <utility/latency_governor.h>
+#include <utility/thread_pool.h>
+#include <utility/frame_scheduler.h>
+#include <utility/display_info.h>
+#include <video/deinterlace.h>
+#include <video/tonemap.h>
+#include <video/frame_pacing.h>
+#include <video/frame_timing.h>
+#include <video/subtitle_overlay.h>
+#include <video/yuv_to_rgb.h>
+#include <video/master_clock.h>
+#include <audio/crossfade.h>
+#include <audio/output.h>
+#include <audio/gain.h>
+#include <audio/replay_gain.h>
 
 extern "C"
 {
 #include <libavutil/pixfmt.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 }
 
+struct Video_Output;
+
+// Audio_Output struct, the converter and the output the decoded audio goes through
+// In audio only mode with crossfading one audio output plays every file, so the end of a file can be mixed
+// with the start of the next one. Otherwise every file opens its own output in the audio thread
+struct Audio_Output
+{
+    // keeps PortAudio initialized while the stream is open
+    PortAudio::Initializer portaudio_init;
+
+    FFmpeg::Audio_Converter converter;
+    Audio::Output output;
+};
+
 // Shared_Varaibles struct, holds variables that are shared between threads
 // Holds only data variables, no synchronization variables
 struct Shared_Variables
@@ -55,27 +91,270 @@ struct Shared_Variables
     bool video_waiting;
     bool audio_waiting;
 
-    // audio latency in seconds
-    double audio_latency;
+    // picks the audio latency, and raises it after repeated underruns in automatic mode, kept from file to file
+    Utility::Latency_Governor *latency_governor;
 
     std::atomic<bool> paused;
     std::atomic<bool> audio_paused;
     std::atomic<bool> skipping;
 
+    // set to have the video thread print its frame pacing statistics
+    std::atomic<bool> print_statistics;
+
+    // print what was picked for each file, and the per file diagnostics
+    bool verbose;
+
+    // the window, outlives the shared variables, nullptr until the first video is played
+    Video_Output *video_output;
+
+    // the clock video follows, the audio output while audio plays
+    Video::Master_Clock *master_clock;
+
+    // the audio output kept open from one file to the next, nullptr if every file opens its own
+    Audio_Output *audio_output;
+
+    // volume level, kept from file to file
+    Audio::Volume_Control *volume;
+};
+
+// Output_Mode enum, how video gets onto the screen
+enum Output_Mode
+{
+    OUTPUT_AUTO,     // the renderer if a hardware accelerated one can be created, the window surface otherwise
+    OUTPUT_RENDERER, // an SDL renderer and textures, SDL's software renderer if there is no GPU
+    OUTPUT_SURFACE   // converted and scaled straight into the window surface
+};
+
+// Player_Options struct, holds the options given on the command line
+struct Player_Options
+{
+    bool audio_only;
+    bool video_only;
+
+    Utility::Scaler_Preset scaler_preset;
+    bool automatic_scaler;
+
+    Video::Deinterlace_Mode deinterlace_mode;
+    Video::Tone_Map_Curve tone_map_curve;
+
+    bool busy_wait;
+
+    // frames, or milliseconds of video, decoded ahead before playback starts
+    int prefill;
+    bool prefill_in_ms;
+
+    // decode and convert as fast as possible into a null sink, no window or audio output
+    bool benchmark;
+
+    // show bitmap subtitles if the file has them
+    bool subtitles;
+
+    Output_Mode output_mode;
+
+    // milliseconds of audio the callback stream's ring buffer holds, 0 for a blocking stream
+    int audio_buffer_ms;
+
+    // suggested audio latency in seconds, the one automatic mode starts at
+    double audio_latency;
+    bool automatic_audio_latency;
+
+    // threads kept busy during playback, to compare how the audio streams hold up under CPU load
+    int cpu_load_threads;
+
+    // seconds consecutive files overlap in audio only mode, 0 for no crossfade
+    double crossfade_duration;
+    Audio::Crossfade_Curve crossfade_curve;
+
+    Audio::Replay_Gain_Mode replay_gain_mode;
+
+    // print what was picked for each file, and the per file diagnostics
+    bool verbose;
+};
+
+// Video_Conversion struct, describes how decoded video frames are converted into displayable frames
+// It is set up from the first decoded frame, and set up again whenever the decoded frames change size or pixel format
+struct Video_Conversion
+{
+    enum AVPixelFormat input_format;
+    int input_width;
+    int input_height;
+
+    enum AVPixelFormat output_format;
+    uint32_t sdl_format;
+    SDL_Rect output_resolution;
+
+    bool rescaling_needed;
+    int scaler_flags;
+
+    // texture formats the renderer supports natively, the SDL format is picked from these. Empty if unknown
+    std::vector<uint32_t> texture_formats;
+
+    // HDR frames are tone mapped to YUV420P before rescaling, unless the curve is off
+    Video::Tone_Map_Curve tone_map_curve;
+    bool tone_mapping;
+
+    // frames that don't need a filter are queued as they were decoded, and converted by the presenting thread
+    bool streaming;
+};
+
+// Video_Filters struct, holds the optional processing stages decoded frames go through before being displayed
+// The stages, and the threads they use, are only created once a frame needs them, so progressive content pays nothing
+struct Video_Filters
+{
+    Video::Deinterlace_Mode deinterlace_mode;
+    enum AVFieldOrder field_order; // field order of the stream
+    bool verbose;                  // print which filters are used
+
+    std::unique_ptr<Utility::Thread_Pool> thread_pool;
+    std::unique_ptr<Video::Deinterlacer> deinterlacer;
+    std::unique_ptr<Video::Tone_Mapper> tone_mapper;
+
+    // intermediate frames for when a filter and rescaling are both needed
+    FFmpeg::Frame scratch_frames[2];
+    int scratch_index;
+
+    // for pixel formats the deinterlacer doesn't take: converted to an 8 bit format at the decoded size, deinterlaced, then rescaled
+    FFmpeg::Scale deinterlace_input_converter;
+    FFmpeg::Scale deinterlace_output_rescaler;
+    FFmpeg::Frame deinterlaced_frame;
+
+    // tone mapped frames, for when something else has to be done after tone mapping
+    FFmpeg::Frame tone_mapped_frames[2];
+    int tone_mapped_index;
+};
+
+// Decoder_Statistics struct, what the decoder thread spent its time on, read once the thread is joined
+struct Decoder_Statistics
+{
+    double decode_seconds;  // sending packets, which includes demuxing, and receiving frames
+    double convert_seconds; // filters and rescaling into the ring
+    int skipped_frames;     // in a pixel format that can't be converted
+};
+
+// seconds of video the ring holds when frames are queued as decoded, they hold on to the decoder's buffers until they're shown
+const double STREAMING_BUFFER_SECONDS{0.5};
+
+// Texture_Upload struct, describes how queued frames get into the texture
+// With a streaming texture the last rescale / plane copy writes straight into the locked texture memory,
+// otherwise the frame, rescaled into staging_frame if needed, is copied in with SDL_UpdateTexture
+struct Texture_Upload
+{
+    bool streaming;
+
+    // conversion from the queued frames to the texture, never tone maps
+    Video_Conversion conversion;
+    FFmpeg::Scale rescaler;
+
+    FFmpeg::Frame staging_frame;
+};
+
+// Surface_Output struct, the presentation path for machines without a GPU
+// Frames are converted and scaled once, straight into the display rectangle of the window surface, and shown with SDL_UpdateWindowSurface,
+// instead of being uploaded into a texture that SDL's software renderer then converts and scales again
+struct Surface_Output
+{
+    // converts frames the SIMD conversion can't take straight into the surface, and scales YUV420P frames for it
+    FFmpeg::Scale rescaler;
+
+    // SIMD conversion for YUV420P frames, created the first time it is used
+    std::unique_ptr<Utility::Thread_Pool> thread_pool;
+    std::unique_ptr<Video::Yuv_To_Rgb> converter;
+
+    // YUV420P frames scaled to the display rectangle, before the SIMD conversion
+    FFmpeg::Frame scaled_frame;
+
+    // wraps the pixels of the shown subtitle, recreated only when the subtitle changes
+    SDL::Surface subtitle_surface;
+
+    // what the display rectangle was calculated for, the window surface is recreated when the window is resized
+    SDL_Surface *surface;
+    int surface_width;
+    int surface_height;
+    enum AVPixelFormat input_format;
+    int input_width;
+    int input_height;
+
+    SDL_Rect display_rect;
+};
+
+// Video_Output struct, the SDL video output
+// It is opened by the first video and kept for the rest of the playlist, so switching videos doesn't recreate the window
+// The textures are only recreated when a video needs a different pixel format or size
+struct Video_Output
+{
+    // textures in the ring, the next frame is uploaded into one while another is on screen
+    // 3 rather than 2, so a texture isn't written while the renderer may still be reading it for the previous present
+    static const int TEXTURE_RING_SIZE{3};
+
+    std::unique_ptr<SDL::Initializer> sdl_initializer;
+
     SDL::Window window;
     bool fullscreen;
 
-};
+    // no renderer or textures are created when drawing into the window surface
+    bool surface_output;
+    Surface_Output surface;
 
-// video stuff
-int render_yuv_frame(SDL::Texture&, SDL_Rect*, SDL::Renderer&, AVFrame*);
-int render_frame(SDL::Texture&, SDL_Rect*, SDL::Renderer&, AVFrame*);
-void decoder_thread_function(FFmpeg::Decoder&, FFmpeg::Scale&, bool, FFmpeg::Frame_Array&, Utility::Semaphore&, Utility::Semaphore&, Shared_Variables&);
+    SDL::Renderer renderer;
+    SDL::Texture textures[TEXTURE_RING_SIZE];
+    Texture_Upload upload;
+
+    // ARGB texture blended over the video, only uploaded when the subtitle changes
+    SDL::Texture subtitle_texture;
 
-void video_playback(FFmpeg::Decoder&, Shared_Variables&, int&, std::condition_variable&, std::condition_variable&, std::mutex&);
+    // usable bounds of the display the window is on, kept up to date by the SDL event thread
+    Utility::Display_Info display_info;
 
+    // display rectangle for each texture in the ring
+    SDL_Rect display_rects[TEXTURE_RING_SIZE];
 
-void audio_thread_func(FFmpeg::Decoder&, Shared_Variables&, int&, std::condition_variable&, std::condition_variable&, std::mutex&);
+    // 0 if the renderer doesn't sync to vsync
+    double refresh_interval;
+};
+
+// video stuff
+int upload_frame(Texture_Upload&, SDL::Texture&, SDL::Renderer&, Utility::Scaler_Governor&, SDL_Rect&, SDL_Rect&, AVFrame*);
+int write_texture(Texture_Upload&, SDL::Texture&, AVFrame*);
+int update_texture(SDL::Texture&, AVFrame*, uint32_t);
+int render_texture(SDL::Texture&, SDL_Rect*, SDL::Renderer&, SDL_Texture*, const SDL_Rect*);
+void texture_planes(uint32_t, void*, int, int, uint8_t**, int*);
+int prepare_texture(SDL::Texture&, SDL::Renderer&, const Video_Conversion&, SDL_Rect&, SDL_Rect&, bool&);
+std::string texture_path_description(const Video_Conversion&);
+void decoder_thread_function(FFmpeg::Decoder&, FFmpeg::Scale&, Utility::Scaler_Governor&, Video_Filters&, Video_Conversion, const Utility::Display_Info&, Video::Frame_Timing&, FFmpeg::Frame_Array&, Utility::Semaphore&, Utility::Semaphore&, Shared_Variables&, Decoder_Statistics&);
+
+bool conversion_changed(const Video_Conversion&, const AVFrame*);
+bool tone_mapping_needed(const Video_Conversion&, const AVFrame*);
+bool setup_video_conversion(const AVFrame*, SDL_Rect&, Video_Conversion&, FFmpeg::Scale&);
+bool filters_needed(const Video_Conversion&, const Video_Filters&, const AVFrame*);
+int queue_frame(const Video_Conversion&, FFmpeg::Scale&, Video_Filters&, AVFrame*, FFmpeg::Frame&);
+int convert_frame(const Video_Conversion&, FFmpeg::Scale&, Video_Filters&, AVFrame*, FFmpeg::Frame&);
+enum AVPixelFormat deinterlacer_pixel_format(enum AVPixelFormat);
+int deinterlace_frame(const Video_Conversion&, FFmpeg::Scale&, Video_Filters&, const AVFrame*, FFmpeg::Frame&);
+Utility::Thread_Pool &filter_thread_pool(Video_Filters&);
+int rescale_frame(FFmpeg::Scale&, const AVFrame*, AVFrame*);
+int prepare_frame(FFmpeg::Frame&, enum AVPixelFormat, int, int);
+
+void video_playback(FFmpeg::Decoder&, Shared_Variables&, Video_Output&, const Player_Options&, int&, std::condition_variable&, std::condition_variable&, std::mutex&);
+void open_video_output(Video_Output&, Output_Mode, bool, bool);
+
+// window surface stuff
+int draw_to_surface(Surface_Output&, SDL::Window&, Utility::Scaler_Governor&, AVFrame*, bool);
+int present_surface(SDL::Window&, SDL_Surface*, const SDL_Rect*);
+int update_surface_subtitle(Surface_Output&, const Video::Subtitle_Image&);
+enum AVPixelFormat surface_pixel_format(uint32_t);
+
+// subtitle stuff
+bool setup_subtitles(FFmpeg::Decoder&, FFmpeg::Subtitle_Decoder&, Video::Subtitle_Overlay&);
+int upload_subtitle(SDL::Texture&, SDL::Renderer&, const Video::Subtitle_Image&);
+SDL_Rect subtitle_rectangle(const Video::Subtitle_Overlay&, const SDL_Rect&);
+
+// benchmark stuff
+void benchmark_file(const std::string&, const Player_Options&, Video_Output*);
+std::string json_string(const std::string&);
+void cpu_load_thread_func(std::atomic<bool>&);
+
+void audio_thread_func(FFmpeg::Decoder&, Shared_Variables&, const Player_Options&, int&, std::condition_variable&, std::condition_variable&, std::mutex&);
+PaError play_converted(Audio::Output&, const AVFrame*, int);
 
 // this listening function is active when there is only audio and no video
 void terminal_listen_thread_func(Shared_Variables&, int&, std::condition_variable&);
@@ -103,6 +382,26 @@ void print_help(const std::string &program_name)
     std::cout << "--shuffle       shuffle the given files" << std::endl;
     std::cout << "--audio-only    only play audio, no video" << std::endl;
     std::cout << "--video-only    only play video, no audio" << std::endl;
+    std::cout << "--scaler=NAME   image scaler to use: fast-bilinear, bilinear, bicubic(default), lanczos," << std::endl;
+    std::cout << "                or auto to switch to cheaper scalers when conversion gets too slow" << std::endl;
+    std::cout << "--deinterlace=MODE deinterlacing for interlaced video: off, bob, adaptive(default)" << std::endl;
+    std::cout << "--tonemap=CURVE HDR to SDR tone mapping curve: off, hable, reinhard, bt2390(default)" << std::endl;
+    std::cout << "--busy-wait spin until each frame is due instead of sleeping, for comparing frame timing" << std::endl;
+    std::cout << "--prefill=N[ms] frames, or milliseconds with ms, of video to decode before starting playback, default 2 frames" << std::endl;
+    std::cout << "--benchmark     decode and convert the video of each file as fast as possible, without a display," << std::endl;
+    std::cout << "                and print one JSON line of results per file, with --output=renderer or --output=surface" << std::endl;
+    std::cout << "                the frames are also presented, without vsync" << std::endl;
+    std::cout << "--no-subtitles  don't show bitmap (PGS, DVB, DVD) subtitles" << std::endl;
+    std::cout << "--audio-buffer=MS milliseconds of audio buffered ahead for the audio callback, default 200," << std::endl;
+    std::cout << "                or 0 to write to a blocking audio stream instead" << std::endl;
+    std::cout << "--audio-latency=MS suggested audio output latency, default 50, or auto to start low and raise it after underruns" << std::endl;
+    std::cout << "--cpu-load=N    keep N threads busy during playback, to compare audio glitches under load" << std::endl;
+    std::cout << "--crossfade=SECONDS crossfade consecutive files in audio only mode, default 0 (off)" << std::endl;
+    std::cout << "--crossfade-curve=CURVE gains of a crossfade: linear, equal-power(default)" << std::endl;
+    std::cout << "--replaygain=MODE apply the ReplayGain tags of the files: off(default), track, album" << std::endl;
+    std::cout << "--output=MODE   how video is presented: renderer (GPU, or SDL's software renderer), surface (converted straight" << std::endl;
+    std::cout << "                into the window surface, for machines without a GPU), auto(default) surface if there is no GPU renderer" << std::endl;
+    std::cout << "--verbose       print the video path, audio output, resampler and sync details of every file" << std::endl;
     std::cout << "Note: Repeated Options will be ignored" << std::endl;
 }
 
@@ -143,8 +442,28 @@ int main(int argc, char **argv)
 
     std::vector<std::string> files;
     bool shuffle{false};
-    bool audio_only{false};
-    bool video_only{false};
+
+    Player_Options options{};
+    options.audio_only = false;
+    options.video_only = false;
+    options.scaler_preset = Utility::SCALER_BICUBIC;
+    options.automatic_scaler = false;
+    options.deinterlace_mode = Video::DEINTERLACE_ADAPTIVE;
+    options.tone_map_curve = Video::TONE_MAP_BT2390;
+    options.busy_wait = false;
+    options.prefill = 2;
+    options.prefill_in_ms = false;
+    options.benchmark = false;
+    options.subtitles = true;
+    options.output_mode = OUTPUT_AUTO;
+    options.audio_buffer_ms = 200;
+    options.audio_latency = 0.05;
+    options.automatic_audio_latency = false;
+    options.cpu_load_threads = 0;
+    options.crossfade_duration = 0.0;
+    options.crossfade_curve = Audio::CROSSFADE_EQUAL_POWER;
+    options.replay_gain_mode = Audio::REPLAY_GAIN_OFF;
+    options.verbose = false;
 
     for(int i{1}; i != argc; ++i)
     {
@@ -157,12 +476,184 @@ int main(int argc, char **argv)
 
         else if(current_argument == "--audio-only")
         {
-            audio_only = true;
+            options.audio_only = true;
         }
 
         else if(current_argument == "--video-only")
         {
-            video_only = true;
+            options.video_only = true;
+        }
+
+        else if(current_argument.rfind("--scaler=", 0) == 0)
+        {
+            std::string scaler{current_argument.substr(9)};
+
+            if(scaler == "auto")
+            {
+                options.scaler_preset = Utility::SCALER_LANCZOS;
+                options.automatic_scaler = true;
+            }
+
+            else if(!Utility::parse_scaler_preset(scaler, options.scaler_preset))
+            {
+                std::cerr << "Invalid Usage, unknown scaler: " << scaler << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+        }
+
+        else if(current_argument.rfind("--deinterlace=", 0) == 0)
+        {
+            std::string mode{current_argument.substr(14)};
+
+            if(!Video::parse_deinterlace_mode(mode, options.deinterlace_mode))
+            {
+                std::cerr << "Invalid Usage, unknown deinterlacing mode: " << mode << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+        }
+
+        else if(current_argument == "--busy-wait")
+        {
+            options.busy_wait = true;
+        }
+
+        else if(current_argument == "--benchmark")
+        {
+            options.benchmark = true;
+        }
+
+        else if(current_argument == "--no-subtitles")
+        {
+            options.subtitles = false;
+        }
+
+        else if(current_argument == "--verbose")
+        {
+            options.verbose = true;
+        }
+
+        else if(current_argument.rfind("--audio-buffer=", 0) == 0 || current_argument.rfind("--cpu-load=", 0) == 0)
+        {
+            bool audio_buffer{current_argument.rfind("--audio-buffer=", 0) == 0};
+            std::string amount{current_argument.substr(current_argument.find('=') + 1)};
+
+            if(amount.empty() || amount.size() > 5 || amount.find_first_not_of("0123456789") != std::string::npos)
+            {
+                std::cerr << "Invalid Usage, bad amount: " << current_argument << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+
+            (audio_buffer ? options.audio_buffer_ms : options.cpu_load_threads) = std::stoi(amount);
+        }
+
+        else if(current_argument.rfind("--audio-latency=", 0) == 0)
+        {
+            std::string latency{current_argument.substr(16)};
+
+            if(!Utility::parse_latency(latency, options.audio_latency, options.automatic_audio_latency))
+            {
+                std::cerr << "Invalid Usage, bad audio latency: " << latency << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+        }
+
+        else if(current_argument.rfind("--crossfade=", 0) == 0)
+        {
+            std::string seconds{current_argument.substr(12)};
+
+            if(!Audio::parse_crossfade_duration(seconds, options.crossfade_duration))
+            {
+                std::cerr << "Invalid Usage, bad crossfade duration: " << seconds << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+        }
+
+        else if(current_argument.rfind("--crossfade-curve=", 0) == 0)
+        {
+            std::string curve{current_argument.substr(18)};
+
+            if(!Audio::parse_crossfade_curve(curve, options.crossfade_curve))
+            {
+                std::cerr << "Invalid Usage, unknown crossfade curve: " << curve << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+        }
+
+        else if(current_argument.rfind("--replaygain=", 0) == 0)
+        {
+            std::string mode{current_argument.substr(13)};
+
+            if(!Audio::parse_replay_gain_mode(mode, options.replay_gain_mode))
+            {
+                std::cerr << "Invalid Usage, unknown ReplayGain mode: " << mode << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+        }
+
+        else if(current_argument.rfind("--output=", 0) == 0)
+        {
+            std::string mode{current_argument.substr(9)};
+
+            if(mode == "auto")
+            {
+                options.output_mode = OUTPUT_AUTO;
+            }
+
+            else if(mode == "renderer")
+            {
+                options.output_mode = OUTPUT_RENDERER;
+            }
+
+            else if(mode == "surface")
+            {
+                options.output_mode = OUTPUT_SURFACE;
+            }
+
+            else
+            {
+                std::cerr << "Invalid Usage, unknown output mode: " << mode << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+        }
+
+        else if(current_argument.rfind("--prefill=", 0) == 0)
+        {
+            std::string prefill{current_argument.substr(10)};
+
+            options.prefill_in_ms = (prefill.size() > 2 && prefill.compare(prefill.size() - 2, 2, "ms") == 0);
+            if(options.prefill_in_ms)
+            {
+                prefill.erase(prefill.size() - 2);
+            }
+
+            if(prefill.empty() || prefill.size() > 6 || prefill.find_first_not_of("0123456789") != std::string::npos)
+            {
+                std::cerr << "Invalid Usage, bad prefill amount: " << current_argument.substr(10) << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
+
+            options.prefill = std::stoi(prefill);
+        }
+
+        else if(current_argument.rfind("--tonemap=", 0) == 0)
+        {
+            std::string curve{current_argument.substr(10)};
+
+            if(!Video::parse_tone_map_curve(curve, options.tone_map_curve))
+            {
+                std::cerr << "Invalid Usage, unknown tone mapping curve: " << curve << std::endl;
+                print_help(argv[0]);
+                return 1;
+            }
         }
 
         else if(current_argument == "--help")
@@ -182,6 +673,52 @@ int main(int argc, char **argv)
         shuffle_files(files);
     }
 
+    // no PortAudio is needed, and no SDL unless the frames are presented, so this works on machines without a display or sound card
+    if(options.benchmark)
+    {
+        // with --output=renderer or --output=surface the frames are presented too, without waiting for vsync, to compare the two
+        Video_Output benchmark_output{};
+        bool present{options.output_mode != OUTPUT_AUTO};
+
+        if(present)
+        {
+            open_video_output(benchmark_output, options.output_mode, options.verbose, false);
+        }
+
+        for(const std::string &filename : files)
+        {
+            benchmark_file(filename, options, present ? &benchmark_output : nullptr);
+        }
+
+        return 0;
+    }
+
+    // created once the first video is played, and kept until the program exits
+    Video_Output video_output{};
+
+    // competes with playback for the CPU until the program exits
+    std::atomic<bool> cpu_load_running{true};
+    std::vector<std::thread> cpu_load_threads;
+
+    for(int i{0}; i != options.cpu_load_threads; ++i)
+    {
+        cpu_load_threads.emplace_back(cpu_load_thread_func, std::ref(cpu_load_running));
+    }
+
+    // crossfading needs the end of one file and the start of the next on the same output, it's opened by the first file's audio thread
+    std::unique_ptr<Audio_Output> audio_output{};
+
+    if(options.audio_only && options.crossfade_duration > 0.0)
+    {
+        audio_output.reset(new Audio_Output{});
+    }
+
+    // changed with the volume command, or the 9 and 0 keys
+    Audio::Volume_Control volume{};
+
+    // a latency raised after underruns in one file is kept for the next ones
+    Utility::Latency_Governor latency_governor{options.audio_latency, options.automatic_audio_latency};
+
     // Static cast is used to suppress complier warning
     for(int i{0}; i != static_cast<int>(files.size()); ++i)
     {
@@ -192,13 +729,20 @@ int main(int argc, char **argv)
         FFmpeg::Decoder video_decoder{};
         FFmpeg::Decoder audio_decoder{};
         Shared_Variables shared_vars{};
+        Video::Master_Clock master_clock{};
 
         shared_vars.audio_playback = false;
         shared_vars.video_playback = false;
+        shared_vars.video_output = &video_output;
+        shared_vars.master_clock = &master_clock;
+        shared_vars.audio_output = audio_output.get();
+        shared_vars.volume = &volume;
+        shared_vars.verbose = options.verbose;
+        shared_vars.latency_governor = &latency_governor;
 
         int error{0};
 
-        if(!audio_only)
+        if(!options.audio_only)
         {
             // open the file
             error = video_decoder.init_format_context(filename, nullptr);
@@ -222,7 +766,7 @@ int main(int argc, char **argv)
             }
         }
 
-        if(!video_only)
+        if(!options.video_only)
         {
             // open the file
             error = audio_decoder.init_format_context(filename, nullptr);
@@ -252,6 +796,7 @@ int main(int argc, char **argv)
 
         std::atomic_store<bool>(&shared_vars.paused, false);
         std::atomic_store<bool>(&shared_vars.audio_paused, false);
+        std::atomic_store<bool>(&shared_vars.print_statistics, false);
 
         std::condition_variable start_cv;
         std::condition_variable paused_cv;
@@ -261,21 +806,55 @@ int main(int argc, char **argv)
         std::thread audio_thread{audio_thread_func,
                                  std::ref(audio_decoder),
                                  std::ref(shared_vars),
+                                 std::cref(options),
                                  std::ref(i),
                                  std::ref(start_cv),
                                  std::ref(paused_cv),
                                  std::ref(mutex)};
 
 
+        // keep the window out of the way while a file without video plays
+        if(!shared_vars.video_playback && video_output.window.window())
+        {
+            SDL_HideWindow(video_output.window);
+        }
+
         // the main thread decodes video, will also automatically return if there is no video playback
-        video_playback(video_decoder, shared_vars, i, start_cv, paused_cv, mutex);
+        video_playback(video_decoder, shared_vars, video_output, options, i, start_cv, paused_cv, mutex);
 
         audio_thread.join();
     }
+
+    // the end of the last file is still in the crossfade
+    if(audio_output && audio_output->output.playback().stream() && !audio_output->output.playback().steam_stopped())
+    {
+        Audio::Output &output{audio_output->output};
+
+        PaError error{output.finish(volume.level())};
+        Utility::portaudio_error_assert((error >= 0), "Failed to play frame", error);
+
+        output.playback().drain();
+
+        error = output.playback().stop_stream();
+        Utility::portaudio_error_assert((error >= 0), "Failed to stop playback stream", error);
+    }
+
+    if(audio_output)
+    {
+        audio_output->output.print_statistics();
+    }
+
+    std::atomic_store<bool>(&cpu_load_running, false);
+
+    for(std::thread &thread : cpu_load_threads)
+    {
+        thread.join();
+    }
+
     return 0;
 }
 
-void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int &current_file_index, std::condition_variable &start_cv, std::condition_variable &paused_cv, std::mutex &mutex)
+void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, Video_Output &output, const Player_Options &options, int &current_file_index, std::condition_variable &start_cv, std::condition_variable &paused_cv, std::mutex &mutex)
 {
     // check for video playback
     if(!shared_vars.video_playback)
@@ -290,12 +869,23 @@ void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int
     error = decoder.init_codec_context(nullptr, thread_count);
     Utility::error_assert((error >= 0), "Failed to initialize FFmpeg Decoder", error);
 
+    // bitmap subtitles are decoded from the packets the video decoder reads anyway, and blended over the video
+    FFmpeg::Subtitle_Decoder subtitle_decoder{};
+    Video::Subtitle_Overlay subtitle_overlay{};
+
+    if(options.subtitles && setup_subtitles(decoder, subtitle_decoder, subtitle_overlay) && options.verbose)
+    {
+        std::cout << "Showing " << avcodec_get_name(subtitle_decoder.codec_context()->codec_id)
+                  << " subtitles from stream " << subtitle_decoder.stream_number() << std::endl;
+    }
+
     // Fill decoder up with data
     while(error != AVERROR(EAGAIN))
     {
         error = decoder.send_packet();
         if(error == AVERROR_EOF)
         {
+            decoder.set_side_stream(-1, nullptr);
             shared_vars.video_playback = false;
             shared_vars.video_waiting = true;
             return;
@@ -313,152 +903,125 @@ void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int
     // Decoder Setup End //
 
 
-    // Get Pixel Format information //
-
-    // pixel format variables
-    enum AVPixelFormat FFMPEG_INPUT_FORMAT{static_cast<enum AVPixelFormat>(decoded_frame->format)};
-    enum AVPixelFormat FFMPEG_OUTPUT_FORMAT;
-    uint32_t SDL_TEXTURE_FORMAT;
-    bool YUV_IMAGE_OUTPUT;
+    // SDL Setup Start //
 
-    // check if rescaling is needed for pixel formats, and get SDL output format
-    bool RESCALING_NEEDED { Utility::rescaling_needed(FFMPEG_INPUT_FORMAT, FFMPEG_OUTPUT_FORMAT, SDL_TEXTURE_FORMAT) };
+    // the window, renderer and texture are kept from the previous video if there was one
+    bool first_video{!output.window.window()};
 
-    // if rescaling is needed, but the FFMPEG_INPUT_FORMAT is not supported then the video cannot be played
-    if(RESCALING_NEEDED && !Utility::valid_rescaling_input(FFMPEG_INPUT_FORMAT))
+    if(first_video)
     {
-        std::cerr << "Cannot play video unsupported pixel format" << std::endl;
-        return;
+        open_video_output(output, options.output_mode, options.verbose, true);
     }
 
-    // check for yuv image output
-    if(FFMPEG_OUTPUT_FORMAT == AV_PIX_FMT_YUV420P ||
-       FFMPEG_OUTPUT_FORMAT == AV_PIX_FMT_NV12 ||
-       FFMPEG_OUTPUT_FORMAT == AV_PIX_FMT_NV21)
+    else
     {
-        YUV_IMAGE_OUTPUT = true;
+        SDL_ShowWindow(output.window);
     }
 
-    // Instantiate a Scale class
-    FFmpeg::Scale rescaler{};
-
-
-    // SDL Setup Start //
-
-    SDL::Initializer sdl_initializer{SDL_INIT_VIDEO};
+    SDL::Renderer &renderer{output.renderer};
+    Texture_Upload &upload{output.upload};
 
-    std::string window_title{"LXPlayer"};
-    SDL::Renderer renderer{};
-    SDL::Texture texture{};
-    SDL_Rect display_rect;
-
-    // screen resolution
-    SDL_Rect screen_resolution{Utility::get_native_resolution()};
-    Utility::error_assert((screen_resolution.w > 0), "Failed to get native screen resolution");
+    // the cached display bounds, they only change if the window is moved to another display or the display changes
+    SDL_Rect screen_resolution{output.display_info.resolution()};
+    int display_changes{output.display_info.changes()};
 
-    // image resolution 
-    SDL_Rect image_resolution;
-    image_resolution.w = decoded_frame->width;
-    image_resolution.h = decoded_frame->height;
+    // Get Pixel Format information //
 
-    // if the image is too big for the screen, downsize it
-    if(image_resolution.w > screen_resolution.w || image_resolution.h > screen_resolution.h)
+    // Instantiate a Scale class, and pick the scaler preset to use
+    FFmpeg::Scale rescaler{};
+    Utility::Scaler_Governor scaler_governor{options.scaler_preset, options.automatic_scaler};
+
+    // check if rescaling is needed for pixel formats and resolution, get SDL output format, and setup the image rescaler if needed
+    Video_Conversion conversion;
+    conversion.scaler_flags = scaler_governor.flags();
+    conversion.tone_map_curve = options.tone_map_curve;
+    conversion.texture_formats = upload.conversion.texture_formats;
+    if(!setup_video_conversion(decoded_frame, screen_resolution, conversion, rescaler))
     {
-        Utility::downsize_resolution(image_resolution, screen_resolution);
-        RESCALING_NEEDED = true;
+        std::cerr << "Cannot play video unsupported pixel format" << std::endl;
+        decoder.set_side_stream(-1, nullptr);
+        return;
     }
 
-    // create the window
-    shared_vars.window = SDL_CreateWindow(window_title.c_str(),   // Window Title
-                                          SDL_WINDOWPOS_CENTERED, // X Position
-                                          SDL_WINDOWPOS_CENTERED, // Y Position
-                                          screen_resolution.w,    // Width
-                                          screen_resolution.h,    // Height
-                                          SDL_WINDOW_RESIZABLE);  // Flags
-    Utility::error_assert(shared_vars.window, "Failed to create window");
-    shared_vars.fullscreen = false;
-
-    // create the renderer
-    renderer = SDL_CreateRenderer(shared_vars.window, // Window to use
-                                  -1,     // Driver Index -1 for auto selection
-                                  SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC); // flags
-    Utility::error_assert(renderer, "Failed to create renderer");
-
-    // create a texture
-    texture = SDL_CreateTexture(renderer,                 // Renderer to use
-                                SDL_TEXTURE_FORMAT,       // Pixel format
-                                SDL_TEXTUREACCESS_STATIC, // Texture access
-                                image_resolution.w,       // Texture width
-                                image_resolution.h);      // Texture height
-    Utility::error_assert(texture, "Failed to create texture");
+    // the path is printed for the first video of the output, for every video with --verbose
+    // the window surface path is printed once the frame's place on the surface is known
+    if(!output.surface_output && (first_video || options.verbose))
+    {
+        std::cout << "Video path: " << texture_path_description(conversion) << std::endl;
+    }
 
+    // frames are presented lined up with the display's refresh rate, if the renderer actually syncs to it
+    Utility::Frame_Scheduler scheduler{options.busy_wait};
+    scheduler.set_refresh_interval(output.refresh_interval);
 
-    // calculate the display rectangle
-    display_rect = Utility::calculate_display_rectangle(image_resolution, screen_resolution);
+    // statistics on how smooth presentation is
+    Video::Frame_Pacing pacing{};
+    pacing.set_refresh_interval(output.refresh_interval);
 
     // SDL Setup End //
 
-    // Setup image rescaler if needed //
-    if(RESCALING_NEEDED)
-    {
-        rescaler = sws_getContext(decoded_frame->width,   // source width
-                                  decoded_frame->height,  // source height
-                                  FFMPEG_INPUT_FORMAT,    // source pixel format
-                                  image_resolution.w,     // destination width
-                                  image_resolution.h,     // destination height
-                                  FFMPEG_OUTPUT_FORMAT,   // destination pixel format
-                                  0,                      // flags
-                                  nullptr,                // src filter
-                                  nullptr,                // dst filter
-                                  nullptr);                
-
-        Utility::error_assert(rescaler.swscontext(), "Failed to get rescaling context", -1111);
-    }
-
     // Get the timebase, framerate and set a buffer size
+    // frames are scheduled by their best effort timestamps, the average frame rate is only used for sizes and estimates
     const AVStream *stream{decoder.format_context()->streams[decoder.stream_number()]};
-    double timebase{static_cast<double>(stream->time_base.num) / stream->time_base.den};
-    int framerate{stream->r_frame_rate.num / stream->r_frame_rate.den};
-    int buffer_size{framerate * 2}; // by default the buffersize is enough frames for 2 seconds
-
-    // Inital Frame Setup //
-    FFmpeg::Frame initial_frame{};
-    error = initial_frame.allocate(FFMPEG_OUTPUT_FORMAT, 
-                                   image_resolution.w,
-                                   image_resolution.h);
-
-    Utility::error_assert((error >= 0), "Failed to allocate initial frame", error);
-
-    // rescale the first image if needed, has to be done before decoding loop is started
-    if(RESCALING_NEEDED)
+    Video::Frame_Timing timing{stream};
+    double timebase{timing.timebase()};
+    double framerate{timing.frame_rate()};
+    int buffer_size{std::max(static_cast<int>(std::ceil(framerate * 2)), 2)}; // by default the buffersize is enough frames for 2 seconds
+
+    // the time one frame is displayed for, conversion has to stay well below this
+    scaler_governor.set_frame_budget(timing.frame_duration());
+
+    // processing stages, only used if the stream or frames are interlaced
+    Video_Filters filters{};
+    filters.deinterlace_mode = options.deinterlace_mode;
+    filters.field_order = stream->codecpar->field_order;
+    filters.verbose = options.verbose;
+    filters.scratch_index = 0;
+    filters.tone_mapped_index = 0;
+
+    // make sure the first texture fits the first image, and calculate the display rectangle
+    // the texture is only recreated if the previous video needed a different one, the others are prepared as they get used
+    if(!output.surface_output)
     {
-        error = sws_scale(rescaler,                       // Rescaling context to use
-                decoded_frame->data,                      // Source data
-                decoded_frame->linesize,                  // Source linesize
-                0,                                        // Y position in source image
-                decoded_frame->height,                    // height of the source image
-                initial_frame->data,                      // destination data
-                initial_frame->linesize);                 // destination linesize
+        error = prepare_texture(output.textures[0], renderer, conversion, screen_resolution, output.display_rects[0], upload.streaming);
+        Utility::error_assert((error >= 0), "Failed to create texture");
 
-        Utility::error_assert((error >= 0), "Failed to rescale initial image", error);
+        if(first_video)
+        {
+            std::cout << "Using " << (upload.streaming ? "streaming" : "static") << " textures" << std::endl;
+        }
     }
 
-    else
+    // the presenting thread keeps it's own conversion, set up from the queued frames
+    // the window surface takes frames as decoded too, it converts and scales them itself
+    conversion.streaming = upload.streaming;
+    upload.conversion.scaler_flags = scaler_governor.flags();
+
+    // queued frames that are only referenced pin the decoder's buffers, so the ring is kept shorter then
+    if(conversion.streaming)
     {
-        initial_frame.copy(decoded_frame);
+        buffer_size = std::min(buffer_size, std::max(static_cast<int>(std::ceil(framerate * STREAMING_BUFFER_SECONDS)), 2));
     }
 
+    // Inital Frame Setup //
+    FFmpeg::Frame initial_frame{};
+
+    // queue the first image, has to be done before decoding loop is started
+    decoded_frame->pts = timing.timestamp(decoded_frame);
+    error = queue_frame(conversion, rescaler, filters, decoded_frame, initial_frame);
+    Utility::error_assert((error >= 0), "Failed to convert initial image", error);
+
     // make an array for the decoded video frames
     FFmpeg::Frame_Array decoded_frames{buffer_size};
 
     // allocate every frame in the array
     // This helps with performance by reducing the allocate / deallocate system calls
-    // The frames are allocated once and deallocated once
+    // The frames are allocated once and deallocated once, unless the video changes size or pixel format
     for(int i{0}; i != decoded_frames.size(); ++i)
     {
-        error = decoded_frames[i].allocate(FFMPEG_OUTPUT_FORMAT,
-                                           image_resolution.w,
-                                           image_resolution.h);
+        error = decoded_frames[i].allocate(conversion.output_format,
+                                           conversion.output_resolution.w,
+                                           conversion.output_resolution.h);
         Utility::error_assert((error >= 0), "Failed to allocate an AVFrame", error);
     }
 
@@ -466,29 +1029,45 @@ void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int
     Utility::Semaphore spots_filled{0};
     Utility::Semaphore spots_empty{buffer_size};
 
+    Decoder_Statistics decoder_statistics{};
+
     // create a new thread to decode the frames
     std::thread decoder_thread{decoder_thread_function,  // function for thread to call
                                std::ref(decoder),        // Decoder to use
                                std::ref(rescaler),       // The image rescaler to use
-                               RESCALING_NEEDED,         // a boolean indicating to rescale the image
+                               std::ref(scaler_governor),// Picks the scaler preset to use
+                               std::ref(filters),        // Processing stages like deinterlacing
+                               conversion,               // The current conversion, the decoder thread keeps it's own copy
+                               std::cref(output.display_info), // The screen resolution, needed if the video or display changes size
+                               std::ref(timing),         // Gives the frames their timestamps
                                std::ref(decoded_frames), // Frame_Array to store decoded frames
                                std::ref(spots_filled),   // Semaphore holding total spots filled
                                std::ref(spots_empty),    // Semaphore holding total spots empty / not filled
-                               std::ref(shared_vars)};
+                               std::ref(shared_vars),
+                               std::ref(decoder_statistics)}; // Time spent decoding and converting
+
+    // wait for the first few frames, the rest of the ring fills up during playback
+    int prefill_frames{options.prefill_in_ms ? static_cast<int>(std::ceil(options.prefill * framerate / 1000.0)) : options.prefill};
+    prefill_frames = std::min(std::max(prefill_frames, 1), buffer_size);
+
+    auto prefill_start{std::chrono::steady_clock::now()};
+    spots_filled.wait_for_count(prefill_frames);
+    std::chrono::duration<double> prefill_time{std::chrono::steady_clock::now() - prefill_start};
 
-    while(spots_filled.count() != buffer_size)
+    if(options.verbose)
     {
+        std::cout << "Prefilled " << prefill_frames << " frames in " << prefill_time.count() * 1000.0 << " ms" << std::endl;
     }
 
-    // start the listening thread
+    // a stop event may be left over from the previous video, if it's listening thread had already returned
+    SDL_FlushEvent(SDL_USEREVENT);
+
+    // start the listening thread, it is stopped when this video ends, the next video starts its own
     std::thread listen_thread{sdl_listen_thread_func,
                               std::ref(shared_vars),
                               std::ref(current_file_index),
                               std::ref(paused_cv)};
 
-    // detach the listening thread
-    listen_thread.detach();
-
     // make sure audio thread and video thread, this thread, start at the same time
     std::unique_lock<std::mutex> lock{mutex};
 
@@ -513,27 +1092,48 @@ void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int
         lock.unlock();
     }
 
-    // sleep for however long the audio latency is, this will negate the latency
-    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(shared_vars.audio_latency * 1000)));
+    // the audio thread makes the clock follow the audio once its stream started, which covers the audio latency,
+    // until then, and for video without audio, it runs on the steady clock
+    Video::Master_Clock &master_clock{*shared_vars.master_clock};
+    master_clock.start(initial_frame->pts * timebase);
 
     // render the first image
-    if(YUV_IMAGE_OUTPUT)
+    if(output.surface_output)
     {
-        error = render_yuv_frame(texture, &display_rect, renderer, initial_frame);
-        Utility::error_assert((error >= 0), "Failed to render initial YUV frame");
+        error = draw_to_surface(output.surface, output.window, scaler_governor, initial_frame, options.verbose);
+        Utility::error_assert((error >= 0), "Failed to draw initial frame");
+
+        error = present_surface(output.window, nullptr, nullptr);
+        Utility::error_assert((error >= 0), "Failed to present initial frame");
     }
 
     else
     {
-        error = render_frame(texture, &display_rect, renderer, initial_frame);
+        error = upload_frame(upload, output.textures[0], renderer, scaler_governor, screen_resolution, output.display_rects[0], initial_frame);
+        Utility::error_assert((error >= 0), "Failed to upload initial frame");
+
+        error = render_texture(output.textures[0], &output.display_rects[0], renderer, nullptr, nullptr);
         Utility::error_assert((error >= 0), "Failed to render initial frame");
     }
 
+    scheduler.presented();
+
     int current_index{0};
-    double wait_time{0.0}; // time spend waiting / paused
+    int texture_index{0}; // texture in the ring that is on screen
+
+    // drift correction, frames dropped because they were late on the clock, and frame durations a frame was held waiting for it
+    double frame_duration{timing.frame_duration()};
+    double last_frame_time{initial_frame->pts * timebase};
+    long dropped_frames{0};
+    long repeated_frames{0};
+    bool audio_master{false};
+
+    // time spent getting frames into a texture / the window surface, and presenting them, to compare the output modes
+    double upload_seconds{0.0};
+    double present_seconds{0.0};
+    int presented_frames{0};
 
-    auto start_time{std::chrono::steady_clock::now()};
-    auto last_frame_time{start_time};
+    pacing.record(master_clock.time(), last_frame_time);
 
     while(1)
     {
@@ -546,15 +1146,14 @@ void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int
                 break;
             }
 
-            auto pause_start{std::chrono::steady_clock::now()};
-            // if paused wait until awoken
+            // if paused wait until awoken, the audio clock stops with the audio stream
+            master_clock.pause();
+
             lock.lock();
             paused_cv.wait(lock);
             lock.unlock();
-            auto pause_end{std::chrono::steady_clock::now()};
-            std::chrono::duration<double> difference{pause_end - pause_start};
 
-            wait_time += difference.count();
+            master_clock.resume();
 
             // check if skipping
             if(std::atomic_load<bool>(&shared_vars.skipping))
@@ -575,191 +1174,1897 @@ void video_playback(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int
             break;
         }
 
-        double frame_display_time{decoded_frames[current_index]->pts * timebase};
-        auto current_time{std::chrono::steady_clock::now()};
-        std::chrono::duration<double> difference{current_time - start_time};
+        // time the frame is due, how far its time is ahead of the clock
+        double frame_time{decoded_frames[current_index]->pts * timebase};
+        double clock_time{master_clock.time()};
+        auto clock_read_time{std::chrono::steady_clock::now()};
+        double delay{frame_time - clock_time};
+
+        audio_master = audio_master || master_clock.audio_master();
+
+        // more than a frame late, and the next frame is already decoded, skip this one to catch up, the previous frame stays on screen
+        // if the next one isn't there yet this one is shown late, so a slow decoder still shows something
+        if(delay < -frame_duration && spots_filled.count() > 0)
+        {
+            spots_empty.post();
+            last_frame_time = frame_time;
+            dropped_frames++;
+            current_index++;
+            continue;
+        }
+
+        // the clock is behind, the previous frame stays on screen longer than its own duration until this one is due
+        double frame_interval{frame_time - last_frame_time};
+        if(delay > frame_interval + frame_duration / 2.0)
+        {
+            repeated_frames += std::lround((delay - frame_interval) / frame_duration);
+        }
+
+        last_frame_time = frame_time;
+
+        auto due_time{clock_read_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{delay})};
+
+        // the frame is uploaded into the next texture in the ring while the current one is still on screen,
+        // so only the copy and present are left for when it's due
+        texture_index = (texture_index + 1) % Video_Output::TEXTURE_RING_SIZE;
+        SDL::Texture &texture{output.textures[texture_index]};
+        SDL_Rect &display_rect{output.display_rects[texture_index]};
+
+        // the window moved to another display, or the display changed, set up the conversion and display rectangle again
+        if(output.display_info.changes() != display_changes)
+        {
+            display_changes = output.display_info.changes();
+            screen_resolution = output.display_info.resolution();
+            upload.conversion.input_format = AV_PIX_FMT_NONE;
+        }
+
+        auto upload_start{std::chrono::steady_clock::now()};
+
+        // without a renderer the frame goes straight into the window surface, which is only shown once it's due
+        if(output.surface_output)
+        {
+            error = draw_to_surface(output.surface, output.window, scaler_governor, decoded_frames[current_index], options.verbose);
+            Utility::error_assert((error >= 0), "Failed to draw frame");
+        }
+
+        // if the video changed size or pixel format, the texture is recreated here
+        else
+        {
+            error = upload_frame(upload, texture, renderer, scaler_governor, screen_resolution, display_rect, decoded_frames[current_index]);
+            Utility::error_assert((error >= 0), "Failed to upload frame");
+        }
+
+        std::chrono::duration<double> upload_time{std::chrono::steady_clock::now() - upload_start};
+        upload_seconds += upload_time.count();
+
+        // the frame is in the texture, the decoder can reuse its spot
+        spots_empty.post();
+
+        // the subtitle texture, or surface, is only updated when a different subtitle has to be shown, the window surface blends it every frame
+        if(subtitle_overlay.update(frame_time) && subtitle_overlay.current())
+        {
+            if(output.surface_output)
+            {
+                error = update_surface_subtitle(output.surface, *subtitle_overlay.current());
+            }
+
+            else
+            {
+                error = upload_subtitle(output.subtitle_texture, renderer, *subtitle_overlay.current());
+            }
+
+            Utility::error_assert((error >= 0), "Failed to upload subtitle");
+        }
+
+        SDL_Texture *subtitle_texture{nullptr};
+        SDL_Surface *subtitle_surface{nullptr};
+        SDL_Rect subtitle_rect{};
+
+        if(subtitle_overlay.current())
+        {
+            subtitle_texture = output.subtitle_texture;
+            subtitle_surface = output.surface.subtitle_surface;
+            subtitle_rect = subtitle_rectangle(subtitle_overlay, output.surface_output ? output.surface.display_rect : display_rect);
+        }
+
+        scheduler.wait_until(scheduler.align(due_time));
+
+        auto render_start{std::chrono::steady_clock::now()};
+
+        if(output.surface_output)
+        {
+            error = present_surface(output.window, subtitle_surface, &subtitle_rect);
+        }
+
+        else
+        {
+            error = render_texture(texture, &display_rect, renderer, subtitle_texture, &subtitle_rect);
+        }
+
+        Utility::error_assert((error >= 0), "Failed to render frame");
+        scheduler.presented();
+
+        std::chrono::duration<double> render_time{std::chrono::steady_clock::now() - render_start};
+        present_seconds += render_time.count();
+        presented_frames++;
+
+        pacing.record(master_clock.time(), frame_time);
+
+        if(std::atomic_exchange<bool>(&shared_vars.print_statistics, false))
+        {
+            pacing.print();
+            scheduler.print_statistics();
+
+            std::cout << "A/V sync (" << (audio_master ? "audio" : "steady") << " clock master): "
+                      << dropped_frames << " frames dropped, " << repeated_frames << " frame durations repeated" << std::endl;
+        }
+
+        current_index++;
+    }
+
+    decoder_thread.join();
+
+    // stop the listening thread, it returns on its own when skipping
+    SDL_Event stop_event{};
+    stop_event.type = SDL_USEREVENT;
+    SDL_PushEvent(&stop_event);
+    listen_thread.join();
+
+    // the subtitle decoder and overlay are gone after this video
+    decoder.set_side_stream(-1, nullptr);
+
+    pacing.print();
+    scheduler.print_statistics();
+
+    if(options.verbose)
+    {
+        std::cout << "A/V sync (" << (audio_master ? "audio" : "steady") << " clock master): "
+                  << dropped_frames << " frames dropped, " << repeated_frames << " frame durations repeated" << std::endl;
+    }
+
+    // the frame rate the output could keep up with if nothing else took time, for comparing --output=renderer and --output=surface
+    // presenting with vsync mostly waits for the next refresh, that frame rate is only known without it, from --benchmark with --output
+    if(options.verbose && presented_frames > 0)
+    {
+        double upload_ms{upload_seconds * 1000.0 / presented_frames};
+        double present_ms{present_seconds * 1000.0 / presented_frames};
+
+        std::cout << "Presentation (" << (output.surface_output ? "window surface" : "renderer") << "): "
+                  << upload_ms << " ms " << (output.surface_output ? "drawing" : "uploading") << ", "
+                  << present_ms << " ms presenting per frame";
+
+        if(output.refresh_interval > 0.0)
+        {
+            std::cout << " (presenting includes waiting for vsync)";
+        }
+
+        else
+        {
+            std::cout << ", up to " << 1000.0 / std::max(upload_ms + present_ms, 0.001) << " fps";
+        }
+
+        std::cout << std::endl;
+    }
+
+    if(options.verbose && subtitle_decoder.stream_number() >= 0)
+    {
+        std::cout << "Subtitle overlay changed " << subtitle_overlay.changes() << " times" << std::endl;
+    }
+
+    if(options.verbose && timing.estimated_timestamps() > 0)
+    {
+        std::cout << "Estimated timestamps for " << timing.estimated_timestamps() << " frames without usable ones" << std::endl;
+    }
+}
+
+
+/* open_video_output function
+ * Description: initializes SDL video, and creates the window and renderer. Exits the program on failure
+ * The texture is created later, once the pixel format and size of the first video are known
+ * Parameter: output - the video output to open
+ * Parameter: mode - in auto mode video is drawn into the window surface if no hardware accelerated renderer can be created
+ * Parameter: verbose - print the renderer's native texture formats, not only its name, or that there is no renderer
+ * Parameter: vsync - have the renderer wait for vsync when presenting, the benchmark presents without it
+ */
+void open_video_output(Video_Output &output, Output_Mode mode, bool verbose, bool vsync)
+{
+    output.sdl_initializer.reset(new SDL::Initializer{SDL_INIT_VIDEO});
+
+    // screen resolution, read once here, after that only display and window move events update it
+    output.display_info.update(nullptr);
+    SDL_Rect screen_resolution{output.display_info.resolution()};
+    Utility::error_assert((screen_resolution.w > 0), "Failed to get native screen resolution");
+
+    // create the window
+    output.window = SDL_CreateWindow("LXPlayer",                     // Window Title
+                                     SDL_WINDOWPOS_CENTERED,         // X Position
+                                     SDL_WINDOWPOS_CENTERED,         // Y Position
+                                     screen_resolution.w,            // Width
+                                     screen_resolution.h,            // Height
+                                     SDL_WINDOW_RESIZABLE);          // Flags
+    Utility::error_assert(output.window, "Failed to create window");
+    output.fullscreen = false;
+
+    // the window may have been placed on another display than the first one
+    output.display_info.update(output.window);
+
+    // a streaming texture is tried first, if it can't be locked a static texture is used instead
+    // the window surface doesn't use the upload conversion, its texture formats only tell the decoder thread what to queue
+    output.upload.streaming = true;
+    output.upload.conversion.tone_map_curve = Video::TONE_MAP_OFF;
+    output.upload.conversion.input_format = AV_PIX_FMT_NONE;
+    output.upload.conversion.texture_formats.clear();
+    output.refresh_interval = 0.0;
+
+    // create the renderer
+    if(mode != OUTPUT_SURFACE)
+    {
+        output.renderer = SDL_CreateRenderer(output.window, // Window to use
+                                             -1,            // Driver Index -1 for auto selection
+                                             SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0)); // flags
+
+        // no GPU, SDL's software renderer
+        if(!output.renderer && mode == OUTPUT_RENDERER)
+        {
+            output.renderer = SDL_CreateRenderer(output.window, -1, 0);
+        }
+    }
+
+    output.surface_output = !output.renderer;
+
+    if(output.surface_output)
+    {
+        SDL_Surface *surface{SDL_GetWindowSurface(output.window)};
+        Utility::error_assert(surface, "Failed to get window surface");
+
+        output.surface.surface = nullptr;
+        output.surface.input_format = AV_PIX_FMT_NONE;
+
+        // filtered frames are queued as YUV420P, the format the SIMD conversion takes
+        output.upload.conversion.texture_formats.push_back(SDL_PIXELFORMAT_IYUV);
+
+        Utility::error_assert((surface_pixel_format(surface->format->format) != AV_PIX_FMT_NONE), "Window surface pixel format not supported");
+
+        if(verbose)
+        {
+            std::cout << "No renderer, drawing into the " << SDL_GetPixelFormatName(surface->format->format) << " window surface" << std::endl;
+        }
+
+        return;
+    }
+
+    // the refresh interval is only used if the renderer actually syncs to vsync
+    SDL_RendererInfo renderer_info;
+    SDL_DisplayMode display_mode;
+
+    bool renderer_info_valid{SDL_GetRendererInfo(output.renderer, &renderer_info) >= 0};
+
+    if(renderer_info_valid && (renderer_info.flags & SDL_RENDERER_PRESENTVSYNC) &&
+       SDL_GetWindowDisplayMode(output.window, &display_mode) >= 0 && display_mode.refresh_rate > 0)
+    {
+        output.refresh_interval = 1.0 / display_mode.refresh_rate;
+    }
+
+    // texture formats the renderer can draw without converting them first, video is converted into one of these
+    if(renderer_info_valid)
+    {
+        std::cout << "Renderer " << renderer_info.name;
+
+        if(verbose)
+        {
+            std::cout << ", native texture formats:";
+        }
+
+        for(uint32_t i{0}; i != renderer_info.num_texture_formats; ++i)
+        {
+#if !SDL_VERSION_ATLEAST(2, 0, 16)
+            // update_texture() can only upload NV12 / NV21 with SDL_UpdateNVTexture
+            if(renderer_info.texture_formats[i] == SDL_PIXELFORMAT_NV12 || renderer_info.texture_formats[i] == SDL_PIXELFORMAT_NV21)
+            {
+                continue;
+            }
+#endif
+
+            output.upload.conversion.texture_formats.push_back(renderer_info.texture_formats[i]);
+
+            if(verbose)
+            {
+                std::cout << " " << SDL_GetPixelFormatName(renderer_info.texture_formats[i]);
+            }
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+/* setup_subtitles function
+ * Description: looks for a bitmap subtitle stream in the file the video decoder has open, and opens a decoder for it
+ * The video decoder then hands the stream's packets to the subtitle decoder while demuxing, and decoded subtitles go into the overlay
+ * Parameter: decoder - the video decoder, it has to stay alive as long as subtitle_decoder and overlay, or the side stream has to be reset
+ * Parameter: subtitle_decoder - the subtitle decoder to set up
+ * Parameter: overlay - gets the decoded subtitles
+ * Return: true if the file has bitmap subtitles that can be shown
+ */
+bool setup_subtitles(FFmpeg::Decoder &decoder, FFmpeg::Subtitle_Decoder &subtitle_decoder, Video::Subtitle_Overlay &overlay)
+{
+    const AVFormatContext *format_context{decoder.format_context()};
+
+    int stream_number{subtitle_decoder.find_stream(format_context, decoder.stream_number())};
+    if(stream_number < 0)
+    {
+        return false;
+    }
+
+    int error{subtitle_decoder.init_codec_context(format_context)};
+    if(error < 0)
+    {
+        Utility::print_error("Failed to open subtitle decoder, subtitles won't be shown", error);
+        subtitle_decoder.free_resources();
+        return false;
+    }
+
+    // subtitle positions are relative to the subtitle canvas, which is the video size if the stream doesn't say otherwise
+    const AVCodecContext *codec_context{subtitle_decoder.codec_context()};
+    const AVCodecParameters *video_parameters{format_context->streams[decoder.stream_number()]->codecpar};
+
+    if(codec_context->width > 0 && codec_context->height > 0)
+    {
+        overlay.set_canvas_size(codec_context->width, codec_context->height);
+    }
+
+    else
+    {
+        overlay.set_canvas_size(video_parameters->width, video_parameters->height);
+    }
+
+    // called on the decoder thread while it demuxes
+    decoder.set_side_stream(stream_number, [&subtitle_decoder, &overlay](AVPacket *packet)
+    {
+        AVSubtitle subtitle;
+
+        if(subtitle_decoder.decode(packet, &subtitle) > 0)
+        {
+            overlay.add(subtitle);
+            avsubtitle_free(&subtitle);
+        }
+    });
+
+    return true;
+}
+
+/* upload_subtitle function
+ * Description: uploads a subtitle image into the subtitle texture, the texture is recreated if the image has a different size
+ * Parameter: texture - the subtitle texture, an alpha blended ARGB texture
+ * Parameter: renderer - the renderer the texture belongs to
+ * Parameter: image - the subtitle to show
+ * Return: negative value on failure, a value >= 0 on success
+ */
+int upload_subtitle(SDL::Texture &texture, SDL::Renderer &renderer, const Video::Subtitle_Image &image)
+{
+    int error{0};
+
+    int texture_width{0};
+    int texture_height{0};
+
+    if(texture.texture())
+    {
+        error = SDL_QueryTexture(texture, nullptr, nullptr, &texture_width, &texture_height);
+        if(error < 0)
+        {
+            return error;
+        }
+    }
+
+    if(texture_width != image.width || texture_height != image.height)
+    {
+        if(texture.texture())
+        {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+
+        texture = SDL_CreateTexture(renderer,                 // Renderer to use
+                                    SDL_PIXELFORMAT_ARGB8888, // Pixel format, the same layout as FFmpeg's subtitle palettes
+                                    SDL_TEXTUREACCESS_STATIC, // Texture access
+                                    image.width,              // Texture width
+                                    image.height);            // Texture height
+        if(!texture)
+        {
+            return -1;
+        }
+
+        error = SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        if(error < 0)
+        {
+            return error;
+        }
+    }
+
+    return SDL_UpdateTexture(texture, nullptr, image.pixels.data(), image.width * static_cast<int>(sizeof(uint32_t)));
+}
+
+// maps the shown subtitle from the subtitle canvas onto the display rectangle of the video
+SDL_Rect subtitle_rectangle(const Video::Subtitle_Overlay &overlay, const SDL_Rect &display_rect)
+{
+    const Video::Subtitle_Image *image{overlay.current()};
+    SDL_Rect rect{};
+
+    if(!image || overlay.canvas_width() <= 0 || overlay.canvas_height() <= 0)
+    {
+        return rect;
+    }
+
+    rect.x = display_rect.x + image->x * display_rect.w / overlay.canvas_width();
+    rect.y = display_rect.y + image->y * display_rect.h / overlay.canvas_height();
+    rect.w = image->width * display_rect.w / overlay.canvas_width();
+    rect.h = image->height * display_rect.h / overlay.canvas_height();
+
+    return rect;
+}
+
+/* upload_frame function
+ * Description: gets a queued frame into the texture. The presenting conversion and the texture are set up again if the frame
+ * changed size or pixel format, then the frame is rescaled or copied into locked texture memory, or uploaded with SDL_UpdateTexture
+ * If the texture can't be locked, streaming is turned off and static textures are used from then on
+ * Parameter: upload - the presenting conversion
+ * Parameter: frame - the queued frame, either as it was decoded, or already converted by the decoder thread
+ * Return: negative value on failure, a value >= 0 on success
+ */
+int upload_frame(Texture_Upload &upload,
+                 SDL::Texture &texture,
+                 SDL::Renderer &renderer,
+                 Utility::Scaler_Governor &scaler_governor,
+                 SDL_Rect &screen_resolution,
+                 SDL_Rect &display_rect,
+                 AVFrame *frame)
+{
+    int error{0};
+
+    // the scaler preset may have been changed by the governor
+    if(conversion_changed(upload.conversion, frame) || upload.conversion.scaler_flags != scaler_governor.flags())
+    {
+        upload.conversion.scaler_flags = scaler_governor.flags();
+
+        if(!setup_video_conversion(frame, screen_resolution, upload.conversion, upload.rescaler))
+        {
+            return -1;
+        }
+    }
+
+    error = prepare_texture(texture, renderer, upload.conversion, screen_resolution, display_rect, upload.streaming);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    auto conversion_start{std::chrono::steady_clock::now()};
+
+    error = write_texture(upload, texture, frame);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    // in streaming mode the rescaling is done here, so the governor is fed from this thread
+    if(upload.conversion.rescaling_needed)
+    {
+        std::chrono::duration<double> conversion_time{std::chrono::steady_clock::now() - conversion_start};
+        scaler_governor.record(conversion_time.count());
+    }
+
+    return error;
+}
+
+// rescales / copies a frame into the texture, with a single write into locked texture memory if the texture is streaming
+int write_texture(Texture_Upload &upload, SDL::Texture &texture, AVFrame *frame)
+{
+    int error{0};
+
+    if(upload.streaming)
+    {
+        void *pixels{nullptr};
+        int pitch{0};
+
+        error = SDL_LockTexture(texture, nullptr, &pixels, &pitch);
+        if(error >= 0)
+        {
+            uint8_t *data[4]{nullptr, nullptr, nullptr, nullptr};
+            int linesize[4]{0, 0, 0, 0};
+
+            texture_planes(upload.conversion.sdl_format, pixels, pitch, upload.conversion.output_resolution.h, data, linesize);
+
+            if(upload.conversion.rescaling_needed)
+            {
+                error = sws_scale(upload.rescaler, frame->data, frame->linesize, 0, frame->height, data, linesize);
+            }
+
+            else
+            {
+                av_image_copy(data,
+                              linesize,
+                              const_cast<const uint8_t**>(frame->data),
+                              frame->linesize,
+                              static_cast<enum AVPixelFormat>(frame->format),
+                              frame->width,
+                              frame->height);
+            }
+
+            SDL_UnlockTexture(texture);
+            return error;
+        }
 
-        while((difference.count() - wait_time) < frame_display_time)
+        // the texture is recreated as a static texture the next time one is prepared
+        Utility::print_error("Failed to lock texture, falling back to static textures");
+        upload.streaming = false;
+    }
+
+    AVFrame *source{frame};
+
+    if(upload.conversion.rescaling_needed)
+    {
+        error = prepare_frame(upload.staging_frame,
+                              upload.conversion.output_format,
+                              upload.conversion.output_resolution.w,
+                              upload.conversion.output_resolution.h);
+        if(error < 0)
         {
-            current_time = std::chrono::steady_clock::now();
-            difference = current_time - start_time;
+            return error;
         }
 
-        if(YUV_IMAGE_OUTPUT)
+        error = rescale_frame(upload.rescaler, frame, upload.staging_frame);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        source = upload.staging_frame;
+    }
+
+    return update_texture(texture, source, upload.conversion.sdl_format);
+}
+
+// updates the texture with the provided frame, frame must already have the texture's pixel format and size
+// planar and semi-planar formats are uploaded plane by plane, FFmpeg doesn't keep the planes right after each other like SDL expects
+int update_texture(SDL::Texture &texture, AVFrame *frame, uint32_t sdl_format)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 16)
+    if(sdl_format == SDL_PIXELFORMAT_NV12 || sdl_format == SDL_PIXELFORMAT_NV21)
+    {
+        return SDL_UpdateNVTexture(texture,
+                                   nullptr,
+                                   frame->data[0],
+                                   frame->linesize[0],
+                                   frame->data[1],
+                                   frame->linesize[1]);
+    }
+#endif
+
+    if(sdl_format == SDL_PIXELFORMAT_YV12 || sdl_format == SDL_PIXELFORMAT_IYUV)
+    {
+        return SDL_UpdateYUVTexture(texture,
+                                    nullptr,
+                                    frame->data[0],
+                                    frame->linesize[0],
+                                    frame->data[1],
+                                    frame->linesize[1],
+                                    frame->data[2],
+                                    frame->linesize[2]);
+    }
+
+    return SDL_UpdateTexture(texture,
+                             nullptr,
+                             frame->data[0],
+                             frame->linesize[0]);
+}
+
+// clears the screen, then copies the texture into the display rectangle, blends the overlay (if not nullptr) over it and presents it
+int render_texture(SDL::Texture &texture, SDL_Rect *dst_rect, SDL::Renderer &renderer, SDL_Texture *overlay, const SDL_Rect *overlay_rect)
+{
+    int error{0};
+
+    // clear the screen
+    error = SDL_RenderClear(renderer);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    // copy the data into the renderer
+    error = SDL_RenderCopy(renderer, texture, nullptr, dst_rect);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    // blend the overlay on top, if there is one
+    if(overlay)
+    {
+        error = SDL_RenderCopy(renderer, overlay, nullptr, overlay_rect);
+        if(error < 0)
+        {
+            return error;
+        }
+    }
+
+    // present the image
+    SDL_RenderPresent(renderer);
+    return error;
+}
+
+/* draw_to_surface function
+ * Description: converts and scales a frame straight into its display rectangle on the window surface, the surface is shown later by present_surface
+ * YUV420P frames on a 32 bit surface go through the SIMD conversion, scaled by swscale to the display rectangle first if they aren't shown
+ * at their own size. Everything else is converted and scaled by swscale straight into the surface
+ * The display rectangle is calculated again, and the borders cleared, when the window surface or the frame size changes
+ * Parameter: output - the window surface state
+ * Parameter: window - the window whose surface is drawn into
+ * Parameter: scaler_governor - picks the scaler preset, and is fed the time swscale takes
+ * Parameter: frame - a queued frame
+ * Parameter: verbose - print the video path every time it changes, not only for the first frame drawn
+ * Return: negative value on failure, a value >= 0 on success
+ */
+int draw_to_surface(Surface_Output &output, SDL::Window &window, Utility::Scaler_Governor &scaler_governor, AVFrame *frame, bool verbose)
+{
+    int error{0};
+
+    // recreated by SDL after the window was resized
+    SDL_Surface *surface{SDL_GetWindowSurface(window)};
+    if(!surface)
+    {
+        return -1;
+    }
+
+    enum AVPixelFormat surface_format{surface_pixel_format(surface->format->format)};
+    if(surface_format == AV_PIX_FMT_NONE)
+    {
+        return -1;
+    }
+
+    enum AVPixelFormat input_format{static_cast<enum AVPixelFormat>(frame->format)};
+
+    bool layout_changed{false};
+
+    // nothing was drawn since the output was opened, the path is printed then even without --verbose
+    bool first_draw{output.input_format == AV_PIX_FMT_NONE};
+
+    if(surface != output.surface || surface->w != output.surface_width || surface->h != output.surface_height ||
+       input_format != output.input_format || frame->width != output.input_width || frame->height != output.input_height)
+    {
+        output.surface = surface;
+        output.surface_width = surface->w;
+        output.surface_height = surface->h;
+        output.input_format = input_format;
+        output.input_width = frame->width;
+        output.input_height = frame->height;
+
+        SDL_Rect image_resolution{0, 0, frame->width, frame->height};
+        SDL_Rect surface_resolution{0, 0, surface->w, surface->h};
+
+        output.display_rect = Utility::calculate_display_rectangle(image_resolution, surface_resolution);
+
+        // only the display rectangle is drawn every frame, the borders stay black
+        error = SDL_FillRect(surface, nullptr, SDL_MapRGB(surface->format, 0, 0, 0));
+        if(error < 0)
+        {
+            return error;
+        }
+
+        layout_changed = true;
+    }
+
+    // the SIMD conversion writes 32 bit BGRX pixels and doesn't scale, swscale scales in YUV for it, which is cheaper than scaling to RGB
+    bool direct{Video::Yuv_To_Rgb::supported(input_format) &&
+                (surface_format == AV_PIX_FMT_BGR0 || surface_format == AV_PIX_FMT_BGRA)};
+    bool scaled{output.display_rect.w != frame->width || output.display_rect.h != frame->height};
+
+    if(layout_changed && (first_draw || verbose))
+    {
+        std::cout << "Video path: " << av_get_pix_fmt_name(input_format)
+                  << (direct ? (scaled ? " -> swscale scaling -> SIMD YUV to RGB -> " : " -> SIMD YUV to RGB -> ") : " -> swscale -> ")
+                  << SDL_GetPixelFormatName(surface->format->format) << " window surface at "
+                  << output.display_rect.w << "x" << output.display_rect.h << std::endl;
+    }
+
+    // the frame the SIMD conversion reads, scaled in YUV420P to the display rectangle if needed
+    AVFrame *source_frame{frame};
+
+    if(direct && scaled)
+    {
+        // sws_getCachedContext reuses the old context if nothing changed
+        output.rescaler = sws_getCachedContext(output.rescaler,               // old context
+                                               frame->width,                  // source width
+                                               frame->height,                 // source height
+                                               input_format,                  // source pixel format
+                                               output.display_rect.w,         // destination width
+                                               output.display_rect.h,         // destination height
+                                               input_format,                  // destination pixel format
+                                               scaler_governor.flags(),       // flags, the scaler preset
+                                               nullptr,                       // src filter
+                                               nullptr,                       // dst filter
+                                               nullptr);
+        if(!output.rescaler.swscontext())
+        {
+            return -1;
+        }
+
+        error = prepare_frame(output.scaled_frame, input_format, output.display_rect.w, output.display_rect.h);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        auto conversion_start{std::chrono::steady_clock::now()};
+
+        error = rescale_frame(output.rescaler, frame, output.scaled_frame);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        std::chrono::duration<double> conversion_time{std::chrono::steady_clock::now() - conversion_start};
+        scaler_governor.record(conversion_time.count());
+
+        // the matrix of an untagged frame is guessed from its height, so it's guessed from the decoded height, not the scaled one
+        source_frame = output.scaled_frame;
+        source_frame->color_range = frame->color_range;
+        source_frame->colorspace = frame->colorspace;
+
+        if(frame->colorspace != AVCOL_SPC_BT709 && frame->colorspace != AVCOL_SPC_BT470BG && frame->colorspace != AVCOL_SPC_SMPTE170M)
+        {
+            source_frame->colorspace = frame->height >= 720 ? AVCOL_SPC_BT709 : AVCOL_SPC_BT470BG;
+        }
+    }
+
+    if(SDL_MUSTLOCK(surface))
+    {
+        error = SDL_LockSurface(surface);
+        if(error < 0)
+        {
+            return error;
+        }
+    }
+
+    // top left corner of the display rectangle
+    uint8_t *pixels{static_cast<uint8_t*>(surface->pixels) +
+                    output.display_rect.y * surface->pitch +
+                    output.display_rect.x * surface->format->BytesPerPixel};
+
+    if(direct)
+    {
+        // the threads are only started once a frame can use them
+        if(!output.converter)
+        {
+            output.thread_pool.reset(new Utility::Thread_Pool{0});
+            output.converter.reset(new Video::Yuv_To_Rgb{*output.thread_pool});
+        }
+
+        error = output.converter->process(source_frame, pixels, surface->pitch);
+    }
+
+    else
+    {
+        // sws_getCachedContext reuses the old context if nothing changed
+        output.rescaler = sws_getCachedContext(output.rescaler,               // old context
+                                               frame->width,                  // source width
+                                               frame->height,                 // source height
+                                               input_format,                  // source pixel format
+                                               output.display_rect.w,         // destination width
+                                               output.display_rect.h,         // destination height
+                                               surface_format,                // destination pixel format
+                                               scaler_governor.flags(),       // flags, the scaler preset
+                                               nullptr,                       // src filter
+                                               nullptr,                       // dst filter
+                                               nullptr);
+
+        if(!output.rescaler.swscontext())
+        {
+            error = -1;
+        }
+
+        else
+        {
+            uint8_t *data[4]{pixels, nullptr, nullptr, nullptr};
+            int linesize[4]{surface->pitch, 0, 0, 0};
+
+            auto conversion_start{std::chrono::steady_clock::now()};
+
+            error = sws_scale(output.rescaler, frame->data, frame->linesize, 0, frame->height, data, linesize);
+
+            std::chrono::duration<double> conversion_time{std::chrono::steady_clock::now() - conversion_start};
+            scaler_governor.record(conversion_time.count());
+        }
+    }
+
+    if(SDL_MUSTLOCK(surface))
+    {
+        SDL_UnlockSurface(surface);
+    }
+
+    return error;
+}
+
+// blends the subtitle surface (if not nullptr) over the video in the window surface, then shows the window surface
+int present_surface(SDL::Window &window, SDL_Surface *subtitle, const SDL_Rect *subtitle_rect)
+{
+    int error{0};
+
+    SDL_Surface *surface{SDL_GetWindowSurface(window)};
+    if(!surface)
+    {
+        return -1;
+    }
+
+    if(subtitle && subtitle_rect->w > 0 && subtitle_rect->h > 0)
+    {
+        SDL_Rect destination{*subtitle_rect};
+
+        error = SDL_BlitScaled(subtitle, nullptr, surface, &destination);
+        if(error < 0)
+        {
+            return error;
+        }
+    }
+
+    return SDL_UpdateWindowSurface(window);
+}
+
+/* update_surface_subtitle function
+ * Description: wraps the pixels of a newly shown subtitle in the surface present_surface blends, nothing is copied
+ * The subtitle overlay keeps the pixels until the next subtitle is shown, which is when this has to be called again
+ * Parameter: output - the window surface state, holding the subtitle surface
+ * Parameter: image - the subtitle that is shown from now on
+ * Return: negative value on failure, a value >= 0 on success
+ */
+int update_surface_subtitle(Surface_Output &output, const Video::Subtitle_Image &image)
+{
+    if(output.subtitle_surface.surface())
+    {
+        SDL_FreeSurface(output.subtitle_surface);
+        output.subtitle_surface = nullptr;
+    }
+
+    // a subtitle that clears the screen has no pixels
+    if(image.pixels.empty())
+    {
+        return 0;
+    }
+
+    output.subtitle_surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint32_t*>(image.pixels.data()),   // pixels
+                                                                 image.width,                                  // width
+                                                                 image.height,                                 // height
+                                                                 32,                                           // depth
+                                                                 image.width * static_cast<int>(sizeof(uint32_t)), // pitch
+                                                                 SDL_PIXELFORMAT_ARGB8888);                    // pixel format
+    if(!output.subtitle_surface.surface())
+    {
+        return -1;
+    }
+
+    return SDL_SetSurfaceBlendMode(output.subtitle_surface, SDL_BLENDMODE_BLEND);
+}
+
+// gets the FFmpeg pixel format with the same memory layout as a window surface format, AV_PIX_FMT_NONE if there is none
+enum AVPixelFormat surface_pixel_format(uint32_t sdl_format)
+{
+    // SDL's packed 32 bit formats are in native byte order, FFmpeg's named by the byte order in memory
+    bool little_endian{SDL_BYTEORDER == SDL_LIL_ENDIAN};
+
+    if(sdl_format == SDL_PIXELFORMAT_RGB888)
+    {
+        return little_endian ? AV_PIX_FMT_BGR0 : AV_PIX_FMT_0RGB;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_ARGB8888)
+    {
+        return little_endian ? AV_PIX_FMT_BGRA : AV_PIX_FMT_ARGB;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_BGR888)
+    {
+        return little_endian ? AV_PIX_FMT_RGB0 : AV_PIX_FMT_0BGR;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_ABGR8888)
+    {
+        return little_endian ? AV_PIX_FMT_RGBA : AV_PIX_FMT_ABGR;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_RGB565)
+    {
+        return AV_PIX_FMT_RGB565;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_RGB24)
+    {
+        return AV_PIX_FMT_RGB24;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_BGR24)
+    {
+        return AV_PIX_FMT_BGR24;
+    }
+
+    return AV_PIX_FMT_NONE;
+}
+
+/* texture_planes function
+ * Description: points data and linesize at the planes of locked texture memory, in the plane order FFmpeg uses for the matching pixel format
+ * SDL keeps the planes right after each other, the chroma planes of YV12 / IYUV have half the pitch, and YV12 stores V first
+ * Parameter: sdl_format - the texture's pixel format
+ * Parameter: pixels, pitch - the locked memory, as returned by SDL_LockTexture
+ * Parameter: height - the texture height
+ */
+void texture_planes(uint32_t sdl_format, void *pixels, int pitch, int height, uint8_t **data, int *linesize)
+{
+    uint8_t *plane{static_cast<uint8_t*>(pixels)};
+    int chroma_height{(height + 1) / 2};
+
+    data[0] = plane;
+    linesize[0] = pitch;
+
+    if(sdl_format == SDL_PIXELFORMAT_YV12)
+    {
+        int chroma_pitch{(pitch + 1) / 2};
+
+        data[2] = plane + pitch * height;
+        data[1] = data[2] + chroma_pitch * chroma_height;
+        linesize[1] = chroma_pitch;
+        linesize[2] = chroma_pitch;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_IYUV)
+    {
+        int chroma_pitch{(pitch + 1) / 2};
+
+        data[1] = plane + pitch * height;
+        data[2] = data[1] + chroma_pitch * chroma_height;
+        linesize[1] = chroma_pitch;
+        linesize[2] = chroma_pitch;
+    }
+
+    else if(sdl_format == SDL_PIXELFORMAT_NV12 || sdl_format == SDL_PIXELFORMAT_NV21)
+    {
+        data[1] = plane + pitch * height;
+        linesize[1] = 2 * ((pitch + 1) / 2);
+    }
+}
+
+/* prepare_texture function
+ * Description: makes sure the texture matches the output pixel format and size of the conversion, if it doesn't the texture is recreated.
+ * The display rectangle is recalculated either way. Only the texture is recreated, the renderer and window stay the same
+ * Parameter: texture - the texture to check / recreate
+ * Parameter: renderer - the renderer the texture belongs to
+ * Parameter: conversion - the conversion whose output is going to be rendered
+ * Parameter: screen_resolution - the screen resolution, used for the display rectangle
+ * Parameter: display_rect - set to the display rectangle for the texture
+ * Parameter: streaming - if true a streaming texture is created, set to false if a streaming texture can't be created or locked
+ * Return: negative value on failure, a value >= 0 on success
+ */
+int prepare_texture(SDL::Texture &texture, SDL::Renderer &renderer, const Video_Conversion &conversion, SDL_Rect &screen_resolution, SDL_Rect &display_rect, bool &streaming)
+{
+    uint32_t sdl_format{conversion.sdl_format};
+    int width{conversion.output_resolution.w};
+    int height{conversion.output_resolution.h};
+    int access{streaming ? SDL_TEXTUREACCESS_STREAMING : SDL_TEXTUREACCESS_STATIC};
+
+    // calculate the display rectangle, the screen resolution may have changed even if the texture didn't
+    SDL_Rect image_resolution;
+    image_resolution.w = width;
+    image_resolution.h = height;
+
+    display_rect = Utility::calculate_display_rectangle(image_resolution, screen_resolution);
+
+    if(texture.texture())
+    {
+        uint32_t texture_format{0};
+        int texture_access{0};
+        int texture_width{0};
+        int texture_height{0};
+
+        int error{SDL_QueryTexture(texture, &texture_format, &texture_access, &texture_width, &texture_height)};
+        if(error < 0)
+        {
+            return error;
+        }
+
+        // nothing changed
+        if(texture_format == sdl_format && texture_access == access && texture_width == width && texture_height == height)
+        {
+            return 0;
+        }
+
+        SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+
+    if(streaming)
+    {
+        texture = SDL_CreateTexture(renderer,                    // Renderer to use
+                                    sdl_format,                  // Pixel format
+                                    SDL_TEXTUREACCESS_STREAMING, // Texture access
+                                    width,                       // Texture width
+                                    height);                     // Texture height
+
+        // make sure the texture can actually be locked
+        void *pixels{nullptr};
+        int pitch{0};
+
+        if(texture && SDL_LockTexture(texture, nullptr, &pixels, &pitch) >= 0)
+        {
+            SDL_UnlockTexture(texture);
+        }
+
+        else
+        {
+            Utility::print_error("Streaming textures not supported, falling back to static textures");
+
+            if(texture)
+            {
+                SDL_DestroyTexture(texture);
+                texture = nullptr;
+            }
+
+            streaming = false;
+        }
+    }
+
+    if(!streaming)
+    {
+        texture = SDL_CreateTexture(renderer,                 // Renderer to use
+                                    sdl_format,               // Pixel format
+                                    SDL_TEXTUREACCESS_STATIC, // Texture access
+                                    width,                    // Texture width
+                                    height);                  // Texture height
+    }
+
+    if(!texture)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+// checks if a frame has to be tone mapped with the given conversion settings
+bool tone_mapping_needed(const Video_Conversion &conversion, const AVFrame *frame)
+{
+    return conversion.tone_map_curve != Video::TONE_MAP_OFF &&
+           Video::hdr_frame(frame) &&
+           Video::Tone_Mapper::supported(static_cast<enum AVPixelFormat>(frame->format));
+}
+
+// checks if a decoded frame has a different size, pixel format or dynamic range than the one the conversion was set up for
+bool conversion_changed(const Video_Conversion &conversion, const AVFrame *frame)
+{
+    return frame->format != static_cast<int>(conversion.input_format) ||
+           frame->width != conversion.input_width ||
+           frame->height != conversion.input_height ||
+           tone_mapping_needed(conversion, frame) != conversion.tone_mapping;
+}
+
+// describes how decoded frames get into the texture, like "yuv422p10le -> swscale -> yuv420p -> SDL_PIXELFORMAT_IYUV texture"
+std::string texture_path_description(const Video_Conversion &conversion)
+{
+    std::string description{av_get_pix_fmt_name(conversion.input_format)};
+
+    if(conversion.tone_mapping)
+    {
+        description += " -> tone mapping -> yuv420p";
+    }
+
+    if(conversion.rescaling_needed)
+    {
+        description += " -> swscale -> ";
+        description += av_get_pix_fmt_name(conversion.output_format);
+    }
+
+    description += " -> ";
+    description += SDL_GetPixelFormatName(conversion.sdl_format);
+    description += " texture";
+
+    if(!conversion.texture_formats.empty())
+    {
+        bool native{std::find(conversion.texture_formats.begin(), conversion.texture_formats.end(), conversion.sdl_format) != conversion.texture_formats.end()};
+        description += native ? ", native to the renderer" : ", converted by the renderer";
+    }
+
+    return description;
+}
+
+/* setup_video_conversion function
+ * Description: figures out the output pixel format, SDL format and output resolution for the frame, and sets up the rescaler if rescaling is needed
+ * The rescaler is only rebuilt if its parameters actually changed
+ * Parameter: frame - a decoded frame
+ * Parameter: screen_resolution - the screen resolution, frames bigger than it are downsized
+ * Parameter: conversion - the Video_Conversion to set up
+ * Parameter: rescaler - the image rescaler to set up
+ * Return: false if the frame cannot be converted, true on success
+ */
+bool setup_video_conversion(const AVFrame *frame, SDL_Rect &screen_resolution, Video_Conversion &conversion, FFmpeg::Scale &rescaler)
+{
+    conversion.input_format = static_cast<enum AVPixelFormat>(frame->format);
+    conversion.input_width = frame->width;
+    conversion.input_height = frame->height;
+
+    // HDR frames are tone mapped to YUV420P first, so that is what the rescaler gets
+    conversion.tone_mapping = tone_mapping_needed(conversion, frame);
+    enum AVPixelFormat rescaler_input_format{conversion.tone_mapping ? AV_PIX_FMT_YUV420P : conversion.input_format};
+
+    // check if rescaling is needed for pixel formats, and get SDL output format
+    conversion.rescaling_needed = Utility::rescaling_needed(rescaler_input_format, conversion.output_format, conversion.sdl_format, conversion.texture_formats);
+
+    // if rescaling is needed, but the input format is not supported then the video cannot be played
+    if(conversion.rescaling_needed && !Utility::valid_rescaling_input(rescaler_input_format))
+    {
+        return false;
+    }
+
+    // image resolution
+    conversion.output_resolution.x = 0;
+    conversion.output_resolution.y = 0;
+    conversion.output_resolution.w = frame->width;
+    conversion.output_resolution.h = frame->height;
+
+    // if the image is too big for the screen, downsize it
+    if(conversion.output_resolution.w > screen_resolution.w || conversion.output_resolution.h > screen_resolution.h)
+    {
+        Utility::downsize_resolution(conversion.output_resolution, screen_resolution);
+        conversion.rescaling_needed = true;
+    }
+
+    // Setup image rescaler if needed, sws_getCachedContext reuses the old context if nothing changed
+    if(conversion.rescaling_needed)
+    {
+        rescaler = sws_getCachedContext(rescaler,                         // old context
+                                        frame->width,                     // source width
+                                        frame->height,                    // source height
+                                        rescaler_input_format,            // source pixel format
+                                        conversion.output_resolution.w,   // destination width
+                                        conversion.output_resolution.h,   // destination height
+                                        conversion.output_format,         // destination pixel format
+                                        conversion.scaler_flags,          // flags, the scaler preset
+                                        nullptr,                          // src filter
+                                        nullptr,                          // dst filter
+                                        nullptr);
+
+        if(!rescaler.swscontext())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// rescales a frame into output_frame, both frames must already be allocated
+int rescale_frame(FFmpeg::Scale &rescaler, const AVFrame *frame, AVFrame *output_frame)
+{
+    int error{0};
+
+    error = sws_scale(rescaler,                   // Rescaling context to use
+                      frame->data,                // Source data
+                      frame->linesize,            // Source linesize
+                      0,                          // Y position in source image
+                      frame->height,              // height of the source image
+                      output_frame->data,         // destination data
+                      output_frame->linesize);    // destination linesize
+
+    output_frame->pts = frame->pts;
+
+    return error;
+}
+
+// allocates frame if it doesn't hold an image with the given parameters
+int prepare_frame(FFmpeg::Frame &frame, enum AVPixelFormat pixel_format, int width, int height)
+{
+    if(frame.matches(pixel_format, width, height))
+    {
+        return 0;
+    }
+
+    return frame.allocate(pixel_format, width, height);
+}
+
+/* deinterlace_frame function
+ * Description: deinterlaces and, if needed, rescales a decoded frame into output_frame
+ * Deinterlacing is always done before rescaling, so the fields aren't mixed by the rescaler. Pixel formats the deinterlacer
+ * doesn't take are converted to an 8 bit one at the decoded size first
+ * Return: negative value on failure, value >= 0 on success
+ */
+int deinterlace_frame(const Video_Conversion &conversion, FFmpeg::Scale &rescaler, Video_Filters &filters, const AVFrame *frame, FFmpeg::Frame &output_frame)
+{
+    int error{0};
+
+    // the deinterlacer is only created once there is an interlaced frame
+    if(!filters.deinterlacer)
+    {
+        filters.deinterlacer.reset(new Video::Deinterlacer{filters.deinterlace_mode, filter_thread_pool(filters)});
+
+        if(filters.verbose)
+        {
+            std::cout << "Interlaced video, deinterlacing with " << Video::deinterlace_mode_name(filters.deinterlace_mode)
+                      << " mode on " << filters.thread_pool->thread_count() << " threads" << std::endl;
+        }
+    }
+
+    bool top_field_first{Video::top_field_first(frame, filters.field_order)};
+
+    enum AVPixelFormat input_format{static_cast<enum AVPixelFormat>(frame->format)};
+
+    // the decoded frame is displayed as is, so deinterlace straight into the output
+    if(!conversion.rescaling_needed && Video::Deinterlacer::supported(input_format))
+    {
+        return filters.deinterlacer->process(frame, output_frame, top_field_first);
+    }
+
+    // deinterlace, then rescale
+    if(Video::Deinterlacer::supported(input_format))
+    {
+        FFmpeg::Frame &scratch_frame{filters.scratch_frames[0]};
+
+        error = prepare_frame(scratch_frame, input_format, frame->width, frame->height);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        error = filters.deinterlacer->process(frame, scratch_frame, top_field_first);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        return rescale_frame(rescaler, scratch_frame, output_frame);
+    }
+
+    // the decoded pixel format isn't supported, e.g. 10 bit video. It's converted to 8 bits at the decoded size first,
+    // keeping the chroma subsampling, so no lines of the two fields are mixed, then deinterlaced, then rescaled to the output
+    enum AVPixelFormat deinterlace_format{deinterlacer_pixel_format(input_format)};
+    if(deinterlace_format == AV_PIX_FMT_NONE)
+    {
+        return -1;
+    }
+
+    filters.deinterlace_input_converter = sws_getCachedContext(filters.deinterlace_input_converter, // old context
+                                                               frame->width,                       // source width
+                                                               frame->height,                      // source height
+                                                               input_format,                       // source pixel format
+                                                               frame->width,                       // destination width
+                                                               frame->height,                      // destination height
+                                                               deinterlace_format,                 // destination pixel format
+                                                               conversion.scaler_flags,            // flags, the scaler preset
+                                                               nullptr,                            // src filter
+                                                               nullptr,                            // dst filter
+                                                               nullptr);
+
+    filters.deinterlace_output_rescaler = sws_getCachedContext(filters.deinterlace_output_rescaler, // old context
+                                                               frame->width,                        // source width
+                                                               frame->height,                       // source height
+                                                               deinterlace_format,                  // source pixel format
+                                                               conversion.output_resolution.w,      // destination width
+                                                               conversion.output_resolution.h,      // destination height
+                                                               conversion.output_format,            // destination pixel format
+                                                               conversion.scaler_flags,             // flags, the scaler preset
+                                                               nullptr,                             // src filter
+                                                               nullptr,                             // dst filter
+                                                               nullptr);
+
+    if(!filters.deinterlace_input_converter.swscontext() || !filters.deinterlace_output_rescaler.swscontext())
+    {
+        return -1;
+    }
+
+    // the scratch frames are alternated because the deinterlacer keeps a reference to the previous one
+    filters.scratch_index ^= 1;
+    FFmpeg::Frame &scratch_frame{filters.scratch_frames[filters.scratch_index]};
+
+    error = prepare_frame(scratch_frame, deinterlace_format, frame->width, frame->height);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    error = rescale_frame(filters.deinterlace_input_converter, frame, scratch_frame);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    error = prepare_frame(filters.deinterlaced_frame, deinterlace_format, frame->width, frame->height);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    error = filters.deinterlacer->process(scratch_frame, filters.deinterlaced_frame, top_field_first);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    return rescale_frame(filters.deinterlace_output_rescaler, filters.deinterlaced_frame, output_frame);
+}
+
+/* deinterlacer_pixel_format function
+ * Description: picks the 8 bit planar format with the same chroma subsampling as a pixel format the deinterlacer doesn't take,
+ * converting to it doesn't resample vertically, so the fields stay apart
+ * Parameter: pixel_format - the decoded pixel format
+ * Return: the format, AV_PIX_FMT_NONE if there is none
+ */
+enum AVPixelFormat deinterlacer_pixel_format(enum AVPixelFormat pixel_format)
+{
+    const AVPixFmtDescriptor *descriptor{av_pix_fmt_desc_get(pixel_format)};
+
+    if(!descriptor || (descriptor->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL)))
+    {
+        return AV_PIX_FMT_NONE;
+    }
+
+    if(descriptor->flags & AV_PIX_FMT_FLAG_RGB)
+    {
+        return AV_PIX_FMT_GBRP;
+    }
+
+    if(descriptor->nb_components < 3)
+    {
+        return AV_PIX_FMT_GRAY8;
+    }
+
+    switch((descriptor->log2_chroma_w << 4) | descriptor->log2_chroma_h)
+    {
+        case 0x00: return AV_PIX_FMT_YUV444P;
+        case 0x01: return AV_PIX_FMT_YUV440P;
+        case 0x10: return AV_PIX_FMT_YUV422P;
+        case 0x11: return AV_PIX_FMT_YUV420P;
+        case 0x20: return AV_PIX_FMT_YUV411P;
+        case 0x22: return AV_PIX_FMT_YUV410P;
+        default:   return AV_PIX_FMT_NONE;
+    }
+}
+
+// checks if a decoded frame has to go through a filter, tone mapping or deinterlacing, before it can be displayed
+bool filters_needed(const Video_Conversion &conversion, const Video_Filters &filters, const AVFrame *frame)
+{
+    return conversion.tone_mapping ||
+           (filters.deinterlace_mode != Video::DEINTERLACE_OFF && Video::frame_interlaced(frame, filters.field_order));
+}
+
+/* queue_frame function
+ * Description: puts a decoded frame into a ring slot. When streaming, frames that don't need a filter are only referenced,
+ * and get rescaled / copied straight into the texture by the presenting thread. Everything else is converted here
+ * Return: FFmpeg error code on failure, value >= 0 on success
+ */
+int queue_frame(const Video_Conversion &conversion, FFmpeg::Scale &rescaler, Video_Filters &filters, AVFrame *frame, FFmpeg::Frame &slot)
+{
+    if(conversion.streaming && !filters_needed(conversion, filters, frame))
+    {
+        return slot.reference(frame);
+    }
+
+    return convert_frame(conversion, rescaler, filters, frame, slot);
+}
+
+// gets the threads the filters split their work across, they are started the first time a filter needs them
+Utility::Thread_Pool &filter_thread_pool(Video_Filters &filters)
+{
+    if(!filters.thread_pool)
+    {
+        filters.thread_pool.reset(new Utility::Thread_Pool{0});
+    }
+
+    return *filters.thread_pool;
+}
+
+/* convert_frame function
+ * Description: rescales or copies a decoded frame into output_frame, output_frame is reallocated if it doesn't
+ * match the conversion's output format or resolution. HDR frames are tone mapped, and interlaced frames are deinterlaced on the way
+ * Return: FFmpeg error code on failure, value >= 0 on success
+ */
+int convert_frame(const Video_Conversion &conversion, FFmpeg::Scale &rescaler, Video_Filters &filters, AVFrame *frame, FFmpeg::Frame &output_frame)
+{
+    int error{0};
+
+    error = prepare_frame(output_frame, conversion.output_format, conversion.output_resolution.w, conversion.output_resolution.h);
+    if(error < 0)
+    {
+        return error;
+    }
+
+    bool deinterlace{filters.deinterlace_mode != Video::DEINTERLACE_OFF && Video::frame_interlaced(frame, filters.field_order)};
+
+    // the frame going into the next step
+    const AVFrame *source{frame};
+
+    if(conversion.tone_mapping)
+    {
+        // the tone mapper is only created once there is an HDR frame
+        if(!filters.tone_mapper)
+        {
+            filters.tone_mapper.reset(new Video::Tone_Mapper{conversion.tone_map_curve, filter_thread_pool(filters)});
+
+            if(filters.verbose)
+            {
+                std::cout << "HDR video, tone mapping with the " << Video::tone_map_curve_name(conversion.tone_map_curve)
+                          << " curve on " << filters.thread_pool->thread_count() << " threads" << std::endl;
+            }
+        }
+
+        // tone map straight into the output if nothing else has to be done
+        if(!deinterlace && !conversion.rescaling_needed)
+        {
+            return filters.tone_mapper->process(frame, output_frame);
+        }
+
+        // alternated because the deinterlacer keeps a reference to the previous one
+        filters.tone_mapped_index ^= 1;
+        FFmpeg::Frame &tone_mapped_frame{filters.tone_mapped_frames[filters.tone_mapped_index]};
+
+        error = prepare_frame(tone_mapped_frame, AV_PIX_FMT_YUV420P, frame->width, frame->height);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        error = filters.tone_mapper->process(frame, tone_mapped_frame);
+        if(error < 0)
+        {
+            return error;
+        }
+
+        source = tone_mapped_frame;
+    }
+
+    if(deinterlace)
+    {
+        error = deinterlace_frame(conversion, rescaler, filters, source, output_frame);
+    }
+
+    else if(conversion.rescaling_needed)
+    {
+        error = rescale_frame(rescaler, source, output_frame);
+    }
+
+    else
+    {
+        error = output_frame.copy(source);
+    }
+
+    return error;
+}
+
+void decoder_thread_function(FFmpeg::Decoder &decoder,
+                             FFmpeg::Scale &rescaler,
+                             Utility::Scaler_Governor &scaler_governor,
+                             Video_Filters &filters,
+                             Video_Conversion conversion,
+                             const Utility::Display_Info &display_info,
+                             Video::Frame_Timing &timing,
+                             FFmpeg::Frame_Array &decoded_frames,
+                             Utility::Semaphore &spots_filled,
+                             Utility::Semaphore &spots_empty,
+                             Shared_Variables &shared_vars,
+                             Decoder_Statistics &statistics)
+{
+    bool end_of_file_reached{false};
+    bool conversion_valid{true};
+    int current_index{0};
+    int error{0};
+
+    SDL_Rect screen_resolution{display_info.resolution()};
+    int display_changes{display_info.changes()};
+
+    AVFrame *frame{nullptr};
+
+    while(1)
+    {
+        auto decode_start{std::chrono::steady_clock::now()};
+
+        error = decoder.send_packet();
+        if(error == AVERROR_EOF)
+        {
+            end_of_file_reached = true;
+        }
+
+        Utility::error_assert((error == AVERROR(EAGAIN) || error == AVERROR_EOF || error >= 0), "Failed to send packet to decoder", error);
+
+        error = decoder.receive_frame(&frame);
+
+        std::chrono::duration<double> decode_time{std::chrono::steady_clock::now() - decode_start};
+        statistics.decode_seconds += decode_time.count();
+
+        if(error == AVERROR(EAGAIN) && end_of_file_reached)
+        {
+            decoded_frames[current_index]->pts = AVERROR_EOF;
+            spots_filled.post();
+            break;
+        }
+
+        else if(error == AVERROR(EAGAIN))
+        {
+            continue;
+        }
+
+        Utility::error_assert((error >= 0), "Failed to receive frame from decoder", error);
+
+        // every frame goes through here, even skipped ones, so estimates stay in step
+        frame->pts = timing.timestamp(frame);
+
+        // the video changed size or pixel format midstream, or the window moved to a display with other bounds,
+        // only the rescaler is rebuilt here, ring slots are reallocated as they get reused, and the texture is recreated by the presenting thread
+        if(display_info.changes() != display_changes)
+        {
+            display_changes = display_info.changes();
+            screen_resolution = display_info.resolution();
+            conversion.input_format = AV_PIX_FMT_NONE;
+        }
+
+        if(conversion_changed(conversion, frame))
+        {
+            conversion_valid = setup_video_conversion(frame, screen_resolution, conversion, rescaler);
+            if(!conversion_valid)
+            {
+                std::cerr << "Unsupported pixel format midstream, skipping frames" << std::endl;
+            }
+        }
+
+        // in automatic mode the scaler preset depends on how long conversion takes
+        // if the rescaler can't be set up with the new preset, the previous one is kept
+        if(conversion_valid && conversion.scaler_flags != scaler_governor.flags())
+        {
+            int previous_flags{conversion.scaler_flags};
+
+            conversion.scaler_flags = scaler_governor.flags();
+            conversion_valid = setup_video_conversion(frame, screen_resolution, conversion, rescaler);
+
+            if(!conversion_valid)
+            {
+                conversion.scaler_flags = previous_flags;
+                conversion_valid = setup_video_conversion(frame, screen_resolution, conversion, rescaler);
+            }
+        }
+
+        if(!conversion_valid)
+        {
+            statistics.skipped_frames++;
+            continue;
+        }
+
+        spots_empty.wait();
+
+        if(std::atomic_load<bool>(&shared_vars.skipping))
+        {
+            break;
+        }
+
+        auto conversion_start{std::chrono::steady_clock::now()};
+
+        error = queue_frame(conversion, rescaler, filters, frame, decoded_frames[current_index]);
+        Utility::error_assert((error >= 0), "Failed to convert frame", error);
+
+        std::chrono::duration<double> conversion_time{std::chrono::steady_clock::now() - conversion_start};
+        statistics.convert_seconds += conversion_time.count();
+
+        // when streaming most rescaling happens on the presenting thread, which feeds the governor instead
+        if(conversion.rescaling_needed && !conversion.streaming)
         {
-            error = render_yuv_frame(texture, &display_rect, renderer, decoded_frames[current_index]);
-            Utility::error_assert((error >= 0), "Failed to render YUV frame");
-        }
-        else 
-        {
-            error = render_frame(texture, &display_rect, renderer, decoded_frames[current_index]);
-            Utility::error_assert((error >= 0), "Failed to render frame");
+            scaler_governor.record(conversion_time.count());
         }
 
-        spots_empty.post();
+        spots_filled.post();
 
         current_index++;
+        if(current_index == decoded_frames.size())
+        {
+            current_index = 0;
+        }
+
     }
 
-    decoder_thread.join();
+    // the video may have ended before the prefill threshold was reached
+    spots_filled.interrupt();
 }
 
 
-int render_yuv_frame(SDL::Texture &texture, SDL_Rect *dst_rect, SDL::Renderer &renderer, AVFrame *frame)
+// the benchmark converts like it would for a display of this size
+static const int BENCHMARK_SCREEN_WIDTH{1920};
+static const int BENCHMARK_SCREEN_HEIGHT{1080};
+
+/* benchmark_file function
+ * Description: runs the video of a file through demuxing, decoding and conversion as fast as possible, and throws the converted frames away
+ * The frames go through the same decoder thread and frame ring as during playback, this thread takes them out of the ring without waiting
+ * Prints one JSON object on a single line with the frame rate, the time spent in each stage and the peak memory use
+ * Demuxing happens inside Decoder::send_packet, so it is counted as part of decoding
+ * Parameter: filename - the file to benchmark
+ * Parameter: options - the scaler, deinterlacing and tone mapping options are used like during playback
+ * Parameter: output - if not nullptr, every frame taken out of the ring is also presented through it, sized for its display.
+ * Like during playback frames are then queued as decoded if they need no filter, and their rescaling counts as presenting
+ */
+void benchmark_file(const std::string &filename, const Player_Options &options, Video_Output *output)
 {
     int error{0};
 
-    // update the texture with the provided frame
-    error = SDL_UpdateYUVTexture(texture,
-                                 nullptr,
-                                 frame->data[0],
-                                 frame->linesize[0],
-                                 frame->data[1],
-                                 frame->linesize[1],
-                                 frame->data[2],
-                                 frame->linesize[2]);
+    Utility::reset_peak_memory_usage();
 
-    if(error < 0)
+    FFmpeg::Decoder decoder{};
+
+    error = decoder.init_format_context(filename, nullptr);
+    if(error >= 0)
     {
-        return error;
+        error = decoder.find_stream(AVMEDIA_TYPE_VIDEO);
     }
 
-    // clear the screen
-    error = SDL_RenderClear(renderer);
-    if(error < 0)
+    if(error >= 0)
     {
-        return error;
+        error = decoder.init_codec_context(nullptr, 4);
     }
 
-    // copy the data into the renderer
-    error = SDL_RenderCopy(renderer, texture, nullptr, dst_rect);
+    // the first frame, like playback decodes it before starting the decoder thread
+    AVFrame *decoded_frame{nullptr};
+    Decoder_Statistics decoder_statistics{};
+
+    auto benchmark_start{std::chrono::steady_clock::now()};
+
+    while(error >= 0)
+    {
+        error = decoder.send_packet();
+        if(error < 0 && error != AVERROR(EAGAIN))
+        {
+            break;
+        }
+
+        error = decoder.receive_frame(&decoded_frame);
+        if(error != AVERROR(EAGAIN))
+        {
+            break;
+        }
+
+        error = 0;
+    }
+
+    std::chrono::duration<double> first_decode_time{std::chrono::steady_clock::now() - benchmark_start};
+    decoder_statistics.decode_seconds += first_decode_time.count();
+
     if(error < 0)
     {
-        return error;
+        Utility::print_error("Failed to open video for benchmarking", error);
+        std::cout << "{\"file\":" << json_string(filename) << ",\"error\":" << error << "}" << std::endl;
+        return;
     }
 
-    // present the image
-    SDL_RenderPresent(renderer);
-    return error;
-}
+    // the display the conversion is done for, the one the window is on if frames are presented
+    SDL_Rect benchmark_resolution;
+    benchmark_resolution.x = 0;
+    benchmark_resolution.y = 0;
+    benchmark_resolution.w = BENCHMARK_SCREEN_WIDTH;
+    benchmark_resolution.h = BENCHMARK_SCREEN_HEIGHT;
 
-int render_frame(SDL::Texture &texture, SDL_Rect *dst_rect, SDL::Renderer &renderer, AVFrame *frame)
-{
-    int error{0};
+    Utility::Display_Info headless_display{};
+    headless_display.set_resolution(benchmark_resolution);
+
+    const Utility::Display_Info &display_info{output ? output->display_info : headless_display};
+    SDL_Rect screen_resolution{display_info.resolution()};
 
-    // update the texture with the provided frame
-    error = SDL_UpdateTexture(texture,
-                              nullptr,
-                              frame->data[0],
-                              frame->linesize[0]);
+    FFmpeg::Scale rescaler{};
+    Utility::Scaler_Governor scaler_governor{options.scaler_preset, options.automatic_scaler};
 
+    Video_Conversion conversion{};
+    conversion.scaler_flags = scaler_governor.flags();
+    conversion.tone_map_curve = options.tone_map_curve;
 
-    if(error < 0)
+    // presenting takes frames as decoded, like playback, without an output conversion has to be done into the ring to be measured
+    conversion.streaming = false;
+
+    if(output)
     {
-        return error;
+        conversion.texture_formats = output->upload.conversion.texture_formats;
+        conversion.streaming = output->upload.streaming;
+        output->upload.conversion.scaler_flags = scaler_governor.flags();
     }
 
-    // clear the screen
-    error = SDL_RenderClear(renderer);
-    if(error < 0)
+    const AVStream *stream{decoder.format_context()->streams[decoder.stream_number()]};
+    Video::Frame_Timing timing{stream};
+    int buffer_size{std::max(static_cast<int>(std::ceil(timing.frame_rate() * 2)), 2)};
+
+    if(conversion.streaming)
     {
-        return error;
+        buffer_size = std::min(buffer_size, std::max(static_cast<int>(std::ceil(timing.frame_rate() * STREAMING_BUFFER_SECONDS)), 2));
     }
 
-    // copy the data into the renderer
-    error = SDL_RenderCopy(renderer, texture, nullptr, dst_rect);
-    if(error < 0)
+    scaler_governor.set_frame_budget(timing.frame_duration());
+
+    Video_Filters filters{};
+    filters.deinterlace_mode = options.deinterlace_mode;
+    filters.field_order = stream->codecpar->field_order;
+    filters.verbose = options.verbose;
+    filters.scratch_index = 0;
+    filters.tone_mapped_index = 0;
+
+    if(!setup_video_conversion(decoded_frame, screen_resolution, conversion, rescaler))
     {
-        return error;
+        std::cout << "{\"file\":" << json_string(filename) << ",\"error\":-1}" << std::endl;
+        return;
     }
 
-    // present the image
-    SDL_RenderPresent(renderer);
-    return error;
-}
+    auto convert_start{std::chrono::steady_clock::now()};
 
-void decoder_thread_function(FFmpeg::Decoder &decoder,
-                             FFmpeg::Scale &rescaler,
-                             bool RESCALING_NEEDED,
-                             FFmpeg::Frame_Array &decoded_frames,
-                             Utility::Semaphore &spots_filled,
-                             Utility::Semaphore &spots_empty,
-                             Shared_Variables &shared_vars)
-{
-    bool end_of_file_reached{false};
-    int current_index{0};
-    int error{0};
+    decoded_frame->pts = timing.timestamp(decoded_frame);
 
-    AVFrame *frame{nullptr};
+    FFmpeg::Frame initial_frame{};
+    error = queue_frame(conversion, rescaler, filters, decoded_frame, initial_frame);
+    Utility::error_assert((error >= 0), "Failed to convert initial image", error);
+
+    std::chrono::duration<double> first_convert_time{std::chrono::steady_clock::now() - convert_start};
+    decoder_statistics.convert_seconds += first_convert_time.count();
+
+    FFmpeg::Frame_Array decoded_frames{buffer_size};
+
+    for(int i{0}; i != decoded_frames.size(); ++i)
+    {
+        error = decoded_frames[i].allocate(conversion.output_format,
+                                           conversion.output_resolution.w,
+                                           conversion.output_resolution.h);
+        Utility::error_assert((error >= 0), "Failed to allocate an AVFrame", error);
+    }
+
+    Utility::Semaphore spots_filled{0};
+    Utility::Semaphore spots_empty{buffer_size};
+
+    // only the skipping flag is read by the decoder thread, nothing skips here
+    Shared_Variables shared_vars{};
+    shared_vars.skipping = false;
+
+    std::thread decoder_thread{decoder_thread_function,
+                               std::ref(decoder),
+                               std::ref(rescaler),
+                               std::ref(scaler_governor),
+                               std::ref(filters),
+                               conversion,
+                               std::cref(display_info),
+                               std::ref(timing),
+                               std::ref(decoded_frames),
+                               std::ref(spots_filled),
+                               std::ref(spots_empty),
+                               std::ref(shared_vars),
+                               std::ref(decoder_statistics)};
+
+    // the null sink, frames are taken out of the ring as soon as they're in it, and presented right away if there is an output
+    int frame_count{1};
+    int current_index{0};
+    int texture_index{0};
+    double present_seconds{0.0};
 
     while(1)
     {
+        spots_filled.wait();
 
-        error = decoder.send_packet();
-        if(error == AVERROR_EOF)
+        if(decoded_frames[current_index]->pts == AVERROR_EOF)
         {
-            end_of_file_reached = true;
+            break;
         }
 
-        Utility::error_assert((error == AVERROR(EAGAIN) || error == AVERROR_EOF || error >= 0), "Failed to send packet to decoder", error);
-
-        error = decoder.receive_frame(&frame);
-        if(error == AVERROR(EAGAIN) && end_of_file_reached)
+        if(output)
         {
-            decoded_frames[current_index]->pts = AVERROR_EOF;
-            spots_filled.post();
-            break;
+            auto present_start{std::chrono::steady_clock::now()};
+
+            // the window isn't used otherwise, this only keeps it responding
+            SDL_PumpEvents();
+
+            if(output->surface_output)
+            {
+                error = draw_to_surface(output->surface, output->window, scaler_governor, decoded_frames[current_index], options.verbose);
+                if(error >= 0)
+                {
+                    error = present_surface(output->window, nullptr, nullptr);
+                }
+            }
+
+            else
+            {
+                texture_index = (texture_index + 1) % Video_Output::TEXTURE_RING_SIZE;
+
+                error = upload_frame(output->upload, output->textures[texture_index], output->renderer, scaler_governor,
+                                     screen_resolution, output->display_rects[texture_index], decoded_frames[current_index]);
+                if(error >= 0)
+                {
+                    error = render_texture(output->textures[texture_index], &output->display_rects[texture_index], output->renderer, nullptr, nullptr);
+                }
+            }
+
+            Utility::error_assert((error >= 0), "Failed to present frame");
+
+            std::chrono::duration<double> present_time{std::chrono::steady_clock::now() - present_start};
+            present_seconds += present_time.count();
         }
 
-        else if(error == AVERROR(EAGAIN))
+        frame_count++;
+        spots_empty.post();
+
+        current_index++;
+        if(current_index == decoded_frames.size())
         {
-            continue;
+            current_index = 0;
         }
+    }
 
-        Utility::error_assert((error >= 0), "Failed to receive frame from decoder", error);
+    decoder_thread.join();
 
-        spots_empty.wait();
+    std::chrono::duration<double> total_time{std::chrono::steady_clock::now() - benchmark_start};
 
-        if(std::atomic_load<bool>(&shared_vars.skipping))
+    const char *input_format{av_get_pix_fmt_name(conversion.input_format)};
+    const char *output_format{av_get_pix_fmt_name(conversion.output_format)};
+
+    std::cout << "{\"file\":" << json_string(filename)
+              << ",\"frames\":" << frame_count
+              << ",\"skipped_frames\":" << decoder_statistics.skipped_frames
+              << ",\"input\":\"" << conversion.input_width << "x" << conversion.input_height << " " << (input_format ? input_format : "none") << "\""
+              << ",\"output\":\"" << conversion.output_resolution.w << "x" << conversion.output_resolution.h << " " << (output_format ? output_format : "none") << "\""
+              << ",\"time\":" << total_time.count()
+              << ",\"fps\":" << (total_time.count() > 0.0 ? frame_count / total_time.count() : 0.0)
+              << ",\"stages\":{\"decode\":" << decoder_statistics.decode_seconds << ",\"convert\":" << decoder_statistics.convert_seconds;
+
+    // presenting runs alongside decoding, the frame rate is the slower of the two
+    if(output)
+    {
+        std::cout << ",\"present\":" << present_seconds << "}"
+                  << ",\"presentation\":\"" << (output->surface_output ? "window surface" : "renderer") << "\"";
+    }
+
+    else
+    {
+        std::cout << "}";
+    }
+
+    std::cout << ",\"peak_memory_kb\":" << Utility::peak_memory_usage()
+              << ",\"error\":0"
+              << "}" << std::endl;
+}
+
+// quotes and escapes a string for JSON output
+std::string json_string(const std::string &string)
+{
+    std::string quoted{"\""};
+
+    for(char character : string)
+    {
+        if(character == '"' || character == '\\')
         {
-            break;
+            quoted += '\\';
+            quoted += character;
         }
 
-        if(RESCALING_NEEDED)
+        else if(static_cast<unsigned char>(character) < 0x20)
         {
-            error = sws_scale(rescaler,                                 // Rescaling context to use
-                              frame->data,                              // Source data
-                              frame->linesize,                          // Source linesize
-                              0,                                        // Y position in source image
-                              frame->height,                            // height of the source image
-                              decoded_frames[current_index]->data,      // destination data
-                              decoded_frames[current_index]->linesize); // destination linesize
-
-            decoded_frames[current_index]->pts = frame->pts;
-
-            Utility::error_assert((error >= 0), "Failed to rescale image", error);
+            static const char hex_digits[]{"0123456789abcdef"};
 
+            quoted += "\\u00";
+            quoted += hex_digits[(character >> 4) & 0xf];
+            quoted += hex_digits[character & 0xf];
         }
 
         else
         {
-            error = decoded_frames[current_index].copy(frame);
-            Utility::error_assert((error >= 0), "Failed to copy frame", error);
+            quoted += character;
         }
+    }
 
-        spots_filled.post();
+    return quoted + "\"";
+}
 
-        current_index++;
-        if(current_index == decoded_frames.size())
+// keeps a CPU core busy until running is false
+void cpu_load_thread_func(std::atomic<bool> &running)
+{
+    volatile double sink{0.0};
+
+    while(std::atomic_load<bool>(&running))
+    {
+        for(int i{0}; i != 100000; ++i)
         {
-            current_index = 0;
+            sink = sink + std::sqrt(static_cast<double>(i));
         }
-
     }
 }
 
-
-void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, int &current_file_index, std::condition_variable &start_cv, std::condition_variable &paused_cv, std::mutex &mutex)
+void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars, const Player_Options &options, int &current_file_index, std::condition_variable &start_cv, std::condition_variable &paused_cv, std::mutex &mutex)
 {
     // check if audio is being played back
     if(!shared_vars.audio_playback)
@@ -767,13 +3072,15 @@ void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars,
         return;
     }
 
-    // set audio latency
-    shared_vars.audio_latency = 0.05;
+    // this file's own output, it initializes portaudio, unless one is kept open from file to file, its crossfade stays off
+    Audio_Output file_output{};
 
-    // initialize portaudio
-    PortAudio::Initializer portadio_init{};
+    Audio_Output *audio_output{shared_vars.audio_output};
+    Audio_Output &audio{audio_output ? *audio_output : file_output};
 
-    FFmpeg::Resample resampler{};
+    Audio::Output &output{audio.output};
+    PortAudio::Stream_Playback &playback{output.playback()};
+    FFmpeg::Audio_Converter &converter{audio.converter}; // converts to the format the stream runs in
 
     int error{0};
 
@@ -785,7 +3092,6 @@ void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars,
 
     // fill the decoder
     AVFrame *decoded_frame{nullptr};
-    FFmpeg::Frame resampled_frame{};
     while(error != AVERROR(EAGAIN))
     {
         error = decoder.send_packet();
@@ -802,66 +3108,75 @@ void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars,
 
     error = 0;
 
-    PortAudio::Stream_Playback playback{};
+    // the time of the first audio frame, the master clock counts the audio played from it
+    const AVStream *stream{decoder.format_context()->streams[decoder.stream_number()]};
+    double audio_start_time{0.0};
 
-    // use default host api
-    error = playback.set_host_api_index(-1);
-    Utility::portaudio_error_assert((error >= 0), "Failed to set audio host api", error);
+    if(decoded_frame->best_effort_timestamp != AV_NOPTS_VALUE)
+    {
+        audio_start_time = decoded_frame->best_effort_timestamp * av_q2d(stream->time_base);
+    }
 
-    // set device index
-    error = playback.set_device_index(-1);
-    Utility::portaudio_error_assert((error >= 0), "Failed to set audio device", error);
+    // a kept output is only opened by the first file
+    if(!playback.stream())
+    {
+        // use default host api
+        error = playback.set_host_api_index(-1);
+        Utility::portaudio_error_assert((error >= 0), "Failed to set audio host api", error);
 
-    enum AVSampleFormat FFMPEG_INPUT_FORMAT{static_cast<enum AVSampleFormat>(decoded_frame->format)};
-    enum AVSampleFormat FFMPEG_OUTPUT_FORMAT;
-    PaSampleFormat PORTAUDIO_OUTPUT_FORMAT;
-    bool SAMPLES_INTERLEAVED{false};
+        // set device index
+        error = playback.set_device_index(-1);
+        Utility::portaudio_error_assert((error >= 0), "Failed to set audio device", error);
 
-    // determine if resampling is needed, and get the PORTAUDIO_OUTPUT_FORMAT
-    bool RESAMPLING_NEEDED{ Utility::resampling_needed(FFMPEG_INPUT_FORMAT, FFMPEG_OUTPUT_FORMAT, PORTAUDIO_OUTPUT_FORMAT, SAMPLES_INTERLEAVED) };
+        // a callback stream playing from a ring buffer, decoding hiccups shorter than the buffer aren't heard
+        playback.set_buffer_duration(options.audio_buffer_ms / 1000.0);
 
-    // open a playback stream
-    error = playback.open_stream(decoded_frame->channels,   // number of output channels
-            PORTAUDIO_OUTPUT_FORMAT,   // output format
-            shared_vars.audio_latency, // suggested latency -1.0 for default
-            decoded_frame->sample_rate,// sample rate
-            paNoFlag);                 // flags
-    Utility::portaudio_error_assert((error >= 0), "Failed to open portaudio stream", error);
+        // the stream runs in the device's own format and sample rate, so a file in a format the device doesn't take still plays
+        error = playback.open_native_stream(shared_vars.latency_governor->latency(), // suggested latency -1.0 for default
+                                            paNoFlag);                               // flags
+        Utility::portaudio_error_assert((error >= 0), "Failed to open portaudio stream", error);
 
-    // varialbes to hold channel layout and sample rate, for resampling, involves less overall calculations
-    int64_t CHANNEL_LAYOUT{av_get_default_channel_layout(decoded_frame->channels)};
-    int SAMPLE_RATE{decoded_frame->sample_rate};
+        converter.set_output(playback.channel_count(), playback.sample_rate(), Utility::ffmpeg_sample_format(playback.sample_format()));
 
-    // setup resampler if appropriate
-    if(RESAMPLING_NEEDED)
-    {
-        resampled_frame = av_frame_alloc();
-        if(!resampled_frame)
+        if(options.verbose)
         {
-            std::cerr << "Failed to allocate resampled frame" << std::endl;
+            if(playback.callback_mode())
+            {
+                std::cout << "Audio output: callback stream with a " << options.audio_buffer_ms << " ms ring buffer";
+            }
+
+            else
+            {
+                std::cout << "Audio output: blocking stream";
+            }
+
+            std::cout << ", " << playback.channel_count() << " channels, " << playback.sample_rate() << " Hz, "
+                      << av_get_sample_fmt_name(converter.sample_format()) << std::endl;
         }
 
-        // create the resampler
-        resampler = swr_alloc_set_opts(resampler,                      // resampling context
-                CHANNEL_LAYOUT,                 // out channel layout
-                FFMPEG_OUTPUT_FORMAT,           // out sample format
-                SAMPLE_RATE,                    // out sample rate
-                CHANNEL_LAYOUT,                 // in channel layout
-                FFMPEG_INPUT_FORMAT,            // in sample format
-                SAMPLE_RATE,                    // in sample rate
-                0,                              // log offset
-                nullptr);                       // log context
-        if(!resampler)
+        // the gains and the mixing are done on the converted audio
+        output.set_format();
+        shared_vars.volume->set_available(output.float_output());
+
+        if(audio_output)
         {
-            std::cerr << "Failed to setup resampler" << std::endl;    
-            return;
+            output.set_crossfade(options.crossfade_duration, options.crossfade_curve);
         }
+    }
 
-        // initialize the resampler
-        error = swr_init(resampler);
-        Utility::error_assert((error >= 0), "Failed to initialize resampler", error);
+    if(options.verbose && (decoded_frame->sample_rate != playback.sample_rate() || decoded_frame->channels != playback.channel_count()))
+    {
+        std::cout << "Converting audio from " << decoded_frame->channels << " channels, " << decoded_frame->sample_rate << " Hz" << std::endl;
     }
 
+    // files without ReplayGain tags are played as they are
+    double replay_gain{0.0};
+    double replay_gain_peak{0.0};
+
+    bool has_replay_gain{Audio::read_replay_gain(decoder.format_context(), stream, options.replay_gain_mode, replay_gain, replay_gain_peak)};
+
+    output.set_replay_gain(has_replay_gain, replay_gain, replay_gain_peak);
+
 
     // start a thread to listen for input from terminal, will exit if there is video playback
     std::thread listen_thread{terminal_listen_thread_func,
@@ -895,10 +3210,26 @@ void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars,
         lock.unlock();
     }
 
-    // start the stream
-    error = playback.start_stream();
-    Utility::portaudio_error_assert((error >= 0), "Failed to start playback stream", error);
+    // a kept output is still running when the previous file was crossfaded into this one
+    if(playback.steam_stopped())
+    {
+        error = playback.start_stream();
+        Utility::portaudio_error_assert((error >= 0), "Failed to start playback stream", error);
+    }
+
+    // the statistics of this file, a kept output counts from the first file on
+    unsigned long long start_frames_written{playback.frames_written()};
+    unsigned long start_underruns{playback.underruns()};
+    unsigned long long start_underrun_frames{playback.underrun_frames()};
+    unsigned long start_overruns{playback.overruns()};
+
+    // video follows the audio from here on, a kept output has played earlier files before this one
+    shared_vars.master_clock->set_audio_source(&playback, audio_start_time - static_cast<double>(start_frames_written) / playback.sample_rate());
 
+    if(options.verbose)
+    {
+        std::cout << "Audio output latency: " << playback.output_latency() * 1000.0 << " ms" << std::endl;
+    }
 
     // main loop
     while(error != AVERROR(EAGAIN) || !end_of_file_reached)
@@ -935,51 +3266,26 @@ void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars,
             Utility::portaudio_error_assert((error >= 0), "Failed to resume playback stream", error);
         }
 
-        if(RESAMPLING_NEEDED)
-        {
-            // set needed values
-            resampled_frame->channel_layout = CHANNEL_LAYOUT;
-            resampled_frame->sample_rate = SAMPLE_RATE;
-            resampled_frame->format = static_cast<int>(FFMPEG_OUTPUT_FORMAT);
-
-            // a odd thing seems to happen with .wav files where the channel layout is 0
-            // so we have to calculate and set it otherwise we get errors when resampling
-            decoded_frame->channel_layout = CHANNEL_LAYOUT;
-
-            // resample frame
-            error = swr_convert_frame(resampler, resampled_frame, decoded_frame);
-            Utility::error_assert((error >= 0), "Failed to resample frame", error);
-
-            // play audio
-            if(SAMPLES_INTERLEAVED)
-            {
-                error = playback.write(resampled_frame->extended_data[0], resampled_frame->nb_samples);
-            }
-
-            else
-            {
-                error = playback.write(resampled_frame->extended_data, resampled_frame->nb_samples);
-            }
+        // converted to the stream's format, unless it already is in it
+        error = converter.convert(decoded_frame);
+        Utility::error_assert((error >= 0), "Failed to resample frame", error);
 
-            Utility::portaudio_error_assert((error == -9980 || error >= 0), "Failed to play resampled frame", error); // -9980 == underrun
+        error = play_converted(output, converter.converted(), shared_vars.volume->level());
+        Utility::portaudio_error_assert((error == paOutputUnderflowed || error >= 0), "Failed to play frame", error);
 
-            av_frame_unref(resampled_frame);
-        }
+        // in automatic mode, the stream is reopened with a bigger buffer when it keeps running empty.
+        // With video the stream is the video thread's clock, it isn't closed under it, the next file's stream opens with the new latency
+        bool latency_raised{shared_vars.latency_governor->record(playback.underruns(), static_cast<double>(playback.frames_written()) / playback.sample_rate())};
 
-        else
+        if(latency_raised && !shared_vars.video_playback)
         {
-            // play audio
-            if(SAMPLES_INTERLEAVED) 
-            { 
-                error = playback.write(decoded_frame->extended_data[0], decoded_frame->nb_samples); 
-            }
+            error = playback.reopen_stream(shared_vars.latency_governor->latency());
+            Utility::portaudio_error_assert((error >= 0), "Failed to reopen portaudio stream", error);
 
-            else 
-            { 
-                error = playback.write(decoded_frame->extended_data, decoded_frame->nb_samples); 
+            if(options.verbose)
+            {
+                std::cout << "Audio output latency: " << playback.output_latency() * 1000.0 << " ms" << std::endl;
             }
-
-            Utility::portaudio_error_assert((error == -9980 || error >= 0), "Failed to play frame", error); // -9980 == underrun
         }
 
         error = 0;
@@ -998,6 +3304,90 @@ void audio_thread_func(FFmpeg::Decoder &decoder, Shared_Variables &shared_vars,
         Utility::error_assert((error == AVERROR(EAGAIN) || error >= 0), "Failed to receive packet from audio decoder", error);
     }
 
+    // the end of the file is still in the resampler and the ring buffer
+    if(!std::atomic_load<bool>(&shared_vars.skipping))
+    {
+        error = converter.flush();
+        Utility::error_assert((error >= 0), "Failed to flush resampler", error);
+
+        error = play_converted(output, converter.converted(), shared_vars.volume->level());
+        Utility::portaudio_error_assert((error == paOutputUnderflowed || error >= 0), "Failed to play frame", error);
+
+        // the stream keeps running with the end of the file in the crossfade, the next file fades in over it
+        if(output.crossfade().enabled())
+        {
+            output.start_fade();
+        }
+
+        else
+        {
+            playback.drain();
+        }
+    }
+
+    // skipped, the end of this file isn't played
+    else
+    {
+        output.clear();
+
+        error = converter.reset();
+        Utility::error_assert((error >= 0), "Failed to reset resampler", error);
+    }
+
+    // the rest of the video continues on the steady clock, the playback is gone after this function
+    shared_vars.master_clock->clear_audio_source();
+
+    // glitches heard during this file, compare a blocking stream with --audio-buffer=0 against the callback stream, with --cpu-load=N
+    double played_minutes{static_cast<double>(playback.frames_written() - start_frames_written) / playback.sample_rate() / 60.0};
+    unsigned long underruns{playback.underruns() - start_underruns};
+    unsigned long overruns{playback.overruns() - start_overruns};
+
+    std::cout << "Audio " << (playback.callback_mode() ? "callback" : "blocking") << " stream: "
+              << underruns << " underruns";
+
+    if(playback.callback_mode())
+    {
+        std::cout << " (" << (playback.underrun_frames() - start_underrun_frames) * 1000.0 / playback.sample_rate() << " ms of silence), "
+                  << overruns << " overruns";
+    }
+
+    if(played_minutes > 0.0)
+    {
+        std::cout << ", " << (underruns + overruns) / played_minutes << " glitches per minute";
+    }
+
+    std::cout << ", latency " << playback.actual_latency() * 1000.0 << " ms";
+
+    if(shared_vars.latency_governor->automatic())
+    {
+        std::cout << " (automatic)";
+    }
+
+    std::cout << std::endl;
+
+    // the output buffer is reused, only a frame bigger than any before it allocates, a kept output counts from the first file on
+    if(options.verbose && converter.reconfigurations() != 0)
+    {
+        std::cout << "Audio resampler: " << converter.reconfigurations() << " setups, " << converter.restarts() << " restarts, "
+                  << converter.allocations() << " output buffer allocations, " << converter.late_allocations() << " after the first frame" << std::endl;
+    }
+}
+
+/* play_converted function
+ * Description: plays converted audio through the output
+ * Parameter: output - the output with a started stream
+ * Parameter: converted - the converted frame, in the stream's format, which is interleaved, may be nullptr
+ * Parameter: volume - the volume in percent
+ * Return: a PortAudio error, paOutputUnderflowed if the stream ran empty before the write
+ */
+PaError play_converted(Audio::Output &output, const AVFrame *converted, int volume)
+{
+    if(!converted || converted->nb_samples <= 0)
+    {
+        return 0;
+    }
+
+    return output.play(converted->extended_data[0], converted->nb_samples, volume);
 }
 
 void terminal_listen_thread_func(Shared_Variables &shared_vars, int &current_file_index, std::condition_variable &paused_cv)
@@ -1013,6 +3403,7 @@ void terminal_listen_thread_func(Shared_Variables &shared_vars, int &current_fil
     std::cout << "play" << std::endl;
     std::cout << "next" << std::endl;
     std::cout << "prev" << std::endl;
+    std::cout << "volume [N|+N|-N]" << std::endl;
     std::cout << "exit" << std::endl;
 
     std::string input{};
@@ -1046,19 +3437,19 @@ void terminal_listen_thread_func(Shared_Variables &shared_vars, int &current_fil
 
         else if(input == "fullscreen")
         {
-            if(shared_vars.fullscreen)
+            if(shared_vars.video_output->fullscreen)
             {
                 int error{0};
-                error = SDL_SetWindowFullscreen(shared_vars.window, 0);
+                error = SDL_SetWindowFullscreen(shared_vars.video_output->window, 0);
                 Utility::error_assert((error >= 0), "Failed to fullscreen window");
-                shared_vars.fullscreen = false;
+                shared_vars.video_output->fullscreen = false;
             }
             else
             {
                 int error{0};
-                error = SDL_SetWindowFullscreen(shared_vars.window, SDL_WINDOW_FULLSCREEN_DESKTOP);
+                error = SDL_SetWindowFullscreen(shared_vars.video_output->window, SDL_WINDOW_FULLSCREEN_DESKTOP);
                 Utility::error_assert((error >= 0), "Failed to fullscreen window");
-                shared_vars.fullscreen = true;
+                shared_vars.video_output->fullscreen = true;
             }
         }
 
@@ -1101,7 +3492,8 @@ void terminal_listen_thread_func(Shared_Variables &shared_vars, int &current_fil
             return;
         }
 
-        else
+        // volume, volume N, volume +N, volume -N
+        else if(!shared_vars.volume->command(input))
         {
             std::cout << "Unkown command" << std::endl;
         }
@@ -1119,8 +3511,29 @@ void sdl_listen_thread_func(Shared_Variables &shared_vars, int &current_file_ind
         error = SDL_WaitEvent(&event);
         Utility::error_assert((error == 1), "Failed to wait for event");
 
+        // the video ended, video_playback wants this thread to return
+        if(event.type == SDL_USEREVENT)
+        {
+            return;
+        }
+
+        // the window moved, possibly to another display, or a display was added, removed or changed
+        // the cached display bounds are updated, the video threads pick them up before the next frame
+        else if(event.type == SDL_DISPLAYEVENT || (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_MOVED)
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+                || (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED)
+#endif
+                )
+        {
+            if(shared_vars.video_output->display_info.update(shared_vars.video_output->window) && shared_vars.verbose)
+            {
+                SDL_Rect resolution{shared_vars.video_output->display_info.resolution()};
+                std::cout << "Display changed, usable resolution " << resolution.w << "x" << resolution.h << std::endl;
+            }
+        }
+
         // key press event
-        if(event.type == SDL_KEYDOWN)
+        else if(event.type == SDL_KEYDOWN)
         {
             SDL_KeyboardEvent *key_event{reinterpret_cast<SDL_KeyboardEvent*>(&event)};
             SDL_KeyCode key_code{ static_cast<SDL_KeyCode>(key_event->keysym.sym) };
@@ -1143,21 +3556,31 @@ void sdl_listen_thread_func(Shared_Variables &shared_vars, int &current_file_ind
                 std::exit(0);
             }
 
+            else if(key_code == SDLK_s)
+            {
+                std::atomic_store<bool>(&shared_vars.print_statistics, true);
+            }
+
+            else if(key_code == SDLK_9 || key_code == SDLK_0)
+            {
+                shared_vars.volume->step(key_code == SDLK_0 ? Audio::VOLUME_STEP : -Audio::VOLUME_STEP);
+            }
+
             else if(key_code == SDLK_f)
             {
-                if(shared_vars.fullscreen)
+                if(shared_vars.video_output->fullscreen)
                 {
                     int error{0};
-                    error = SDL_SetWindowFullscreen(shared_vars.window, 0);
+                    error = SDL_SetWindowFullscreen(shared_vars.video_output->window, 0);
                     Utility::error_assert((error >= 0), "Failed to fullscreen window");
-                    shared_vars.fullscreen = false;
+                    shared_vars.video_output->fullscreen = false;
                 }
                 else
                 {
                     int error{0};
-                    error = SDL_SetWindowFullscreen(shared_vars.window, SDL_WINDOW_FULLSCREEN_DESKTOP);
+                    error = SDL_SetWindowFullscreen(shared_vars.video_output->window, SDL_WINDOW_FULLSCREEN_DESKTOP);
                     Utility::error_assert((error >= 0), "Failed to fullscreen window");
-                    shared_vars.fullscreen = true;
+                    shared_vars.video_output->fullscreen = true;
                 }
             }
 
@@ -1,6 +1,13 @@
 #include <portaudio/portaudio.h>
+#include <utility/ring_buffer.h>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 namespace PortAudio
 {
@@ -38,7 +45,10 @@ namespace PortAudio
     Stream_Playback::Stream_Playback() : 
         m_host_api{-1}, m_device{-1}, m_stream{nullptr},
         m_channel_count{0}, m_sample_format{0}, m_suggested_latency{0.0},
-        m_sample_rate{0}, m_stream_stopped{true}
+        m_sample_rate{0}, m_flags{paNoFlag}, m_stream_stopped{true},
+        m_buffer_duration{0.0}, m_ring_buffer{}, m_silence{0}, m_primed{false}, m_draining{false},
+        m_frames_written{0}, m_underruns{0}, m_underrun_frames{0}, m_overruns{0},
+        m_output_latency{0.0}, m_anchor_sequence{0}, m_anchor_time{-1.0}, m_anchor_position{0.0}, m_start_position{0.0}, m_frames_read{0}
     {}
 
 
@@ -103,6 +113,16 @@ namespace PortAudio
     }
 
 
+    /* set_buffer_duration function
+     * Description: picks a callback stream with a ring buffer of the given duration, or a blocking stream. Has to be called before open_stream
+     * Parameter duration - seconds of audio the ring buffer holds, 0 for a blocking stream
+     */
+    void Stream_Playback::set_buffer_duration(double duration)
+    {
+        m_buffer_duration = std::max(duration, 0.0);
+    }
+
+
     /* open_stream function
      * Description: opens a stream for audio playback
      * Parameter channel_count - number of channels for audio playback
@@ -137,12 +157,16 @@ namespace PortAudio
         m_channel_count = channel_count;
         m_sample_format = sample_format;
         m_sample_rate = sample_rate;
+        m_flags = flags;
+
+        // the callback plays interleaved frames from the ring buffer, planar audio is interleaved as it is written into it
+        PaSampleFormat stream_format{callback_mode() ? (m_sample_format & ~paNonInterleaved) : m_sample_format};
 
         // setup stream parameters struct
         PaStreamParameters stream_parameters;
         stream_parameters.device = m_device;                     // set device to use
         stream_parameters.channelCount = m_channel_count;        // set output channel count
-        stream_parameters.sampleFormat = m_sample_format;        // set output sample format
+        stream_parameters.sampleFormat = stream_format;          // set output sample format
         stream_parameters.suggestedLatency = m_suggested_latency;// set output suggested latency
         stream_parameters.hostApiSpecificStreamInfo = nullptr;   // set host secific apt info to nothing
 
@@ -155,6 +179,29 @@ namespace PortAudio
             return error;
         }
 
+        m_frames_written = 0;
+        m_underruns = 0;
+        m_underrun_frames = 0;
+        m_overruns = 0;
+        m_frames_read = 0;
+        m_start_position = 0.0;
+        set_anchor(-1.0, 0.0);
+
+        if(callback_mode())
+        {
+            int sample_size{Pa_GetSampleSize(stream_format)};
+            if(sample_size < 0)
+            {
+                return sample_size;
+            }
+
+            // allocated here, the callback never allocates
+            m_ring_buffer.allocate(static_cast<std::size_t>(std::ceil(m_buffer_duration * sample_rate)), channel_count, sample_size);
+            m_silence = (stream_format == paUInt8) ? 128 : 0;
+            m_primed = false;
+            m_draining = false;
+        }
+
         // open the stream
         error = Pa_OpenStream(&m_stream,                        // pointer to where the newly made stream will be stored
                               nullptr,                          // input parameters
@@ -162,8 +209,139 @@ namespace PortAudio
                               static_cast<double>(sample_rate), // sample rate
                               0,                                // frames per buffer, 0 for unknown / default
                               flags,                            // flags
-                              nullptr,                          // callback, not needed
-                              nullptr);                         // user data, not needed
+                              callback_mode() ? &Stream_Playback::stream_callback : nullptr, // callback, only for callback streams
+                              callback_mode() ? this : nullptr);                             // user data, this stream
+
+        if(error < 0)
+        {
+            return error;
+        }
+
+        const PaStreamInfo *stream_info{Pa_GetStreamInfo(m_stream)};
+        m_output_latency = stream_info ? stream_info->outputLatency : m_suggested_latency;
+
+        return error;
+    }
+
+
+    /* open_native_stream function
+     * Description: opens a stream in the device's own format, so the host doesn't have to convert, and any source can be converted to it:
+     * the device's default sample rate, stereo, or mono if that's all the device has, and the first of 32 bit float, 32 bit and
+     * 16 bit integer interleaved samples the device takes. The format picked can be read with the getters
+     * Parameter suggested_latency - the suggested latency to use -1 for default
+     * Parameter flags - PortAudio stream flags
+     * Return: positive value on success, negative value on failure
+     */
+    PaError Stream_Playback::open_native_stream(PaTime suggested_latency, PaStreamFlags flags)
+    {
+        const PaDeviceInfo *device_info{Pa_GetDeviceInfo(m_device)};
+
+        if(!device_info)
+        {
+            return paInvalidDevice;
+        }
+
+        int channel_count{std::min(device_info->maxOutputChannels, 2)};
+        if(channel_count < 1)
+        {
+            return paInvalidChannelCount;
+        }
+
+        int sample_rate{static_cast<int>(std::lround(device_info->defaultSampleRate))};
+
+        // best first
+        static const PaSampleFormat SAMPLE_FORMATS[]{paFloat32, paInt32, paInt16};
+
+        PaError error{paSampleFormatNotSupported};
+        PaError first_error{0};
+
+        // hosts don't agree on how they refuse a format, some say paInvalidSampleRate or paUnanticipatedHostError,
+        // so any failure moves on to the next format
+        for(PaSampleFormat sample_format : SAMPLE_FORMATS)
+        {
+            error = open_stream(channel_count, sample_format, suggested_latency, sample_rate, flags);
+
+            if(error >= 0)
+            {
+                return error;
+            }
+
+            if(first_error == 0)
+            {
+                first_error = error;
+            }
+        }
+
+        // the best format's error says the most about why nothing opened
+        return first_error;
+    }
+
+
+
+    /* reopen_stream function
+     * Description: closes the opened stream and opens it again in the same format with another suggested latency, e.g. after underruns.
+     * A started stream plays what it was given first and is started again, the statistics and the played time carry on.
+     * Not safe while another thread reads played_time(), the stream is closed in between
+     * Parameter suggested_latency - the suggested latency to use -1 for default
+     * Return: positive value on success, negative value on failure
+     */
+    PaError Stream_Playback::reopen_stream(PaTime suggested_latency)
+    {
+        if(!m_stream)
+        {
+            return paBadStreamPtr;
+        }
+
+        bool started{!m_stream_stopped};
+        PaError error{0};
+
+        if(started)
+        {
+            drain();
+
+            error = stop_stream();
+
+            if(error < 0)
+            {
+                return error;
+            }
+        }
+
+        error = Pa_CloseStream(m_stream);
+        m_stream = nullptr;
+
+        if(error < 0)
+        {
+            return error;
+        }
+
+        // open_stream() starts them from 0
+        unsigned long long frames_written{m_frames_written};
+        unsigned long underruns{m_underruns};
+        unsigned long long underrun_frames{m_underrun_frames};
+        unsigned long overruns{m_overruns};
+        unsigned long long frames_read{m_frames_read};
+        double start_position{m_start_position};
+
+        error = open_stream(m_channel_count, m_sample_format, suggested_latency, m_sample_rate, m_flags);
+
+        if(error < 0)
+        {
+            return error;
+        }
+
+        m_frames_written = frames_written;
+        m_underruns = underruns;
+        m_underrun_frames = underrun_frames;
+        m_overruns = overruns;
+        m_frames_read = frames_read;
+        m_start_position = start_position;
+        set_anchor(-1.0, start_position);
+
+        if(started)
+        {
+            error = start_stream();
+        }
 
         return error;
     }
@@ -182,6 +360,8 @@ namespace PortAudio
 
         PaError error{0};
 
+        m_draining = false;
+
         error = Pa_StartStream(m_stream);
 
         if(error < 0)
@@ -191,6 +371,12 @@ namespace PortAudio
 
         m_stream_stopped = false;
 
+        // a callback stream anchors itself in the first callback, a blocking one starts playing what's written after the output latency
+        if(!callback_mode())
+        {
+            set_anchor(Pa_GetStreamTime(m_stream) + m_output_latency, m_start_position);
+        }
+
         return error;
     }
 
@@ -217,27 +403,180 @@ namespace PortAudio
 
         m_stream_stopped = true;
 
+        // stopping plays everything the device was given, so that's where playback resumes from
+        m_start_position = static_cast<double>(played_frames()) / m_sample_rate;
+        set_anchor(-1.0, m_start_position);
+
         return error;
 
     }
 
 
     /* write function
-     * Description: writes audio data to the opened stream
-     * Parameter: data - pointer to audio data
+     * Description: writes audio data to the opened stream, blocks until it all fits
+     * A callback stream copies it into the ring buffer. If the buffer stays full for longer than it takes to play, the callback isn't
+     * playing anymore, then the rest is dropped and counted as an overrun, instead of blocking forever
+     * Parameter: data - pointer to audio data, an array of channel pointers if the sample format is non interleaved
      * Parameter: number_samples - the number of samples contained in the audio data
-     * Return: a positive value on success, negative error on failure
+     * Return: a positive value on success, negative error on failure, paOutputUnderflowed if a blocking stream ran empty before this write
      */
     PaError Stream_Playback::write(const void *data, unsigned long number_samples)
     {
         PaError error{0};
 
-        error = Pa_WriteStream(m_stream, data, number_samples);
+        if(!callback_mode())
+        {
+            error = Pa_WriteStream(m_stream, data, number_samples);
+
+            if(error == paOutputUnderflowed)
+            {
+                m_underruns++;
+            }
+
+            m_frames_written += number_samples;
+
+            // the write returns once the rest fits, so about the output latency of audio is still waiting to be heard
+            set_anchor(Pa_GetStreamTime(m_stream), static_cast<double>(m_frames_written) / m_sample_rate - m_output_latency);
+
+            return error;
+        }
+
+        bool planar{(m_sample_format & paNonInterleaved) != 0};
+        unsigned long written{0};
+
+        // a quarter of the ring buffer is played between checks for room, so this thread sleeps most of the time it waits
+        std::chrono::duration<double> poll_interval{m_buffer_duration / 4.0};
+        std::chrono::duration<double> stall_timeout{m_buffer_duration + m_suggested_latency + 0.5};
+        auto last_progress{std::chrono::steady_clock::now()};
+
+        while(written != number_samples)
+        {
+            std::size_t count{0};
+
+            if(planar)
+            {
+                count = m_ring_buffer.write_planar(static_cast<const uint8_t *const*>(data), written, number_samples - written);
+            }
+
+            else
+            {
+                count = m_ring_buffer.write(static_cast<const uint8_t*>(data) + written * m_ring_buffer.frame_size(), number_samples - written);
+            }
+
+            written += count;
+
+            // the buffer filled up, or would have if nothing was played yet, from now on running empty is an underrun
+            if(!m_primed && (m_ring_buffer.space() == 0 || m_frames_written + written >= m_ring_buffer.capacity()))
+            {
+                m_primed = true;
+            }
+
+            if(written == number_samples)
+            {
+                break;
+            }
+
+            auto now{std::chrono::steady_clock::now()};
+
+            if(count != 0)
+            {
+                last_progress = now;
+            }
+
+            else if(now - last_progress > stall_timeout)
+            {
+                m_overruns++;
+                break;
+            }
+
+            std::this_thread::sleep_for(poll_interval);
+        }
+
+        m_frames_written += written;
 
         return error;
     }
 
 
+    /* drain function
+     * Description: waits until the callback has played everything in the ring buffer, so stopping the stream doesn't cut off the end
+     * The buffer running empty while draining isn't an underrun. Does nothing for a blocking stream, stopping it plays what was written
+     */
+    void Stream_Playback::drain()
+    {
+        if(!callback_mode() || m_stream_stopped)
+        {
+            return;
+        }
+
+        m_draining = true;
+
+        std::chrono::duration<double> poll_interval{m_buffer_duration / 8.0};
+        std::chrono::duration<double> timeout{m_buffer_duration + m_suggested_latency + 0.5};
+        auto drain_start{std::chrono::steady_clock::now()};
+
+        while(m_ring_buffer.available() != 0 && std::chrono::steady_clock::now() - drain_start < timeout)
+        {
+            std::this_thread::sleep_for(poll_interval);
+        }
+    }
+
+
+    // PortAudio callback, runs on PortAudio's real-time thread, user_data is the Stream_Playback
+    int Stream_Playback::stream_callback(const void *input,
+                                         void *output,
+                                         unsigned long frame_count,
+                                         const PaStreamCallbackTimeInfo *time_info,
+                                         PaStreamCallbackFlags status_flags,
+                                         void *user_data)
+    {
+        static_cast<void>(input);
+
+        static_cast<Stream_Playback*>(user_data)->fill_buffer(static_cast<uint8_t*>(output), frame_count, time_info, status_flags);
+
+        return paContinue;
+    }
+
+
+    /* fill_buffer function
+     * Description: fills a device buffer from the ring buffer, whatever the ring buffer is short of is played as silence
+     * Called from the callback, so it must not lock, allocate or do anything else that may block
+     */
+    void Stream_Playback::fill_buffer(uint8_t *output, unsigned long frame_count, const PaStreamCallbackTimeInfo *time_info, PaStreamCallbackFlags status_flags)
+    {
+        // the first frame of this buffer is heard at the DAC time, some hosts don't know it and leave it 0
+        double dac_time{time_info->outputBufferDacTime};
+        if(dac_time <= 0.0)
+        {
+            dac_time = time_info->currentTime + m_output_latency;
+        }
+
+        unsigned long long frames_read{m_frames_read.load(std::memory_order_relaxed)};
+        set_anchor(dac_time, static_cast<double>(frames_read) / m_sample_rate);
+
+        std::size_t count{m_ring_buffer.read(output, frame_count)};
+
+        m_frames_read.store(frames_read + count, std::memory_order_relaxed);
+
+        if(count != frame_count)
+        {
+            std::memset(output + count * m_ring_buffer.frame_size(), m_silence, (frame_count - count) * m_ring_buffer.frame_size());
+
+            if(m_primed.load(std::memory_order_relaxed) && !m_draining.load(std::memory_order_relaxed))
+            {
+                m_underruns.fetch_add(1, std::memory_order_relaxed);
+                m_underrun_frames.fetch_add(frame_count - count, std::memory_order_relaxed);
+            }
+        }
+
+        // the host ran out of data anyway, because the callback was called too late
+        else if(status_flags & paOutputUnderflow)
+        {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+
     /* reset function
      * Description: deallocates any allocated memory, closes streams, and resets all members to default values
      * Return: a negative PaError on failure, positive value on success
@@ -267,12 +606,84 @@ namespace PortAudio
         m_channel_count = -1;
         m_sample_format = 0;
         m_suggested_latency = -1.0;
+        m_flags = paNoFlag;
         m_stream_stopped = true;
+        m_buffer_duration = 0.0;
+        m_primed = false;
+        m_draining = false;
 
         return error;
     }
 
 
+    /* set_anchor function
+     * Description: publishes where playback is, without locking, only one thread may call it at a time
+     * Parameter: time - stream time the frame at position is heard, negative if the stream isn't playing yet
+     * Parameter: position - the frame heard at time, as seconds of written audio
+     */
+    void Stream_Playback::set_anchor(double time, double position)
+    {
+        unsigned int sequence{m_anchor_sequence.load(std::memory_order_relaxed)};
+
+        m_anchor_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        m_anchor_time.store(time, std::memory_order_relaxed);
+        m_anchor_position.store(position, std::memory_order_relaxed);
+
+        m_anchor_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+
+    // gets the frames handed to the device, the callback only gets them out of the ring buffer
+    unsigned long long Stream_Playback::played_frames() const
+    {
+        return callback_mode() ? m_frames_read.load(std::memory_order_relaxed) : m_frames_written.load(std::memory_order_relaxed);
+    }
+
+
+    /* played_time function
+     * Description: gets how much of the written audio has been heard, in seconds. It moves with the stream's clock between updates,
+     * but never past what the device was given, so it stands still when the stream is stopped or runs empty. Safe to call from any thread
+     * Return: seconds of audio heard since the stream was opened
+     */
+    double Stream_Playback::played_time() const
+    {
+        if(!m_stream || m_sample_rate <= 0)
+        {
+            return 0.0;
+        }
+
+        double anchor_time{0.0};
+        double anchor_position{0.0};
+        unsigned int sequence{0};
+
+        // read again if the anchor changed while reading it
+        do
+        {
+            sequence = m_anchor_sequence.load(std::memory_order_acquire);
+
+            anchor_time = m_anchor_time.load(std::memory_order_relaxed);
+            anchor_position = m_anchor_position.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        while((sequence & 1) || sequence != m_anchor_sequence.load(std::memory_order_relaxed));
+
+        double start_position{m_start_position.load(std::memory_order_relaxed)};
+        double position{start_position};
+
+        if(anchor_time >= 0.0)
+        {
+            position = anchor_position + (Pa_GetStreamTime(m_stream) - anchor_time);
+        }
+
+        double end_position{static_cast<double>(played_frames()) / m_sample_rate};
+
+        return std::min(std::max(position, start_position), std::max(end_position, start_position));
+    }
+
+
     /* acutal_latency function
      * Description: gets the actual latency of the stream
      * Return: a postive value on success, negative one on failure
@@ -298,6 +709,15 @@ namespace PortAudio
     PaTime Stream_Playback::suggested_latency() const { return m_suggested_latency; }
     int Stream_Playback::sample_rate() const { return m_sample_rate; }
 
+    bool Stream_Playback::callback_mode() const { return m_buffer_duration > 0.0; }
+    double Stream_Playback::buffer_duration() const { return m_buffer_duration; }
+    unsigned long Stream_Playback::buffered_frames() const { return callback_mode() ? m_ring_buffer.available() : 0; }
+    unsigned long long Stream_Playback::frames_written() const { return m_frames_written; }
+    unsigned long Stream_Playback::underruns() const { return m_underruns; }
+    unsigned long long Stream_Playback::underrun_frames() const { return m_underrun_frames; }
+    unsigned long Stream_Playback::overruns() const { return m_overruns; }
+    PaTime Stream_Playback::output_latency() const { return m_output_latency; }
+
     PaStream *Stream_Playback::stream() { return m_stream; }
     const PaStream *Stream_Playback::stream() const { return m_stream; }
 
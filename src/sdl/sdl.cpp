@@ -117,4 +117,32 @@ namespace SDL
     const SDL_Texture* Texture::texture() const { return m_texture; }
 
     // Texture End //
+
+
+    // Surface Start //
+
+    // Constructor //
+    Surface::Surface() : m_surface{nullptr}
+    {}
+
+    // Destructor
+    Surface::~Surface()
+    {
+        if(m_surface)
+        {
+            SDL_FreeSurface(m_surface);
+        }
+    }
+
+    // overloaded SDL_Surface* cast operator
+    Surface::operator SDL_Surface*() { return m_surface; }
+
+    // overloaded = operator
+    SDL_Surface *Surface::operator =(SDL_Surface *surface) { return m_surface = surface; }
+
+    // Getters //
+    SDL_Surface* Surface::surface() { return m_surface; }
+    const SDL_Surface* Surface::surface() const { return m_surface; }
+
+    // Surface End //
 }
@@ -0,0 +1,78 @@
+#include <utility/display_info.h>
+#include <utility/utility.h>
+
+extern "C"
+{
+#include <SDL2/SDL.h>
+}
+
+#include <mutex>
+#include <atomic>
+
+namespace Utility
+{
+    // Constructor
+    Display_Info::Display_Info() : m_resolution{}, m_display_index{-1}, m_changes{0}
+    {
+        m_resolution.w = -1;
+        m_resolution.h = -1;
+    }
+
+    /* update function
+     * Description: reads the bounds of the display the window is on, the first display is used if window is nullptr
+     * Parameter: window - the video window, or nullptr if there is none yet
+     * Return: true if the display or its bounds changed, false if nothing changed or the bounds couldn't be read
+     */
+    bool Display_Info::update(SDL_Window *window)
+    {
+        int display_index{window ? SDL_GetWindowDisplayIndex(window) : 0};
+        if(display_index < 0)
+        {
+            return false;
+        }
+
+        SDL_Rect resolution{get_native_resolution(display_index)};
+        if(resolution.w <= 0 || resolution.h <= 0)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if(display_index == m_display_index && resolution.w == m_resolution.w && resolution.h == m_resolution.h)
+        {
+            return false;
+        }
+
+        m_display_index = display_index;
+        m_resolution = resolution;
+        m_changes++;
+
+        return true;
+    }
+
+    // sets fixed bounds, for when there is no display, like in the headless benchmark
+    void Display_Info::set_resolution(const SDL_Rect &resolution)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        m_display_index = -1;
+        m_resolution = resolution;
+        m_changes++;
+    }
+
+    // getters //
+    SDL_Rect Display_Info::resolution() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_resolution;
+    }
+
+    int Display_Info::display_index() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_display_index;
+    }
+
+    int Display_Info::changes() const { return m_changes; }
+}
@@ -0,0 +1,175 @@
+#include <utility/frame_scheduler.h>
+
+extern "C"
+{
+#include <time.h>
+}
+
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+namespace Utility
+{
+    // how long before the target time the scheduler stops sleeping and starts spinning
+    // has to cover the wakeup latency of clock_nanosleep, which is usually well below this
+    static const std::chrono::microseconds SPIN_MARGIN{400};
+
+    // how much of the measured phase error a present moves the vsync edge estimate by
+    // small, so one slow wakeup doesn't shift the grid, but a display a little off its nominal rate is still followed
+    static const double PHASE_GAIN{0.125};
+
+    // gets the CPU time used by the calling thread, in seconds
+    static double thread_cpu_time()
+    {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+        return time.tv_sec + time.tv_nsec / 1e9;
+    }
+
+    // sleeps for the given duration with clock_nanosleep on an absolute deadline, so interrupted sleeps don't drift
+    static void sleep_for(std::chrono::steady_clock::duration duration)
+    {
+        timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+        long long nanoseconds{std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()};
+
+        deadline.tv_sec += nanoseconds / 1000000000;
+        deadline.tv_nsec += nanoseconds % 1000000000;
+
+        if(deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+        {
+        }
+    }
+
+    // Constructor
+    // Parameter busy_wait - true to spin for the whole wait, like the player used to, only useful for comparison
+    Frame_Scheduler::Frame_Scheduler(bool busy_wait) :
+        m_busy_wait{busy_wait}, m_refresh_interval{0.0}, m_vsync_edge{}, m_presented{false},
+        m_waits{0}, m_late_frames{0}, m_total_lateness{0.0}, m_max_lateness{0.0}, m_wait_time{0.0}, m_wait_cpu_time{0.0}
+    {}
+
+    // sets the display refresh interval in seconds, 0 turns vsync alignment off
+    void Frame_Scheduler::set_refresh_interval(double refresh_interval)
+    {
+        m_refresh_interval = refresh_interval;
+    }
+
+    /* align function
+     * Description: lines a frame's due time up with the display's vsync. Returns a time half a refresh interval before the first vsync edge
+     * that is at most a quarter refresh interval early, presenting then makes the frame show up on that edge.
+     * Edges come from a fixed grid instead of the last present, and a due time halfway between two edges always goes to the later one,
+     * so 24 fps on 60 Hz keeps a steady 3:2 cadence instead of flipping with wakeup noise
+     * Parameter: due_time - the time the frame should be on screen
+     * Return: the time to present the frame at, due_time if vsync alignment is off or no frame was presented yet
+     */
+    std::chrono::steady_clock::time_point Frame_Scheduler::align(std::chrono::steady_clock::time_point due_time) const
+    {
+        if(m_refresh_interval <= 0.0 || !m_presented)
+        {
+            return due_time;
+        }
+
+        std::chrono::duration<double> since_edge{due_time - m_vsync_edge};
+        double edges{std::ceil(since_edge.count() / m_refresh_interval - 0.25)};
+
+        std::chrono::duration<double> offset{(edges - 0.5) * m_refresh_interval};
+
+        return m_vsync_edge + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+    }
+
+    /* wait_until function
+     * Description: blocks until target_time. Sleeps until SPIN_MARGIN before it, then spins for the rest
+     * Parameter: target_time - the time to wake up at
+     */
+    void Frame_Scheduler::wait_until(std::chrono::steady_clock::time_point target_time)
+    {
+        auto wait_start{std::chrono::steady_clock::now()};
+
+        // already late, nothing to wait for. Not counted in the jitter, that is caused by whatever made the frame late
+        if(wait_start >= target_time)
+        {
+            m_late_frames++;
+            return;
+        }
+
+        double cpu_start{thread_cpu_time()};
+
+        if(!m_busy_wait && target_time - wait_start > SPIN_MARGIN)
+        {
+            sleep_for(target_time - SPIN_MARGIN - wait_start);
+        }
+
+        auto current_time{std::chrono::steady_clock::now()};
+
+        while(current_time < target_time)
+        {
+            current_time = std::chrono::steady_clock::now();
+        }
+
+        std::chrono::duration<double> lateness{current_time - target_time};
+        std::chrono::duration<double> wait_time{current_time - wait_start};
+
+        m_total_lateness += lateness.count();
+        m_max_lateness = std::max(m_max_lateness, lateness.count());
+        m_wait_time += wait_time.count();
+        m_wait_cpu_time += thread_cpu_time() - cpu_start;
+        m_waits++;
+    }
+
+    // has to be called right after a frame was presented, with vsync on presenting returns at a vsync edge
+    // the first present sets the vsync grid, later ones only nudge it towards where presents actually return
+    void Frame_Scheduler::presented()
+    {
+        auto present_time{std::chrono::steady_clock::now()};
+
+        if(!m_presented || m_refresh_interval <= 0.0)
+        {
+            m_vsync_edge = present_time;
+            m_presented = true;
+            return;
+        }
+
+        std::chrono::duration<double> since_edge{present_time - m_vsync_edge};
+        double edges{std::round(since_edge.count() / m_refresh_interval)};
+        double phase_error{since_edge.count() - edges * m_refresh_interval};
+
+        // a present far from any edge missed its vsync or vsync isn't honoured, it says nothing about the phase
+        double correction{std::abs(phase_error) < m_refresh_interval / 4.0 ? phase_error * PHASE_GAIN : 0.0};
+
+        std::chrono::duration<double> advance{edges * m_refresh_interval + correction};
+        m_vsync_edge += std::chrono::duration_cast<std::chrono::steady_clock::duration>(advance);
+    }
+
+    // prints how precise the waits were, and how much of a core waiting took
+    void Frame_Scheduler::print_statistics() const
+    {
+        if(m_waits == 0 && m_late_frames == 0)
+        {
+            return;
+        }
+
+        double cpu_usage{m_wait_time > 0.0 ? m_wait_cpu_time / m_wait_time * 100.0 : 0.0};
+
+        std::cout << "Frame scheduler (" << (m_busy_wait ? "busy wait" : "sleep + spin") << "): "
+                  << m_waits << " waits"
+                  << ", wake up jitter avg " << (m_waits > 0 ? m_total_lateness / m_waits * 1e6 : 0.0) << " us"
+                  << ", max " << m_max_lateness * 1e6 << " us"
+                  << ", " << m_late_frames << " frames already late"
+                  << ", CPU while waiting " << cpu_usage << "%" << std::endl;
+    }
+
+    // getters //
+    bool Frame_Scheduler::busy_wait() const { return m_busy_wait; }
+    double Frame_Scheduler::refresh_interval() const { return m_refresh_interval; }
+}
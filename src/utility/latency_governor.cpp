@@ -0,0 +1,110 @@
+#include <utility/latency_governor.h>
+
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+namespace Utility
+{
+    // latency automatic mode starts at, in seconds
+    static const double AUTOMATIC_START_LATENCY{0.01};
+
+    // latency automatic mode stops raising at, in seconds
+    static const double MAX_LATENCY{0.5};
+
+    // underruns within one window of played audio that raise the latency, a single one can be anything, e.g. a pause
+    static const unsigned long UNDERRUN_LIMIT{3};
+    static const double UNDERRUN_WINDOW{10.0};
+
+    /* parse_latency function
+     * Parameter: argument - the option's value, MS or auto
+     * Parameter: latency - set to the latency in seconds, the starting one for auto
+     * Parameter: automatic - set to true for auto
+     * Return: false if the argument is bad
+     */
+    bool parse_latency(const std::string &argument, double &latency, bool &automatic)
+    {
+        if(argument == "auto")
+        {
+            latency = AUTOMATIC_START_LATENCY;
+            automatic = true;
+            return true;
+        }
+
+        if(argument.empty() || argument.size() > 4 || argument.find_first_not_of("0123456789") != std::string::npos || std::stoi(argument) == 0)
+        {
+            return false;
+        }
+
+        latency = std::stoi(argument) / 1000.0;
+        automatic = false;
+
+        return true;
+    }
+
+    // Constructor
+    // Parameter latency - the latency to use in seconds, in automatic mode the one to start at
+    // Parameter automatic - true to raise the latency after repeated underruns
+    Latency_Governor::Latency_Governor(double latency, bool automatic) :
+        m_latency{latency}, m_automatic{automatic}, m_underruns{0}, m_stream_underruns{0}, m_raises{0},
+        m_window_start{0.0}, m_window_underruns{0}
+    {}
+
+    /* record function
+     * Description: records the stream's underruns, and raises the latency if needed in automatic mode
+     * Parameter: stream_underruns - the underruns the stream counted since it was opened
+     * Parameter: played_time - seconds of audio written to the stream
+     * Return: true if the latency changed and the stream has to be reopened, false otherwise
+     */
+    bool Latency_Governor::record(unsigned long stream_underruns, double played_time)
+    {
+        // a new stream was opened since the last record
+        if(stream_underruns < m_stream_underruns || played_time < m_window_start)
+        {
+            m_stream_underruns = 0;
+            m_window_start = played_time;
+            m_window_underruns = 0;
+        }
+
+        unsigned long new_underruns{stream_underruns - m_stream_underruns};
+        m_stream_underruns = stream_underruns;
+
+        if(new_underruns == 0)
+        {
+            return false;
+        }
+
+        m_underruns += new_underruns;
+
+        if(played_time - m_window_start > UNDERRUN_WINDOW)
+        {
+            m_window_start = played_time;
+            m_window_underruns = 0;
+        }
+
+        m_window_underruns += new_underruns;
+
+        if(!m_automatic || m_window_underruns < UNDERRUN_LIMIT || m_latency >= MAX_LATENCY)
+        {
+            return false;
+        }
+
+        double old_latency{m_latency};
+        m_latency = std::min(m_latency * 2.0, MAX_LATENCY);
+        m_raises++;
+
+        std::cout << "Audio latency raised from " << old_latency * 1000.0 << " ms to " << m_latency * 1000.0 << " ms"
+                  << ", " << m_window_underruns << " underruns in " << played_time - m_window_start << " seconds" << std::endl;
+
+        m_window_start = played_time;
+        m_window_underruns = 0;
+
+        return true;
+    }
+
+    // getters //
+    double Latency_Governor::latency() const { return m_latency; }
+    bool Latency_Governor::automatic() const { return m_automatic; }
+    unsigned long Latency_Governor::underruns() const { return m_underruns; }
+    int Latency_Governor::raises() const { return m_raises; }
+}
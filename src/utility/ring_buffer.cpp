@@ -0,0 +1,142 @@
+#include <utility/ring_buffer.h>
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+namespace Utility
+{
+    // Constructor
+    Ring_Buffer::Ring_Buffer() :
+        m_buffer{}, m_capacity{0}, m_channel_count{0}, m_sample_size{0}, m_frame_size{0},
+        m_write_position{0}, m_read_position{0}
+    {}
+
+    /* allocate function
+     * Description: allocates room for the given number of frames and empties the buffer, not safe while the buffer is in use
+     * Parameter: capacity - the number of frames the buffer holds
+     * Parameter: channel_count - channels per frame
+     * Parameter: sample_size - bytes per sample of one channel
+     */
+    void Ring_Buffer::allocate(std::size_t capacity, int channel_count, int sample_size)
+    {
+        m_capacity = std::max(capacity, static_cast<std::size_t>(1));
+        m_channel_count = channel_count;
+        m_sample_size = sample_size;
+        m_frame_size = channel_count * sample_size;
+
+        m_buffer.assign(m_capacity * static_cast<std::size_t>(m_frame_size), 0);
+
+        clear();
+    }
+
+    // empties the buffer, not safe while the buffer is in use
+    void Ring_Buffer::clear()
+    {
+        m_write_position.store(0, std::memory_order_relaxed);
+        m_read_position.store(0, std::memory_order_relaxed);
+    }
+
+    /* write function
+     * Description: copies interleaved frames into the buffer, as many as there is room for. Only call from the producing thread
+     * Parameter: data - the interleaved frames
+     * Parameter: frames - the number of frames in data
+     * Return: the number of frames written, less than frames if the buffer is full
+     */
+    std::size_t Ring_Buffer::write(const uint8_t *data, std::size_t frames)
+    {
+        std::size_t write_position{m_write_position.load(std::memory_order_relaxed)};
+        std::size_t read_position{m_read_position.load(std::memory_order_acquire)};
+
+        std::size_t count{std::min(frames, m_capacity - (write_position - read_position))};
+
+        // the free part may wrap around the end of the buffer
+        std::size_t start{write_position % m_capacity};
+        std::size_t first_part{std::min(count, m_capacity - start)};
+
+        std::memcpy(&m_buffer[start * m_frame_size], data, first_part * m_frame_size);
+        std::memcpy(&m_buffer[0], data + first_part * m_frame_size, (count - first_part) * m_frame_size);
+
+        m_write_position.store(write_position + count, std::memory_order_release);
+
+        return count;
+    }
+
+    /* write_planar function
+     * Description: interleaves planar frames, one plane per channel like FFmpeg's extended_data, into the buffer. Only call from the producing thread
+     * Parameter: planes - a plane for every channel
+     * Parameter: offset - the first frame of the planes to write
+     * Parameter: frames - the number of frames to write, starting at offset
+     * Return: the number of frames written, less than frames if the buffer is full
+     */
+    std::size_t Ring_Buffer::write_planar(const uint8_t *const *planes, std::size_t offset, std::size_t frames)
+    {
+        std::size_t write_position{m_write_position.load(std::memory_order_relaxed)};
+        std::size_t read_position{m_read_position.load(std::memory_order_acquire)};
+
+        std::size_t count{std::min(frames, m_capacity - (write_position - read_position))};
+
+        for(std::size_t i{0}; i != count; ++i)
+        {
+            uint8_t *frame{&m_buffer[((write_position + i) % m_capacity) * m_frame_size]};
+
+            for(int channel{0}; channel != m_channel_count; ++channel)
+            {
+                std::memcpy(frame + channel * m_sample_size, planes[channel] + (offset + i) * m_sample_size, m_sample_size);
+            }
+        }
+
+        m_write_position.store(write_position + count, std::memory_order_release);
+
+        return count;
+    }
+
+    /* read function
+     * Description: copies interleaved frames out of the buffer, as many as there are. Only call from the consuming thread
+     * Parameter: data - where the frames go
+     * Parameter: frames - the number of frames wanted
+     * Return: the number of frames read, less than frames if the buffer ran empty
+     */
+    std::size_t Ring_Buffer::read(uint8_t *data, std::size_t frames)
+    {
+        std::size_t read_position{m_read_position.load(std::memory_order_relaxed)};
+        std::size_t write_position{m_write_position.load(std::memory_order_acquire)};
+
+        std::size_t count{std::min(frames, write_position - read_position)};
+
+        std::size_t start{read_position % m_capacity};
+        std::size_t first_part{std::min(count, m_capacity - start)};
+
+        std::memcpy(data, &m_buffer[start * m_frame_size], first_part * m_frame_size);
+        std::memcpy(data + first_part * m_frame_size, &m_buffer[0], (count - first_part) * m_frame_size);
+
+        m_read_position.store(read_position + count, std::memory_order_release);
+
+        return count;
+    }
+
+    // gets the number of frames that can be read, exact from either side, an estimate from any other thread
+    std::size_t Ring_Buffer::available() const
+    {
+        // read first, the write position can only be ahead of it
+        std::size_t read_position{m_read_position.load(std::memory_order_acquire)};
+        std::size_t write_position{m_write_position.load(std::memory_order_acquire)};
+
+        return std::min(write_position - read_position, m_capacity);
+    }
+
+    // gets the number of frames that can be written
+    std::size_t Ring_Buffer::space() const
+    {
+        return m_capacity - available();
+    }
+
+    // getters //
+    std::size_t Ring_Buffer::capacity() const { return m_capacity; }
+    int Ring_Buffer::channel_count() const { return m_channel_count; }
+    int Ring_Buffer::sample_size() const { return m_sample_size; }
+    int Ring_Buffer::frame_size() const { return m_frame_size; }
+}
@@ -0,0 +1,151 @@
+#include <utility/scaler_governor.h>
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+#include <string>
+#include <iostream>
+
+namespace Utility
+{
+    // fraction of the frame budget the average conversion time has to reach for a downgrade
+    static const double DOWNGRADE_THRESHOLD{0.6};
+
+    // fraction of the frame budget the average conversion time has to stay under for an upgrade
+    static const double UPGRADE_THRESHOLD{0.2};
+
+    // frames to wait after a switch before switching again, so the average can settle
+    static const int SWITCH_HOLD_FRAMES{60};
+
+    // get the libswscale flags for a preset
+    int scaler_flags(Scaler_Preset preset)
+    {
+        switch(preset)
+        {
+            case SCALER_FAST_BILINEAR:
+                return SWS_FAST_BILINEAR;
+
+            case SCALER_BILINEAR:
+                return SWS_BILINEAR;
+
+            case SCALER_LANCZOS:
+                return SWS_LANCZOS;
+
+            case SCALER_BICUBIC:
+            default:
+                return SWS_BICUBIC;
+        }
+    }
+
+    // get the command line name of a preset
+    std::string scaler_name(Scaler_Preset preset)
+    {
+        switch(preset)
+        {
+            case SCALER_FAST_BILINEAR:
+                return "fast-bilinear";
+
+            case SCALER_BILINEAR:
+                return "bilinear";
+
+            case SCALER_LANCZOS:
+                return "lanczos";
+
+            case SCALER_BICUBIC:
+            default:
+                return "bicubic";
+        }
+    }
+
+    // parse a command line name into a preset, returns false if the name is unknown
+    bool parse_scaler_preset(const std::string &name, Scaler_Preset &preset)
+    {
+        for(int i{SCALER_FAST_BILINEAR}; i <= SCALER_LANCZOS; ++i)
+        {
+            if(name == scaler_name(static_cast<Scaler_Preset>(i)))
+            {
+                preset = static_cast<Scaler_Preset>(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Constructor
+    // Parameter preset - the preset to use, in automatic mode this is the best preset that will be used
+    // Parameter automatic - true to switch presets automatically depending on conversion time
+    Scaler_Governor::Scaler_Governor(Scaler_Preset preset, bool automatic) :
+        m_preset{preset}, m_best_preset{preset}, m_automatic{automatic},
+        m_frame_budget{0.0}, m_average_time{0.0}, m_frames_since_switch{0}
+    {}
+
+    // set the time in seconds that one frame is displayed for
+    void Scaler_Governor::set_frame_budget(double frame_budget)
+    {
+        m_frame_budget = frame_budget;
+    }
+
+    /* record function
+     * Description: records how long an image conversion took, and switches preset if needed in automatic mode
+     * Parameter: conversion_time - the conversion time in seconds
+     * Return: true if the preset changed and the rescaler has to be rebuilt, false otherwise
+     */
+    bool Scaler_Governor::record(double conversion_time)
+    {
+        if(!m_automatic || m_frame_budget <= 0.0)
+        {
+            return false;
+        }
+
+        // exponential moving average, smooths out single slow frames
+        if(m_frames_since_switch == 0)
+        {
+            m_average_time = conversion_time;
+        }
+
+        else
+        {
+            m_average_time += (conversion_time - m_average_time) * 0.1;
+        }
+
+        m_frames_since_switch++;
+
+        if(m_frames_since_switch < SWITCH_HOLD_FRAMES)
+        {
+            return false;
+        }
+
+        Scaler_Preset old_preset{m_preset};
+
+        if(m_average_time > m_frame_budget * DOWNGRADE_THRESHOLD && m_preset != SCALER_FAST_BILINEAR)
+        {
+            m_preset = static_cast<Scaler_Preset>(m_preset - 1);
+        }
+
+        else if(m_average_time < m_frame_budget * UPGRADE_THRESHOLD && m_preset != m_best_preset)
+        {
+            m_preset = static_cast<Scaler_Preset>(m_preset + 1);
+        }
+
+        if(m_preset == old_preset)
+        {
+            return false;
+        }
+
+        std::cout << "Scaler switched from " << scaler_name(old_preset) << " to " << scaler_name(m_preset)
+                  << ", conversion time " << m_average_time * 1000.0 << " ms"
+                  << ", frame budget " << m_frame_budget * 1000.0 << " ms" << std::endl;
+
+        m_frames_since_switch = 0;
+
+        return true;
+    }
+
+    // getters //
+    Scaler_Preset Scaler_Governor::preset() const { return m_preset; }
+    int Scaler_Governor::flags() const { return scaler_flags(m_preset); }
+    bool Scaler_Governor::automatic() const { return m_automatic; }
+}
@@ -7,7 +7,7 @@ namespace Utility
 {
     // Constructor
     // Parameter count - the starting count
-    Semaphore::Semaphore(int count) : m_count{count}
+    Semaphore::Semaphore(int count) : m_count{count}, m_interrupted{false}
     {}
 
     // Destructor
@@ -42,6 +42,8 @@ namespace Utility
             m_condition_variable.notify_one();
         }
 
+        m_count_condition_variable.notify_all();
+
         return old_count;
     }
 
@@ -62,4 +64,32 @@ namespace Utility
 
         return old_count;
     }
+
+    /* wait_for_count function
+     * Description: waits until m_count is at least count, without subtracting from it. Also returns once interrupt has been called
+     * Return: returns the count when waking up
+     */
+    int Semaphore::wait_for_count(int count)
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        while(m_count < count && !m_interrupted)
+        {
+            m_count_condition_variable.wait(lock);
+        }
+
+        return m_count;
+    }
+
+    /* interrupt function
+     * Description: wakes up every thread in wait_for_count, and makes later calls return right away
+     * Used when the count will never be reached, like when the posting thread exits early
+     */
+    void Semaphore::interrupt()
+    {
+        m_mutex.lock();
+        m_interrupted = true;
+        m_mutex.unlock();
+
+        m_count_condition_variable.notify_all();
+    }
 }
@@ -0,0 +1,120 @@
+#include <utility/thread_pool.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+namespace Utility
+{
+    // Constructor
+    // Parameter thread_count - total threads to split work across including the calling thread, <= 0 for one per CPU core
+    Thread_Pool::Thread_Pool(int thread_count) :
+        m_task{nullptr}, m_task_count{0}, m_next_task{0},
+        m_tasks_done{0}, m_stopping{false}
+    {
+        if(thread_count <= 0)
+        {
+            thread_count = static_cast<int>(std::thread::hardware_concurrency());
+        }
+
+        // the thread calling run() does work too
+        for(int i{1}; i < thread_count; ++i)
+        {
+            m_threads.emplace_back(&Thread_Pool::worker, this);
+        }
+    }
+
+    // Destructor, wakes up and joins all the worker threads
+    Thread_Pool::~Thread_Pool()
+    {
+        m_mutex.lock();
+        m_stopping = true;
+        m_mutex.unlock();
+
+        m_work_condition_variable.notify_all();
+
+        for(std::thread &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    /* run function
+     * Description: calls task with every index from 0 to task_count - 1, split across the worker threads and the calling thread
+     * Returns once every task is done
+     * Parameter: task_count - the number of tasks
+     * Parameter: task - the function to call for each task index
+     */
+    void Thread_Pool::run(int task_count, const std::function<void(int)> &task)
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+
+        m_task = &task;
+        m_task_count = task_count;
+        m_next_task = 0;
+        m_tasks_done = 0;
+
+        lock.unlock();
+        m_work_condition_variable.notify_all();
+        lock.lock();
+
+        // help out instead of just waiting
+        while(m_next_task < m_task_count)
+        {
+            int current_task{m_next_task++};
+
+            lock.unlock();
+            task(current_task);
+            lock.lock();
+
+            m_tasks_done++;
+        }
+
+        while(m_tasks_done != m_task_count)
+        {
+            m_done_condition_variable.wait(lock);
+        }
+
+        // make sure sleeping workers don't see any work left
+        m_task = nullptr;
+        m_task_count = 0;
+        m_next_task = 0;
+    }
+
+    // worker thread function, takes tasks until the pool is destroyed
+    void Thread_Pool::worker()
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+
+        while(1)
+        {
+            while(!m_stopping && m_next_task >= m_task_count)
+            {
+                m_work_condition_variable.wait(lock);
+            }
+
+            if(m_stopping)
+            {
+                return;
+            }
+
+            int current_task{m_next_task++};
+            const std::function<void(int)> *task{m_task};
+
+            lock.unlock();
+            (*task)(current_task);
+            lock.lock();
+
+            m_tasks_done++;
+            if(m_tasks_done == m_task_count)
+            {
+                m_done_condition_variable.notify_one();
+            }
+        }
+    }
+
+    // getters //
+    int Thread_Pool::thread_count() const { return static_cast<int>(m_threads.size()) + 1; }
+}
@@ -1,51 +1,40 @@
 #include <utility/utility.h>
-#include <sdl/sdl.h>
 
 extern "C"
 {
 #include <SDL2/SDL.h>
 #include <libavutil/error.h>
 #include <libavutil/pixfmt.h>
+#include <libavutil/pixdesc.h>
 #include <libavutil/samplefmt.h>
 #include <libswscale/swscale.h>
 }
 
+#include <sys/resource.h>
+
 #include <string>
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
+#include <vector>
+#include <algorithm>
 
 namespace Utility
 {
-    // Function to get screens native resolution
-    SDL_Rect get_native_resolution()
+    // Function to get the usable resolution of a display, by display index
+    // the width and height are -1 if the display doesn't exist
+    SDL_Rect get_native_resolution(int display_index)
     {
         SDL_Rect rect;
         rect.w = -1;
         rect.h = -1;
 
-        // create a temporary window
-        SDL::Window window{};
-        window = SDL_CreateWindow("TEMP WINDOW", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 0, 0, SDL_WINDOW_HIDDEN);
-
-        if(!window)
-        {
-            return rect;
-        }
-
-        int display_index{0};
-
-        // get the display index of the window
-        display_index = SDL_GetWindowDisplayIndex(window);
-        if(display_index < 0)
-        {
-            return rect;
-        }
-
         // get display bounds(resolution) of the display at display index
-        display_index = SDL_GetDisplayUsableBounds(display_index, &rect);
-        if(display_index < 0)
+        int error{SDL_GetDisplayUsableBounds(display_index, &rect)};
+        if(error < 0)
         {
-            return rect;
+            rect.w = -1;
+            rect.h = -1;
         }
 
         return rect;
@@ -206,6 +195,8 @@ namespace Utility
                 ffmpeg_output_format = AV_PIX_FMT_YUV420P;
                 return true;
 
+            // older SDL versions can't upload NV12 / NV21 into a static texture, they are rescaled to YUV420P like the formats above
+#if SDL_VERSION_ATLEAST(2, 0, 16)
             case AV_PIX_FMT_NV12:
                 sdl_format = SDL_PIXELFORMAT_NV12;
                 ffmpeg_output_format = ffmpeg_input_format;
@@ -215,6 +206,13 @@ namespace Utility
                 sdl_format = SDL_PIXELFORMAT_NV21;
                 ffmpeg_output_format = ffmpeg_input_format;
                 return false;
+#else
+            case AV_PIX_FMT_NV12:
+            case AV_PIX_FMT_NV21:
+                sdl_format = SDL_PIXELFORMAT_YV12;
+                ffmpeg_output_format = AV_PIX_FMT_YUV420P;
+                return true;
+#endif
 
             default:
                 ffmpeg_output_format = AV_PIX_FMT_RGB24;
@@ -223,6 +221,105 @@ namespace Utility
         }
     }
 
+    // Texture_Path struct, an SDL texture format and the FFmpeg pixel format with the same memory layout
+    struct Texture_Path
+    {
+        uint32_t sdl_format;
+        enum AVPixelFormat ffmpeg_format;
+    };
+
+    // every texture format frames can be put into, the packed RGB ones use SDL's byte order names so they match on any endianness
+    // NV12 / NV21 need SDL_UpdateNVTexture for static textures, which older SDL versions don't have
+    static const Texture_Path TEXTURE_PATHS[]
+    {
+        {SDL_PIXELFORMAT_IYUV, AV_PIX_FMT_YUV420P},
+        {SDL_PIXELFORMAT_YV12, AV_PIX_FMT_YUV420P},
+#if SDL_VERSION_ATLEAST(2, 0, 16)
+        {SDL_PIXELFORMAT_NV12, AV_PIX_FMT_NV12},
+        {SDL_PIXELFORMAT_NV21, AV_PIX_FMT_NV21},
+#endif
+        {SDL_PIXELFORMAT_YUY2, AV_PIX_FMT_YUYV422},
+        {SDL_PIXELFORMAT_UYVY, AV_PIX_FMT_UYVY422},
+        {SDL_PIXELFORMAT_YVYU, AV_PIX_FMT_YVYU422},
+        {SDL_PIXELFORMAT_BGRA32, AV_PIX_FMT_BGRA},
+        {SDL_PIXELFORMAT_RGBA32, AV_PIX_FMT_RGBA},
+        {SDL_PIXELFORMAT_RGB24, AV_PIX_FMT_RGB24},
+        {SDL_PIXELFORMAT_BGR24, AV_PIX_FMT_BGR24}
+    };
+
+    // texture formats to convert into when the input can't be uploaded as it is, cheapest first
+    // YUV video is best kept in 4:2:0, RGB video in RGB, the other kind is only used if the renderer has nothing better
+    static const std::vector<uint32_t> YUV_CONVERSION_ORDER
+    {
+        SDL_PIXELFORMAT_IYUV, SDL_PIXELFORMAT_YV12, SDL_PIXELFORMAT_NV12, SDL_PIXELFORMAT_NV21,
+        SDL_PIXELFORMAT_BGRA32, SDL_PIXELFORMAT_RGBA32, SDL_PIXELFORMAT_RGB24
+    };
+
+    static const std::vector<uint32_t> RGB_CONVERSION_ORDER
+    {
+        SDL_PIXELFORMAT_BGRA32, SDL_PIXELFORMAT_RGBA32, SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_BGR24,
+        SDL_PIXELFORMAT_IYUV, SDL_PIXELFORMAT_YV12, SDL_PIXELFORMAT_NV12
+    };
+
+    // finds the texture path for an SDL format, nullptr if frames can't be put into it
+    static const Texture_Path *find_texture_path(uint32_t sdl_format)
+    {
+        for(const Texture_Path &path : TEXTURE_PATHS)
+        {
+            if(path.sdl_format == sdl_format)
+            {
+                return &path;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool rescaling_needed(enum AVPixelFormat ffmpeg_input_format, enum AVPixelFormat &ffmpeg_output_format, uint32_t &sdl_format,
+                          const std::vector<uint32_t> &texture_formats)
+    {
+        auto supported{[&texture_formats](uint32_t format)
+        {
+            return std::find(texture_formats.begin(), texture_formats.end(), format) != texture_formats.end();
+        }};
+
+        // nothing is known about the renderer
+        if(texture_formats.empty())
+        {
+            return rescaling_needed(ffmpeg_input_format, ffmpeg_output_format, sdl_format);
+        }
+
+        // cheapest, the frames are uploaded as they were decoded, into a texture the renderer can draw without converting
+        for(const Texture_Path &path : TEXTURE_PATHS)
+        {
+            if(path.ffmpeg_format == ffmpeg_input_format && supported(path.sdl_format))
+            {
+                sdl_format = path.sdl_format;
+                ffmpeg_output_format = ffmpeg_input_format;
+                return false;
+            }
+        }
+
+        // otherwise swscale converts into the cheapest format the renderer supports
+        const AVPixFmtDescriptor *descriptor{av_pix_fmt_desc_get(ffmpeg_input_format)};
+        bool rgb_input{descriptor && (descriptor->flags & AV_PIX_FMT_FLAG_RGB)};
+
+        for(uint32_t format : (rgb_input ? RGB_CONVERSION_ORDER : YUV_CONVERSION_ORDER))
+        {
+            const Texture_Path *path{find_texture_path(format)};
+
+            if(path && supported(format))
+            {
+                sdl_format = format;
+                ffmpeg_output_format = path->ffmpeg_format;
+                return true;
+            }
+        }
+
+        // the renderer supports none of them, let SDL convert
+        return rescaling_needed(ffmpeg_input_format, ffmpeg_output_format, sdl_format);
+    }
+
     bool valid_rescaling_input(enum AVPixelFormat pixel_format)
     {
         int result{sws_isSupportedInput(pixel_format)};
@@ -416,4 +513,63 @@ namespace Utility
                 return true;
         }
     }
+
+    // the FFmpeg sample format of a PortAudio one, AV_SAMPLE_FMT_NONE if FFmpeg doesn't have it
+    enum AVSampleFormat ffmpeg_sample_format(PaSampleFormat portaudio_format)
+    {
+        bool planar{(portaudio_format & paNonInterleaved) != 0};
+
+        switch(portaudio_format & ~paNonInterleaved)
+        {
+            case paUInt8:
+                return planar ? AV_SAMPLE_FMT_U8P : AV_SAMPLE_FMT_U8;
+
+            case paInt16:
+                return planar ? AV_SAMPLE_FMT_S16P : AV_SAMPLE_FMT_S16;
+
+            case paInt32:
+                return planar ? AV_SAMPLE_FMT_S32P : AV_SAMPLE_FMT_S32;
+
+            case paFloat32:
+                return planar ? AV_SAMPLE_FMT_FLTP : AV_SAMPLE_FMT_FLT;
+
+            default:
+                return AV_SAMPLE_FMT_NONE;
+        }
+    }
+
+    // peak resident memory of the process in kilobytes, -1 if it can't be read
+    long peak_memory_usage()
+    {
+        // VmHWM can be reset, unlike ru_maxrss
+        std::ifstream status{"/proc/self/status"};
+        std::string line;
+
+        while(std::getline(status, line))
+        {
+            if(line.rfind("VmHWM:", 0) == 0)
+            {
+                return std::strtol(line.c_str() + 6, nullptr, 10);
+            }
+        }
+
+        rusage usage;
+        if(getrusage(RUSAGE_SELF, &usage) == 0)
+        {
+            return usage.ru_maxrss;
+        }
+
+        return -1;
+    }
+
+    // resets the peak resident memory, so peak_memory_usage only covers what comes after. Only works on Linux
+    void reset_peak_memory_usage()
+    {
+        std::ofstream clear_refs{"/proc/self/clear_refs"};
+
+        if(clear_refs)
+        {
+            clear_refs << "5" << std::endl;
+        }
+    }
 }
@@ -0,0 +1,322 @@
+#include <video/deinterlace.h>
+#include <utility/thread_pool.h>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/imgutils.h>
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+
+namespace Video
+{
+    // get the command line name of a mode
+    std::string deinterlace_mode_name(Deinterlace_Mode mode)
+    {
+        switch(mode)
+        {
+            case DEINTERLACE_OFF:
+                return "off";
+
+            case DEINTERLACE_BOB:
+                return "bob";
+
+            case DEINTERLACE_ADAPTIVE:
+            default:
+                return "adaptive";
+        }
+    }
+
+    // parse a command line name into a mode, returns false if the name is unknown
+    bool parse_deinterlace_mode(const std::string &name, Deinterlace_Mode &mode)
+    {
+        for(int i{DEINTERLACE_OFF}; i <= DEINTERLACE_ADAPTIVE; ++i)
+        {
+            if(name == deinterlace_mode_name(static_cast<Deinterlace_Mode>(i)))
+            {
+                mode = static_cast<Deinterlace_Mode>(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // checks if a frame needs deinterlacing, either the frame or the stream it belongs to is flagged as interlaced
+    bool frame_interlaced(const AVFrame *frame, enum AVFieldOrder field_order)
+    {
+        return frame->interlaced_frame ||
+               (field_order != AV_FIELD_UNKNOWN && field_order != AV_FIELD_PROGRESSIVE);
+    }
+
+    // checks if the top field of an interlaced frame comes first, the frame flags are used over the stream's
+    bool top_field_first(const AVFrame *frame, enum AVFieldOrder field_order)
+    {
+        if(frame->interlaced_frame)
+        {
+            return frame->top_field_first;
+        }
+
+        return field_order == AV_FIELD_TT || field_order == AV_FIELD_TB;
+    }
+
+    // Row functions //
+    // Each one builds a missing line, SSE2 does 16 bytes at a time and the scalar loop does the rest
+    // The scalar loops give the exact same results as the SSE2 ones
+
+    // bob, the average of the line above and below
+    static void bob_row(uint8_t *dst, const uint8_t *above, const uint8_t *below, int width)
+    {
+        int x{0};
+
+#ifdef __SSE2__
+        for(; x + 16 <= width; x += 16)
+        {
+            __m128i a{_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x))};
+            __m128i b{_mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x))};
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_avg_epu8(a, b));
+        }
+#endif
+
+        for(; x < width; ++x)
+        {
+            dst[x] = static_cast<uint8_t>((above[x] + below[x] + 1) >> 1);
+        }
+    }
+
+#ifdef __SSE2__
+    static inline __m128i absolute_difference(__m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    }
+#endif
+
+    // adaptive, the spatial prediction (bob) is clamped to a range around the temporal prediction
+    // the range is as wide as the motion between this frame and the previous one, so still areas keep the woven line
+    // and moving areas get the interpolated line
+    static void adaptive_row(uint8_t *dst,
+                             const uint8_t *above, const uint8_t *below, const uint8_t *current,
+                             const uint8_t *previous_above, const uint8_t *previous_below, const uint8_t *previous,
+                             int width)
+    {
+        int x{0};
+
+#ifdef __SSE2__
+        const __m128i zero{_mm_setzero_si128()};
+
+        for(; x + 16 <= width; x += 16)
+        {
+            __m128i a{_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x))};
+            __m128i b{_mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x))};
+            __m128i c{_mm_loadu_si128(reinterpret_cast<const __m128i*>(current + x))};
+            __m128i pa{_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous_above + x))};
+            __m128i pb{_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous_below + x))};
+            __m128i pc{_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + x))};
+
+            __m128i spatial{_mm_avg_epu8(a, b)};
+            __m128i temporal{_mm_avg_epu8(c, pc)};
+
+            __m128i line_motion{_mm_avg_epu8(absolute_difference(c, pc), zero)};
+            __m128i field_motion{_mm_avg_epu8(absolute_difference(a, pa), absolute_difference(b, pb))};
+            __m128i motion{_mm_max_epu8(line_motion, field_motion)};
+
+            __m128i low{_mm_subs_epu8(temporal, motion)};
+            __m128i high{_mm_adds_epu8(temporal, motion)};
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_min_epu8(_mm_max_epu8(spatial, low), high));
+        }
+#endif
+
+        for(; x < width; ++x)
+        {
+            int spatial{(above[x] + below[x] + 1) >> 1};
+            int temporal{(current[x] + previous[x] + 1) >> 1};
+
+            int line_motion{(std::abs(current[x] - previous[x]) + 1) >> 1};
+            int field_motion{(std::abs(above[x] - previous_above[x]) + std::abs(below[x] - previous_below[x]) + 1) >> 1};
+            int motion{std::max(line_motion, field_motion)};
+
+            int low{std::max(temporal - motion, 0)};
+            int high{std::min(temporal + motion, 255)};
+
+            dst[x] = static_cast<uint8_t>(std::min(std::max(spatial, low), high));
+        }
+    }
+
+    // Deinterlacer class start //
+
+    // Constructor
+    // Parameter mode - the deinterlacing mode to use
+    // Parameter thread_pool - the threads to split the work across
+    Deinterlacer::Deinterlacer(Deinterlace_Mode mode, Utility::Thread_Pool &thread_pool) :
+        m_mode{mode}, m_thread_pool{thread_pool}, m_previous{av_frame_alloc()}
+    {}
+
+    // Destructor
+    Deinterlacer::~Deinterlacer()
+    {
+        if(m_previous)
+        {
+            av_frame_free(&m_previous);
+        }
+    }
+
+    // checks if the pixel format can be deinterlaced, every component has to be 8 bits
+    bool Deinterlacer::supported(enum AVPixelFormat pixel_format)
+    {
+        const AVPixFmtDescriptor *descriptor{av_pix_fmt_desc_get(pixel_format)};
+
+        if(!descriptor || (descriptor->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL)))
+        {
+            return false;
+        }
+
+        for(int i{0}; i != descriptor->nb_components; ++i)
+        {
+            if(descriptor->comp[i].depth != 8)
+            {
+                return false;
+            }
+        }
+
+        return descriptor->nb_components > 0;
+    }
+
+    /* process function
+     * Description: deinterlaces the source frame into the destination frame
+     * Parameter: source - the interlaced frame
+     * Parameter: destination - the output frame, same pixel format and size as source
+     * Parameter: top_field_first - true to keep the top field, false to keep the bottom field
+     * Return: negative value on failure, a value >= 0 on success
+     */
+    int Deinterlacer::process(const AVFrame *source, AVFrame *destination, bool top_field_first)
+    {
+        enum AVPixelFormat pixel_format{static_cast<enum AVPixelFormat>(source->format)};
+        const AVPixFmtDescriptor *descriptor{av_pix_fmt_desc_get(pixel_format)};
+
+        if(!descriptor || !m_previous)
+        {
+            return -1;
+        }
+
+        int plane_widths[4]{0, 0, 0, 0};
+        int error{av_image_fill_linesizes(plane_widths, pixel_format, source->width)};
+        if(error < 0)
+        {
+            return error;
+        }
+
+        int plane_count{av_pix_fmt_count_planes(pixel_format)};
+        int plane_heights[4];
+
+        for(int i{0}; i != plane_count; ++i)
+        {
+            // planes 1 and 2 are the subsampled chroma planes, the alpha plane has full height
+            bool chroma_plane{(i == 1 || i == 2) && !(descriptor->flags & AV_PIX_FMT_FLAG_RGB)};
+            plane_heights[i] = chroma_plane ? -((-source->height) >> descriptor->log2_chroma_h) : source->height;
+        }
+
+        // adaptive mode needs a previous frame with the same layout, otherwise bob is used for this frame
+        bool use_previous{m_mode == DEINTERLACE_ADAPTIVE &&
+                          m_previous->buf[0] &&
+                          m_previous->format == source->format &&
+                          m_previous->width == source->width &&
+                          m_previous->height == source->height};
+
+        // lines with this parity are kept
+        int kept_parity{top_field_first ? 0 : 1};
+
+        int band_count{m_thread_pool.thread_count()};
+
+        std::function<void(int)> task{[&](int task_index)
+        {
+            int plane{task_index / band_count};
+            int band{task_index % band_count};
+
+            int height{plane_heights[plane]};
+            int width{plane_widths[plane]};
+
+            int first_row{height * band / band_count};
+            int last_row{height * (band + 1) / band_count};
+
+            const uint8_t *src{source->data[plane]};
+            int src_linesize{source->linesize[plane]};
+
+            uint8_t *dst{destination->data[plane]};
+            int dst_linesize{destination->linesize[plane]};
+
+            for(int y{first_row}; y < last_row; ++y)
+            {
+                uint8_t *dst_row{dst + static_cast<std::ptrdiff_t>(y) * dst_linesize};
+
+                if((y & 1) == kept_parity || height < 2)
+                {
+                    std::memcpy(dst_row, src + static_cast<std::ptrdiff_t>(y) * src_linesize, width);
+                    continue;
+                }
+
+                // the lines above and below always belong to the kept field, mirrored at the edges
+                int above{y > 0 ? y - 1 : y + 1};
+                int below{y + 1 < height ? y + 1 : y - 1};
+
+                const uint8_t *above_row{src + static_cast<std::ptrdiff_t>(above) * src_linesize};
+                const uint8_t *below_row{src + static_cast<std::ptrdiff_t>(below) * src_linesize};
+
+                if(!use_previous)
+                {
+                    bob_row(dst_row, above_row, below_row, width);
+                    continue;
+                }
+
+                const uint8_t *previous{m_previous->data[plane]};
+                int previous_linesize{m_previous->linesize[plane]};
+
+                adaptive_row(dst_row,
+                             above_row,
+                             below_row,
+                             src + static_cast<std::ptrdiff_t>(y) * src_linesize,
+                             previous + static_cast<std::ptrdiff_t>(above) * previous_linesize,
+                             previous + static_cast<std::ptrdiff_t>(below) * previous_linesize,
+                             previous + static_cast<std::ptrdiff_t>(y) * previous_linesize,
+                             width);
+            }
+        }};
+
+        m_thread_pool.run(plane_count * band_count, task);
+
+        destination->pts = source->pts;
+
+        // keep a reference to the source for the next frame
+        if(m_mode == DEINTERLACE_ADAPTIVE)
+        {
+            av_frame_unref(m_previous);
+
+            error = av_frame_ref(m_previous, source);
+            if(error < 0)
+            {
+                return error;
+            }
+        }
+
+        return 0;
+    }
+
+    // getters //
+    Deinterlace_Mode Deinterlacer::mode() const { return m_mode; }
+
+    // Deinterlacer class end //
+}
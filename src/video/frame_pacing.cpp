@@ -0,0 +1,172 @@
+#include <video/frame_pacing.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace Video
+{
+    const double Frame_Pacing::HISTOGRAM_BOUNDS[HISTOGRAM_BUCKETS - 1]{0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 33.0};
+
+    // 2000 buckets of 0.05 ms cover up to 100 ms, anything worse is a dropped frame, not a percentile worth resolving
+    const double Frame_Pacing::PERCENTILE_RESOLUTION{0.05};
+
+    /* percentile function
+     * Description: gets the value at the given percentile from fixed width buckets, the middle of the bucket it falls in
+     * Parameter: buckets - the number of values in each bucket
+     * Parameter: bucket_count - the number of buckets
+     * Parameter: count - the number of values
+     * Parameter: fraction - the percentile, 0.5 for the median
+     * Parameter: resolution - width of a bucket
+     * Parameter: max - the largest value, given for a percentile in the last, open ended, bucket
+     */
+    static double percentile(const long *buckets, int bucket_count, long count, double fraction, double resolution, double max)
+    {
+        if(count == 0)
+        {
+            return 0.0;
+        }
+
+        long rank{static_cast<long>(fraction * (count - 1) + 0.5)};
+        long seen{0};
+
+        for(int i{0}; i != bucket_count - 1; ++i)
+        {
+            seen += buckets[i];
+
+            if(seen > rank)
+            {
+                return std::min((i + 0.5) * resolution, max);
+            }
+        }
+
+        return max;
+    }
+
+    // Constructor
+    Frame_Pacing::Frame_Pacing() :
+        m_refresh_interval{0.0}, m_frames{0}, m_first_present_time{0.0}, m_first_frame_time{0.0}, m_last_present_time{0.0}, m_last_frame_time{0.0},
+        m_deviation_count{0}, m_percentile_buckets{}, m_max_deviation{0.0}, m_histogram{}, m_repeated_vsyncs{0}, m_skipped_vsyncs{0}, m_vsync_slip{0}, m_max_av_offset{0.0}
+    {}
+
+    // sets the display refresh interval in seconds, 0 if vsync isn't used, then no vsyncs are counted
+    void Frame_Pacing::set_refresh_interval(double refresh_interval)
+    {
+        m_refresh_interval = refresh_interval;
+    }
+
+    /* record function
+     * Description: records a present
+     * Parameter: present_time - when the frame was presented, on the playback clock in seconds, time spent paused doesn't count
+     * Parameter: frame_time - the frame's pts in seconds
+     */
+    void Frame_Pacing::record(double present_time, double frame_time)
+    {
+        double av_offset{present_time - frame_time};
+
+        if(std::abs(av_offset) > std::abs(m_max_av_offset))
+        {
+            m_max_av_offset = av_offset;
+        }
+
+        if(m_frames == 0)
+        {
+            m_first_present_time = present_time;
+            m_first_frame_time = frame_time;
+        }
+
+        // frames with broken timestamps can't be compared with the previous one
+        else if(frame_time > m_last_frame_time)
+        {
+            double present_interval{present_time - m_last_present_time};
+            double frame_interval{frame_time - m_last_frame_time};
+            double deviation{std::abs(present_interval - frame_interval)};
+
+            int percentile_bucket{static_cast<int>(std::min(deviation * 1000.0 / PERCENTILE_RESOLUTION, static_cast<double>(PERCENTILE_BUCKETS - 1)))};
+
+            m_percentile_buckets[percentile_bucket]++;
+            m_deviation_count++;
+            m_max_deviation = std::max(m_max_deviation, deviation * 1000.0);
+
+            int bucket{0};
+            while(bucket != HISTOGRAM_BUCKETS - 1 && deviation * 1000.0 >= HISTOGRAM_BOUNDS[bucket])
+            {
+                bucket++;
+            }
+
+            m_histogram[bucket]++;
+
+            // vsyncs are counted from the first frame. When the frame time falls between two vsyncs either one is fine,
+            // so a cadence like 3:2 pulldown isn't counted as repeats and skips. Once a slip is counted the count starts from it
+            if(m_refresh_interval > 0.0)
+            {
+                long presented_vsyncs{std::lround((present_time - m_first_present_time) / m_refresh_interval) - m_vsync_slip};
+                double expected_vsyncs{(frame_time - m_first_frame_time) / m_refresh_interval};
+
+                long earliest_vsync{static_cast<long>(std::floor(expected_vsyncs + 0.01))};
+                long latest_vsync{static_cast<long>(std::ceil(expected_vsyncs - 0.01))};
+
+                if(presented_vsyncs > latest_vsync)
+                {
+                    m_repeated_vsyncs += presented_vsyncs - latest_vsync;
+                    m_vsync_slip += presented_vsyncs - latest_vsync;
+                }
+
+                else if(presented_vsyncs < earliest_vsync)
+                {
+                    m_skipped_vsyncs += earliest_vsync - presented_vsyncs;
+                    m_vsync_slip -= earliest_vsync - presented_vsyncs;
+                }
+            }
+        }
+
+        m_last_present_time = present_time;
+        m_last_frame_time = frame_time;
+        m_frames++;
+    }
+
+    // prints the statistics gathered so far
+    void Frame_Pacing::print() const
+    {
+        if(m_frames == 0)
+        {
+            return;
+        }
+
+        // in milliseconds, to within PERCENTILE_RESOLUTION
+        double p50{percentile(m_percentile_buckets, PERCENTILE_BUCKETS, m_deviation_count, 0.50, PERCENTILE_RESOLUTION, m_max_deviation)};
+        double p99{percentile(m_percentile_buckets, PERCENTILE_BUCKETS, m_deviation_count, 0.99, PERCENTILE_RESOLUTION, m_max_deviation)};
+
+        std::cout << "Frame pacing: " << m_frames << " frames"
+                  << ", deviation from pts p50 " << p50 << " ms"
+                  << ", p99 " << p99 << " ms"
+                  << ", max " << m_max_deviation << " ms"
+                  << ", max A/V offset " << m_max_av_offset * 1000.0 << " ms";
+
+        if(m_refresh_interval > 0.0)
+        {
+            std::cout << ", repeated vsyncs " << m_repeated_vsyncs
+                      << ", skipped vsyncs " << m_skipped_vsyncs;
+        }
+
+        std::cout << std::endl << "Deviation histogram:";
+
+        for(int i{0}; i != HISTOGRAM_BUCKETS; ++i)
+        {
+            if(i == HISTOGRAM_BUCKETS - 1)
+            {
+                std::cout << " >" << HISTOGRAM_BOUNDS[i - 1] << " ms: " << m_histogram[i];
+            }
+
+            else
+            {
+                std::cout << " <" << HISTOGRAM_BOUNDS[i] << " ms: " << m_histogram[i] << ",";
+            }
+        }
+
+        std::cout << std::endl;
+    }
+
+    // getters //
+    int Frame_Pacing::frames() const { return m_frames; }
+}
@@ -0,0 +1,108 @@
+#include <video/frame_timing.h>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+#include <libavutil/rational.h>
+}
+
+#include <cstdint>
+
+namespace Video
+{
+    // used if the stream has neither an average nor a real frame rate
+    static const AVRational FALLBACK_FRAME_RATE{25, 1};
+
+    static bool valid_rate(AVRational rate)
+    {
+        return rate.num > 0 && rate.den > 0;
+    }
+
+    // Constructor
+    // Parameter stream - the video stream, its timebase and frame rates are used
+    Frame_Timing::Frame_Timing(const AVStream *stream) :
+        m_time_base{stream->time_base}, m_frame_rate{FALLBACK_FRAME_RATE}, m_last_timestamp{AV_NOPTS_VALUE}, m_last_interval{0},
+        m_anchor_timestamp{0}, m_frames_since_anchor{0}, m_estimated_timestamps{0}
+    {
+        if(valid_rate(stream->avg_frame_rate))
+        {
+            m_frame_rate = stream->avg_frame_rate;
+        }
+
+        else if(valid_rate(stream->r_frame_rate))
+        {
+            m_frame_rate = stream->r_frame_rate;
+        }
+    }
+
+    /* timestamp function
+     * Description: gets the frame's timestamp, or estimates one. Frames have to be passed in the order they are presented
+     * Parameter: frame - a decoded frame
+     * Return: the timestamp in the stream's timebase, always later than the previous one
+     */
+    int64_t Frame_Timing::timestamp(const AVFrame *frame)
+    {
+        int64_t timestamp{frame->best_effort_timestamp};
+
+        if(timestamp != AV_NOPTS_VALUE && (m_last_timestamp == AV_NOPTS_VALUE || timestamp > m_last_timestamp))
+        {
+            // only intervals between two real timestamps are trusted for estimates
+            if(m_last_timestamp != AV_NOPTS_VALUE && m_frames_since_anchor == 0)
+            {
+                m_last_interval = timestamp - m_last_timestamp;
+            }
+
+            m_anchor_timestamp = timestamp;
+            m_frames_since_anchor = 0;
+            m_last_timestamp = timestamp;
+
+            return timestamp;
+        }
+
+        m_estimated_timestamps++;
+
+        // the stream starts without a timestamp
+        if(m_last_timestamp == AV_NOPTS_VALUE)
+        {
+            m_anchor_timestamp = 0;
+            m_frames_since_anchor = 0;
+            m_last_timestamp = 0;
+
+            return 0;
+        }
+
+        int64_t duration{frame->pkt_duration > 0 ? frame->pkt_duration : m_last_interval};
+
+        if(duration > 0)
+        {
+            timestamp = m_last_timestamp + duration;
+
+            m_anchor_timestamp = timestamp;
+            m_frames_since_anchor = 0;
+        }
+
+        // a whole number of frame periods after the anchor, rescaled in one step, so rounding doesn't add up
+        else
+        {
+            m_frames_since_anchor++;
+            timestamp = m_anchor_timestamp + av_rescale_q(m_frames_since_anchor, av_inv_q(m_frame_rate), m_time_base);
+
+            if(timestamp <= m_last_timestamp)
+            {
+                timestamp = m_last_timestamp + 1;
+            }
+        }
+
+        m_last_timestamp = timestamp;
+
+        return timestamp;
+    }
+
+    // getters //
+    double Frame_Timing::frame_rate() const { return av_q2d(m_frame_rate); }
+    double Frame_Timing::frame_duration() const { return av_q2d(av_inv_q(m_frame_rate)); }
+    double Frame_Timing::timebase() const { return av_q2d(m_time_base); }
+    int Frame_Timing::estimated_timestamps() const { return m_estimated_timestamps; }
+}
@@ -0,0 +1,124 @@
+#include <video/master_clock.h>
+#include <portaudio/portaudio.h>
+
+#include <mutex>
+#include <chrono>
+
+namespace Video
+{
+    // Constructor
+    Master_Clock::Master_Clock() :
+        m_mutex{}, m_audio{nullptr}, m_audio_start_time{0.0},
+        m_wall_start{std::chrono::steady_clock::now()}, m_wall_start_time{0.0},
+        m_paused{false}, m_pause_start{}
+    {}
+
+    /* start function
+     * Description: starts the steady clock now, at the given time
+     * Parameter: media_time - the playback time now, usually the first frame's time in seconds
+     */
+    void Master_Clock::start(double media_time)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        m_wall_start = std::chrono::steady_clock::now();
+        m_wall_start_time = media_time;
+        m_paused = false;
+    }
+
+    /* set_audio_source function
+     * Description: makes the audio output the master, the playback stays valid until clear_audio_source() is called
+     * Parameter: audio - the started audio playback
+     * Parameter: start_time - the time of the first audio frame written to it, in seconds
+     */
+    void Master_Clock::set_audio_source(const PortAudio::Stream_Playback *audio, double start_time)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        m_audio = audio;
+        m_audio_start_time = start_time;
+    }
+
+    // goes back to the steady clock, it continues from the last audio time
+    void Master_Clock::clear_audio_source()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if(m_audio)
+        {
+            m_wall_start = std::chrono::steady_clock::now();
+            m_wall_start_time = m_audio_start_time + m_audio->played_time();
+
+            if(m_paused)
+            {
+                m_pause_start = m_wall_start;
+            }
+
+            m_audio = nullptr;
+        }
+    }
+
+    // stops the steady clock until resumed
+    void Master_Clock::pause()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if(!m_paused)
+        {
+            m_paused = true;
+            m_pause_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    // lets the steady clock run again, from where it was paused
+    void Master_Clock::resume()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if(m_paused)
+        {
+            m_paused = false;
+            m_wall_start += std::chrono::steady_clock::now() - m_pause_start;
+        }
+    }
+
+    /* time function
+     * Description: gets the playback time
+     * Return: the playback time in seconds, on the streams' timeline
+     */
+    double Master_Clock::time()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        auto now{std::chrono::steady_clock::now()};
+
+        if(m_audio)
+        {
+            double audio_time{m_audio_start_time + m_audio->played_time()};
+
+            // so the steady clock takes over from here if the audio goes away
+            m_wall_start = m_paused ? m_pause_start : now;
+            m_wall_start_time = audio_time;
+
+            return audio_time;
+        }
+
+        return wall_time(now);
+    }
+
+    // gets if the audio output is the master
+    bool Master_Clock::audio_master()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        return m_audio != nullptr;
+    }
+
+    // gets the steady clock's time at the given point in time, the mutex must be held
+    double Master_Clock::wall_time(std::chrono::steady_clock::time_point now) const
+    {
+        std::chrono::duration<double> elapsed{(m_paused ? m_pause_start : now) - m_wall_start};
+
+        return m_wall_start_time + elapsed.count();
+    }
+}
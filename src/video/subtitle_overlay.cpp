@@ -0,0 +1,166 @@
+#include <video/subtitle_overlay.h>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+}
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+#include <limits>
+
+namespace Video
+{
+    // Constructor
+    Subtitle_Overlay::Subtitle_Overlay() :
+        m_mutex{}, m_canvas_width{0}, m_canvas_height{0}, m_pending{}, m_current{}, m_showing{false}, m_changes{0}
+    {}
+
+    // sets the resolution subtitle positions are relative to
+    void Subtitle_Overlay::set_canvas_size(int width, int height)
+    {
+        m_canvas_width = width;
+        m_canvas_height = height;
+    }
+
+    /* add function
+     * Description: composites the bitmap rectangles of a decoded subtitle into one ARGB image, and queues it to be shown
+     * Text subtitles and subtitles without a timestamp are ignored, a subtitle without bitmaps clears the screen when it starts
+     * Parameter: subtitle - a decoded subtitle, it isn't kept, the caller frees it
+     */
+    void Subtitle_Overlay::add(const AVSubtitle &subtitle)
+    {
+        if(subtitle.pts == AV_NOPTS_VALUE)
+        {
+            return;
+        }
+
+        Subtitle_Image image{};
+
+        double pts{static_cast<double>(subtitle.pts) / AV_TIME_BASE};
+        image.start_time = pts + subtitle.start_display_time / 1000.0;
+
+        // PGS and some DVB subtitles don't have an end time, they last until the next one
+        if(subtitle.end_display_time > subtitle.start_display_time && subtitle.end_display_time != UINT32_MAX)
+        {
+            image.end_time = pts + subtitle.end_display_time / 1000.0;
+        }
+
+        else
+        {
+            image.end_time = std::numeric_limits<double>::infinity();
+        }
+
+        // bounding box of all bitmap rectangles
+        int left{std::numeric_limits<int>::max()};
+        int top{std::numeric_limits<int>::max()};
+        int right{0};
+        int bottom{0};
+
+        for(unsigned int i{0}; i != subtitle.num_rects; ++i)
+        {
+            const AVSubtitleRect *rect{subtitle.rects[i]};
+
+            if(rect->type == SUBTITLE_BITMAP && rect->w > 0 && rect->h > 0)
+            {
+                left = std::min(left, rect->x);
+                top = std::min(top, rect->y);
+                right = std::max(right, rect->x + rect->w);
+                bottom = std::max(bottom, rect->y + rect->h);
+            }
+        }
+
+        if(right > left && bottom > top)
+        {
+            image.x = left;
+            image.y = top;
+            image.width = right - left;
+            image.height = bottom - top;
+            image.pixels.assign(static_cast<std::size_t>(image.width) * image.height, 0);
+
+            // the palette holds 32 bit ARGB colors, the image one palette index per byte
+            for(unsigned int i{0}; i != subtitle.num_rects; ++i)
+            {
+                const AVSubtitleRect *rect{subtitle.rects[i]};
+
+                if(rect->type != SUBTITLE_BITMAP || rect->w <= 0 || rect->h <= 0)
+                {
+                    continue;
+                }
+
+                const uint32_t *palette{reinterpret_cast<const uint32_t*>(rect->data[1])};
+
+                for(int y{0}; y != rect->h; ++y)
+                {
+                    const uint8_t *indices{rect->data[0] + y * rect->linesize[0]};
+                    uint32_t *destination{&image.pixels[static_cast<std::size_t>(rect->y - top + y) * image.width + (rect->x - left)]};
+
+                    for(int x{0}; x != rect->w; ++x)
+                    {
+                        destination[x] = indices[x] < rect->nb_colors ? palette[indices[x]] : 0;
+                    }
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        // usually already in order, subtitles are demuxed in the order they start
+        auto position{std::upper_bound(m_pending.begin(), m_pending.end(), image.start_time,
+                                       [](double time, const Subtitle_Image &pending) { return time < pending.start_time; })};
+
+        m_pending.insert(position, std::move(image));
+    }
+
+    /* update function
+     * Description: picks the subtitle to show at the given time, subtitles that have started replace the shown one
+     * Parameter: time - the time of the video frame about to be shown, on the stream's timeline in seconds
+     * Return: true if a different subtitle, or none instead of one, has to be shown from now on
+     */
+    bool Subtitle_Overlay::update(double time)
+    {
+        bool changed{false};
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+
+            while(!m_pending.empty() && m_pending.front().start_time <= time)
+            {
+                // replacing nothing with nothing isn't a change
+                changed = changed || m_showing || !m_pending.front().pixels.empty();
+
+                m_current = std::move(m_pending.front());
+                m_showing = !m_current.pixels.empty();
+                m_pending.pop_front();
+            }
+        }
+
+        if(m_showing && time >= m_current.end_time)
+        {
+            m_showing = false;
+            changed = true;
+        }
+
+        if(changed)
+        {
+            m_changes++;
+        }
+
+        return changed;
+    }
+
+    // gets the subtitle to show, nullptr if there is none
+    const Subtitle_Image *Subtitle_Overlay::current() const
+    {
+        return m_showing ? &m_current : nullptr;
+    }
+
+    // getters //
+    int Subtitle_Overlay::canvas_width() const { return m_canvas_width; }
+    int Subtitle_Overlay::canvas_height() const { return m_canvas_height; }
+    int Subtitle_Overlay::changes() const { return m_changes; }
+}
@@ -0,0 +1,718 @@
+#include <video/tonemap.h>
+#include <utility/thread_pool.h>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libavutil/mastering_display_metadata.h>
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+namespace Video
+{
+    // size of every lookup table
+    static const int TABLE_SIZE{4096};
+    static const float TABLE_MAX{static_cast<float>(TABLE_SIZE - 1)};
+
+    // SDR reference white in nits, HDR signals are scaled so this becomes 1.0
+    static const double REFERENCE_WHITE{203.0};
+
+    // peak brightness to assume when a frame doesn't say
+    static const double DEFAULT_PEAK{1000.0};
+
+    // BT.2020 primaries to BT.709 primaries, in linear light
+    static const float GAMUT_MATRIX[3][3]{{ 1.6605f, -0.5876f, -0.0728f},
+                                          {-0.1246f,  1.1329f, -0.0083f},
+                                          {-0.0182f, -0.1006f,  1.1187f}};
+
+    // get the command line name of a curve
+    std::string tone_map_curve_name(Tone_Map_Curve curve)
+    {
+        switch(curve)
+        {
+            case TONE_MAP_OFF:
+                return "off";
+
+            case TONE_MAP_HABLE:
+                return "hable";
+
+            case TONE_MAP_REINHARD:
+                return "reinhard";
+
+            case TONE_MAP_BT2390:
+            default:
+                return "bt2390";
+        }
+    }
+
+    // parse a command line name into a curve, returns false if the name is unknown
+    bool parse_tone_map_curve(const std::string &name, Tone_Map_Curve &curve)
+    {
+        for(int i{TONE_MAP_OFF}; i <= TONE_MAP_BT2390; ++i)
+        {
+            if(name == tone_map_curve_name(static_cast<Tone_Map_Curve>(i)))
+            {
+                curve = static_cast<Tone_Map_Curve>(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // checks if a frame holds HDR video, a PQ or HLG transfer function
+    bool hdr_frame(const AVFrame *frame)
+    {
+        return frame->color_trc == AVCOL_TRC_SMPTE2084 ||
+               frame->color_trc == AVCOL_TRC_ARIB_STD_B67;
+    }
+
+    // Transfer functions //
+
+    // PQ signal [0, 1] -> nits
+    static double pq_to_nits(double signal)
+    {
+        const double m1{2610.0 / 16384.0};
+        const double m2{2523.0 / 4096.0 * 128.0};
+        const double c1{3424.0 / 4096.0};
+        const double c2{2413.0 / 4096.0 * 32.0};
+        const double c3{2392.0 / 4096.0 * 32.0};
+
+        double power{std::pow(signal, 1.0 / m2)};
+        return 10000.0 * std::pow(std::max(power - c1, 0.0) / (c2 - c3 * power), 1.0 / m1);
+    }
+
+    // nits -> PQ signal [0, 1]
+    static double nits_to_pq(double nits)
+    {
+        const double m1{2610.0 / 16384.0};
+        const double m2{2523.0 / 4096.0 * 128.0};
+        const double c1{3424.0 / 4096.0};
+        const double c2{2413.0 / 4096.0 * 32.0};
+        const double c3{2392.0 / 4096.0 * 32.0};
+
+        double power{std::pow(std::max(nits, 0.0) / 10000.0, m1)};
+        return std::pow((c1 + c2 * power) / (1.0 + c3 * power), m2);
+    }
+
+    // HLG signal [0, 1] -> scene linear light [0, 1]
+    static double hlg_to_linear(double signal)
+    {
+        const double a{0.17883277};
+        const double b{1.0 - 4.0 * a};
+        const double c{0.5 - a * std::log(4.0 * a)};
+
+        if(signal <= 0.5)
+        {
+            return signal * signal / 3.0;
+        }
+
+        return (std::exp((signal - c) / a) + b) / 12.0;
+    }
+
+    // Tone mapping curves, x is linear light where 1.0 is SDR white, peak is the signal peak in the same unit //
+
+    static double hable(double x)
+    {
+        const double a{0.15}, b{0.50}, c{0.10}, d{0.20}, e{0.02}, f{0.30};
+        return (x * (a * x + c * b) + d * e) / (x * (a * x + b) + d * f) - e / f;
+    }
+
+    static double apply_curve(Tone_Map_Curve curve, double x, double peak)
+    {
+        switch(curve)
+        {
+            case TONE_MAP_HABLE:
+                return hable(x) / hable(peak);
+
+            case TONE_MAP_REINHARD:
+                // extended reinhard, peak maps to 1.0
+                return x * (1.0 + x / (peak * peak)) / (1.0 + x);
+
+            case TONE_MAP_BT2390:
+            {
+                // BT.2390 EETF, a hermite spline knee in the PQ domain
+                double source_peak{nits_to_pq(peak * REFERENCE_WHITE)};
+                double max_luminance{nits_to_pq(REFERENCE_WHITE) / source_peak};
+                double knee_start{1.5 * max_luminance - 0.5};
+
+                double signal{nits_to_pq(x * REFERENCE_WHITE) / source_peak};
+
+                if(signal > knee_start)
+                {
+                    double t{(signal - knee_start) / (1.0 - knee_start)};
+                    double t2{t * t};
+                    double t3{t2 * t};
+
+                    signal = (2.0 * t3 - 3.0 * t2 + 1.0) * knee_start +
+                             (t3 - 2.0 * t2 + t) * (1.0 - knee_start) +
+                             (-2.0 * t3 + 3.0 * t2) * max_luminance;
+                }
+
+                return pq_to_nits(signal * source_peak) / REFERENCE_WHITE;
+            }
+
+            case TONE_MAP_OFF:
+            default:
+                return std::min(x, 1.0);
+        }
+    }
+
+    // Tone_Mapper class start //
+
+    // Constructor
+    // Parameter curve - the tone mapping curve to use
+    // Parameter thread_pool - the threads to split the work across
+    Tone_Mapper::Tone_Mapper(Tone_Map_Curve curve, Utility::Thread_Pool &thread_pool) :
+        m_curve{curve}, m_thread_pool{thread_pool}, m_transfer{AVCOL_TRC_UNSPECIFIED},
+        m_peak{0.0}, m_signal_peak{1.0f}
+    {}
+
+    // checks if the pixel format can be tone mapped, 10 bit 4:2:0 planar or P010
+    bool Tone_Mapper::supported(enum AVPixelFormat pixel_format)
+    {
+        return pixel_format == AV_PIX_FMT_YUV420P10LE || pixel_format == AV_PIX_FMT_P010LE;
+    }
+
+    /* build_tables function
+     * Description: fills in every lookup table for a transfer function and peak brightness
+     * Parameter: transfer - the transfer function of the frames
+     * Parameter: peak - the peak brightness of the frames in nits
+     */
+    void Tone_Mapper::build_tables(enum AVColorTransferCharacteristic transfer, double peak)
+    {
+        m_transfer = transfer;
+        m_peak = peak;
+        m_signal_peak = static_cast<float>(peak / REFERENCE_WHITE);
+
+        m_linearize_table.resize(TABLE_SIZE);
+        m_hlg_gain_table.resize(TABLE_SIZE);
+        m_curve_table.resize(TABLE_SIZE);
+        m_gamma_table.resize(TABLE_SIZE);
+
+        for(int i{0}; i != TABLE_SIZE; ++i)
+        {
+            double position{i / static_cast<double>(TABLE_MAX)};
+
+            if(transfer == AVCOL_TRC_SMPTE2084)
+            {
+                m_linearize_table[i] = static_cast<float>(pq_to_nits(position) / REFERENCE_WHITE);
+            }
+
+            else
+            {
+                m_linearize_table[i] = static_cast<float>(hlg_to_linear(position));
+            }
+
+            // HLG OOTF, display light = peak * scene luminance ^ (gamma - 1) * scene light, gamma 1.2 at 1000 nits
+            double system_gamma{1.2 + 0.42 * std::log10(peak / 1000.0)};
+            m_hlg_gain_table[i] = static_cast<float>(peak / REFERENCE_WHITE * std::pow(std::max(position, 1e-6), system_gamma - 1.0));
+
+            // the curve table is spread over [0, signal peak] and holds curve(x) / x
+            double x{position * m_signal_peak};
+            m_curve_table[i] = (i == 0) ? 1.0f : static_cast<float>(apply_curve(m_curve, x, m_signal_peak) / x);
+
+            // the gamma table is indexed by the square root of linear light, for more precision in the shadows
+            m_gamma_table[i] = static_cast<float>(std::pow(position * position, 1.0 / 2.4));
+        }
+
+        m_curve_table[0] = m_curve_table[1];
+    }
+
+    // Block processing //
+    // Every 2x2 block of luma pixels shares one chroma sample, the block is converted as 4 lanes
+
+    // the values of one 2x2 block
+    struct Block
+    {
+        float luma[4];
+        float cb;
+        float cr;
+    };
+
+    struct Block_Output
+    {
+        float luma[4];
+        float cb;
+        float cr;
+    };
+
+    // settings shared by every block
+    struct Block_Parameters
+    {
+        float luma_scale;
+        float luma_offset;
+        float chroma_scale;
+
+        bool hlg;
+        bool bt2020;
+
+        float curve_position_scale;
+
+        const float *linearize_table;
+        const float *hlg_gain_table;
+        const float *curve_table;
+        const float *gamma_table;
+    };
+
+#ifdef __SSE2__
+    // looks up 4 table positions at once, position must already be clamped to the table
+    static inline __m128 lookup(const float *table, __m128 position)
+    {
+        alignas(16) int32_t index[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvtps_epi32(position));
+
+        return _mm_set_ps(table[index[3]], table[index[2]], table[index[1]], table[index[0]]);
+    }
+
+    // clamps value to [0, 1] and scales it to a table position
+    static inline __m128 table_position(__m128 value)
+    {
+        __m128 clamped{_mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f))};
+        return _mm_mul_ps(clamped, _mm_set1_ps(TABLE_MAX));
+    }
+
+    /* convert_pixels function
+     * Description: converts 4 pixels, each lane can be a pixel of any block
+     * Parameter: luma - luma in [0, 1023]
+     * Parameter: cb, cr - chroma already scaled, centered on 0
+     * Parameter: y - gets BT.709 luma in [0, 1]
+     * Parameter: blue_difference, red_difference - get B' - Y' and R' - Y', summed over a block for its chroma
+     */
+    static inline void convert_pixels(__m128 luma, __m128 cb, __m128 cr, const Block_Parameters &parameters,
+                                      __m128 &y, __m128 &blue_difference, __m128 &red_difference)
+    {
+        const __m128 zero{_mm_setzero_ps()};
+
+        luma = _mm_add_ps(_mm_mul_ps(luma, _mm_set1_ps(parameters.luma_scale)), _mm_set1_ps(parameters.luma_offset));
+
+        // BT.2020 non constant luminance YCbCr -> R'G'B'
+        __m128 r{_mm_add_ps(luma, _mm_mul_ps(cr, _mm_set1_ps(1.4746f)))};
+        __m128 g{_mm_sub_ps(luma, _mm_add_ps(_mm_mul_ps(cb, _mm_set1_ps(0.16455f)), _mm_mul_ps(cr, _mm_set1_ps(0.57135f))))};
+        __m128 b{_mm_add_ps(luma, _mm_mul_ps(cb, _mm_set1_ps(1.8814f)))};
+
+        // R'G'B' -> linear RGB
+        r = lookup(parameters.linearize_table, table_position(r));
+        g = lookup(parameters.linearize_table, table_position(g));
+        b = lookup(parameters.linearize_table, table_position(b));
+
+        if(parameters.hlg)
+        {
+            __m128 scene_luminance{_mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(0.2627f)),
+                                                         _mm_mul_ps(g, _mm_set1_ps(0.6780f))),
+                                                         _mm_mul_ps(b, _mm_set1_ps(0.0593f)))};
+
+            __m128 gain{lookup(parameters.hlg_gain_table, table_position(scene_luminance))};
+
+            r = _mm_mul_ps(r, gain);
+            g = _mm_mul_ps(g, gain);
+            b = _mm_mul_ps(b, gain);
+        }
+
+        // BT.2020 -> BT.709 primaries
+        if(parameters.bt2020)
+        {
+            __m128 r709{_mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(GAMUT_MATRIX[0][0])),
+                                              _mm_mul_ps(g, _mm_set1_ps(GAMUT_MATRIX[0][1]))),
+                                              _mm_mul_ps(b, _mm_set1_ps(GAMUT_MATRIX[0][2])))};
+
+            __m128 g709{_mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(GAMUT_MATRIX[1][0])),
+                                              _mm_mul_ps(g, _mm_set1_ps(GAMUT_MATRIX[1][1]))),
+                                              _mm_mul_ps(b, _mm_set1_ps(GAMUT_MATRIX[1][2])))};
+
+            __m128 b709{_mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(GAMUT_MATRIX[2][0])),
+                                              _mm_mul_ps(g, _mm_set1_ps(GAMUT_MATRIX[2][1]))),
+                                              _mm_mul_ps(b, _mm_set1_ps(GAMUT_MATRIX[2][2])))};
+
+            r = _mm_max_ps(r709, zero);
+            g = _mm_max_ps(g709, zero);
+            b = _mm_max_ps(b709, zero);
+        }
+
+        // tone map the brightest component, and scale the others the same, this keeps the hue
+        __m128 signal{_mm_max_ps(_mm_max_ps(r, g), b)};
+        __m128 curve_position{_mm_min_ps(_mm_mul_ps(signal, _mm_set1_ps(parameters.curve_position_scale)), _mm_set1_ps(TABLE_MAX))};
+        __m128 gain{lookup(parameters.curve_table, curve_position)};
+
+        // linear -> gamma encoded, the table is indexed by the square root
+        r = lookup(parameters.gamma_table, table_position(_mm_sqrt_ps(_mm_mul_ps(r, gain))));
+        g = lookup(parameters.gamma_table, table_position(_mm_sqrt_ps(_mm_mul_ps(g, gain))));
+        b = lookup(parameters.gamma_table, table_position(_mm_sqrt_ps(_mm_mul_ps(b, gain))));
+
+        // R'G'B' -> BT.709 Y'CbCr
+        y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(0.2126f)),
+                                  _mm_mul_ps(g, _mm_set1_ps(0.7152f))),
+                                  _mm_mul_ps(b, _mm_set1_ps(0.0722f)));
+
+        blue_difference = _mm_sub_ps(b, y);
+        red_difference = _mm_sub_ps(r, y);
+    }
+
+    // converts one block, the 4 pixels of the block are the 4 lanes. Used at the right edge of the frame
+    static void convert_block(const Block &block, const Block_Parameters &parameters, Block_Output &output)
+    {
+        __m128 cb{_mm_set1_ps(block.cb * parameters.chroma_scale)};
+        __m128 cr{_mm_set1_ps(block.cr * parameters.chroma_scale)};
+
+        __m128 y;
+        __m128 blue_difference;
+        __m128 red_difference;
+        convert_pixels(_mm_loadu_ps(block.luma), cb, cr, parameters, y, blue_difference, red_difference);
+
+        _mm_storeu_ps(output.luma, y);
+
+        alignas(16) float blue[4];
+        alignas(16) float red[4];
+        _mm_store_ps(blue, blue_difference);
+        _mm_store_ps(red, red_difference);
+
+        output.cb = (blue[0] + blue[1] + blue[2] + blue[3]) * 0.25f / 1.8556f;
+        output.cr = (red[0] + red[1] + red[2] + red[3]) * 0.25f / 1.5748f;
+    }
+
+    // converts values in [0, 1] to 8 bit limited range, truncated and saturated like limited_range()
+    static inline __m128i limited_range_epi32(__m128 value, float scale, float offset)
+    {
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(scale)), _mm_set1_ps(offset + 0.5f)));
+    }
+
+    // splits 8 16 bit luma samples into the even and odd columns, 4 floats each
+    static inline void load_luma(const uint16_t *row, __m128i shift, __m128 &even, __m128 &odd)
+    {
+        __m128i samples{_mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row)), shift)};
+
+        even = _mm_cvtepi32_ps(_mm_and_si128(samples, _mm_set1_epi32(0xFFFF)));
+        odd = _mm_cvtepi32_ps(_mm_srli_epi32(samples, 16));
+    }
+
+    // interleaves the even and odd columns of a row again and stores them as 8 pixels
+    static inline void store_luma(uint8_t *row, __m128 even, __m128 odd)
+    {
+        __m128i even_pixels{limited_range_epi32(even, 219.0f, 16.0f)};
+        __m128i odd_pixels{limited_range_epi32(odd, 219.0f, 16.0f)};
+
+        __m128i words{_mm_packs_epi32(_mm_unpacklo_epi32(even_pixels, odd_pixels), _mm_unpackhi_epi32(even_pixels, odd_pixels))};
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(row), _mm_packus_epi16(words, words));
+    }
+
+    // stores 4 chroma samples
+    static inline void store_chroma(uint8_t *row, __m128 value)
+    {
+        __m128i words{_mm_packs_epi32(limited_range_epi32(value, 224.0f, 128.0f), _mm_setzero_si128())};
+        int32_t bytes{_mm_cvtsi128_si32(_mm_packus_epi16(words, words))};
+
+        std::memcpy(row, &bytes, sizeof(bytes));
+    }
+
+    /* convert_blocks function
+     * Description: converts 4 blocks side by side, 8 columns of 2 rows, each lane is one block.
+     * Loading, the chroma average and storing stay in vectors, only the table lookups are done per lane
+     * Parameter: luma_row0, luma_row1 - the first luma sample of the 8 columns in both rows
+     * Parameter: cb, cr - the 4 blocks' chroma, centered on 0, not scaled yet
+     * Parameter: shift - how far the samples are shifted up, 6 for P010
+     */
+    static void convert_blocks(const uint16_t *luma_row0, const uint16_t *luma_row1, __m128 cb, __m128 cr, __m128i shift,
+                               const Block_Parameters &parameters,
+                               uint8_t *out_row0, uint8_t *out_row1, uint8_t *out_cb, uint8_t *out_cr)
+    {
+        cb = _mm_mul_ps(cb, _mm_set1_ps(parameters.chroma_scale));
+        cr = _mm_mul_ps(cr, _mm_set1_ps(parameters.chroma_scale));
+
+        __m128 luma[4];
+        load_luma(luma_row0, shift, luma[0], luma[1]);
+        load_luma(luma_row1, shift, luma[2], luma[3]);
+
+        __m128 y[4];
+        __m128 blue_sum{_mm_setzero_ps()};
+        __m128 red_sum{_mm_setzero_ps()};
+
+        for(int i{0}; i != 4; ++i)
+        {
+            __m128 blue_difference;
+            __m128 red_difference;
+            convert_pixels(luma[i], cb, cr, parameters, y[i], blue_difference, red_difference);
+
+            blue_sum = _mm_add_ps(blue_sum, blue_difference);
+            red_sum = _mm_add_ps(red_sum, red_difference);
+        }
+
+        store_luma(out_row0, y[0], y[1]);
+        store_luma(out_row1, y[2], y[3]);
+
+        store_chroma(out_cb, _mm_mul_ps(blue_sum, _mm_set1_ps(0.25f / 1.8556f)));
+        store_chroma(out_cr, _mm_mul_ps(red_sum, _mm_set1_ps(0.25f / 1.5748f)));
+    }
+
+#else
+
+    static inline float lookup(const float *table, float value)
+    {
+        return table[static_cast<int>(std::min(std::max(value, 0.0f), 1.0f) * TABLE_MAX + 0.5f)];
+    }
+
+    // scalar version of the SSE2 convert_block above
+    static void convert_block(const Block &block, const Block_Parameters &parameters, Block_Output &output)
+    {
+        float cb{block.cb * parameters.chroma_scale};
+        float cr{block.cr * parameters.chroma_scale};
+
+        output.cb = 0.0f;
+        output.cr = 0.0f;
+
+        for(int i{0}; i != 4; ++i)
+        {
+            float luma{block.luma[i] * parameters.luma_scale + parameters.luma_offset};
+
+            float r{lookup(parameters.linearize_table, luma + 1.4746f * cr)};
+            float g{lookup(parameters.linearize_table, luma - 0.16455f * cb - 0.57135f * cr)};
+            float b{lookup(parameters.linearize_table, luma + 1.8814f * cb)};
+
+            if(parameters.hlg)
+            {
+                float gain{lookup(parameters.hlg_gain_table, 0.2627f * r + 0.6780f * g + 0.0593f * b)};
+                r *= gain;
+                g *= gain;
+                b *= gain;
+            }
+
+            if(parameters.bt2020)
+            {
+                float r709{GAMUT_MATRIX[0][0] * r + GAMUT_MATRIX[0][1] * g + GAMUT_MATRIX[0][2] * b};
+                float g709{GAMUT_MATRIX[1][0] * r + GAMUT_MATRIX[1][1] * g + GAMUT_MATRIX[1][2] * b};
+                float b709{GAMUT_MATRIX[2][0] * r + GAMUT_MATRIX[2][1] * g + GAMUT_MATRIX[2][2] * b};
+
+                r = std::max(r709, 0.0f);
+                g = std::max(g709, 0.0f);
+                b = std::max(b709, 0.0f);
+            }
+
+            float signal{std::max(std::max(r, g), b)};
+            float gain{parameters.curve_table[static_cast<int>(std::min(signal * parameters.curve_position_scale, TABLE_MAX) + 0.5f)]};
+
+            r = lookup(parameters.gamma_table, std::sqrt(r * gain));
+            g = lookup(parameters.gamma_table, std::sqrt(g * gain));
+            b = lookup(parameters.gamma_table, std::sqrt(b * gain));
+
+            float y{0.2126f * r + 0.7152f * g + 0.0722f * b};
+
+            output.luma[i] = y;
+            output.cb += (b - y) * 0.25f / 1.8556f;
+            output.cr += (r - y) * 0.25f / 1.5748f;
+        }
+    }
+
+#endif
+
+    // converts a value in [0, 1] to an 8 bit limited range value
+    static inline uint8_t limited_range(float value, float scale, float offset)
+    {
+        int result{static_cast<int>(value * scale + offset + 0.5f)};
+        return static_cast<uint8_t>(std::min(std::max(result, 0), 255));
+    }
+
+    /* process_rows function
+     * Description: tone maps the rows of 2x2 blocks from first_block_row up to, not including, last_block_row
+     */
+    void Tone_Mapper::process_rows(const AVFrame *source, AVFrame *destination, int first_block_row, int last_block_row)
+    {
+        bool p010{source->format == AV_PIX_FMT_P010LE};
+        int shift{p010 ? 6 : 0};
+
+        Block_Parameters parameters;
+
+        // limited range: luma 64 - 940, chroma 64 - 960, full range uses all 10 bits
+        if(source->color_range == AVCOL_RANGE_JPEG)
+        {
+            parameters.luma_scale = 1.0f / 1023.0f;
+            parameters.luma_offset = 0.0f;
+            parameters.chroma_scale = 1.0f / 1023.0f;
+        }
+
+        else
+        {
+            parameters.luma_scale = 1.0f / 876.0f;
+            parameters.luma_offset = -64.0f / 876.0f;
+            parameters.chroma_scale = 1.0f / 896.0f;
+        }
+
+        parameters.hlg = (m_transfer == AVCOL_TRC_ARIB_STD_B67);
+        parameters.bt2020 = (source->color_primaries == AVCOL_PRI_BT2020 || source->color_primaries == AVCOL_PRI_UNSPECIFIED);
+        parameters.curve_position_scale = TABLE_MAX / m_signal_peak;
+        parameters.linearize_table = m_linearize_table.data();
+        parameters.hlg_gain_table = m_hlg_gain_table.data();
+        parameters.curve_table = m_curve_table.data();
+        parameters.gamma_table = m_gamma_table.data();
+
+        int width{source->width};
+        int height{source->height};
+
+        for(int block_row{first_block_row}; block_row < last_block_row; ++block_row)
+        {
+            int y0{block_row * 2};
+            int y1{std::min(y0 + 1, height - 1)};
+
+            const uint16_t *luma_row0{reinterpret_cast<const uint16_t*>(source->data[0] + static_cast<std::ptrdiff_t>(y0) * source->linesize[0])};
+            const uint16_t *luma_row1{reinterpret_cast<const uint16_t*>(source->data[0] + static_cast<std::ptrdiff_t>(y1) * source->linesize[0])};
+
+            const uint16_t *cb_row{reinterpret_cast<const uint16_t*>(source->data[1] + static_cast<std::ptrdiff_t>(block_row) * source->linesize[1])};
+            const uint16_t *cr_row{p010 ? cb_row : reinterpret_cast<const uint16_t*>(source->data[2] + static_cast<std::ptrdiff_t>(block_row) * source->linesize[2])};
+
+            uint8_t *out_row0{destination->data[0] + static_cast<std::ptrdiff_t>(y0) * destination->linesize[0]};
+            uint8_t *out_row1{destination->data[0] + static_cast<std::ptrdiff_t>(y1) * destination->linesize[0]};
+            uint8_t *out_cb{destination->data[1] + static_cast<std::ptrdiff_t>(block_row) * destination->linesize[1]};
+            uint8_t *out_cr{destination->data[2] + static_cast<std::ptrdiff_t>(block_row) * destination->linesize[2]};
+
+            int x0{0};
+
+#ifdef __SSE2__
+            // 4 blocks at a time, as long as all 8 columns are inside the frame
+            __m128i sample_shift{_mm_cvtsi32_si128(shift)};
+
+            for(; x0 + 8 <= width; x0 += 8)
+            {
+                int chroma_x{x0 / 2};
+
+                __m128i cb_samples;
+                __m128i cr_samples;
+
+                if(p010)
+                {
+                    // 4 interleaved Cb Cr pairs
+                    __m128i pairs{_mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cb_row + chroma_x * 2)), sample_shift)};
+
+                    cb_samples = _mm_and_si128(pairs, _mm_set1_epi32(0xFFFF));
+                    cr_samples = _mm_srli_epi32(pairs, 16);
+                }
+
+                else
+                {
+                    cb_samples = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb_row + chroma_x)), _mm_setzero_si128());
+                    cr_samples = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr_row + chroma_x)), _mm_setzero_si128());
+                }
+
+                __m128 cb{_mm_cvtepi32_ps(_mm_sub_epi32(cb_samples, _mm_set1_epi32(512)))};
+                __m128 cr{_mm_cvtepi32_ps(_mm_sub_epi32(cr_samples, _mm_set1_epi32(512)))};
+
+                convert_blocks(luma_row0 + x0, luma_row1 + x0, cb, cr, sample_shift, parameters,
+                               out_row0 + x0, out_row1 + x0, out_cb + chroma_x, out_cr + chroma_x);
+            }
+#endif
+
+            // the blocks left at the right edge, one at a time
+            for(; x0 < width; x0 += 2)
+            {
+                int x1{std::min(x0 + 1, width - 1)};
+                int chroma_x{x0 / 2};
+
+                Block block;
+                block.luma[0] = luma_row0[x0] >> shift;
+                block.luma[1] = luma_row0[x1] >> shift;
+                block.luma[2] = luma_row1[x0] >> shift;
+                block.luma[3] = luma_row1[x1] >> shift;
+
+                if(p010)
+                {
+                    block.cb = static_cast<float>((cb_row[chroma_x * 2] >> shift) - 512);
+                    block.cr = static_cast<float>((cr_row[chroma_x * 2 + 1] >> shift) - 512);
+                }
+
+                else
+                {
+                    block.cb = static_cast<float>(cb_row[chroma_x] - 512);
+                    block.cr = static_cast<float>(cr_row[chroma_x] - 512);
+                }
+
+                Block_Output output;
+                convert_block(block, parameters, output);
+
+                out_row0[x0] = limited_range(output.luma[0], 219.0f, 16.0f);
+                out_row0[x1] = limited_range(output.luma[1], 219.0f, 16.0f);
+                out_row1[x0] = limited_range(output.luma[2], 219.0f, 16.0f);
+                out_row1[x1] = limited_range(output.luma[3], 219.0f, 16.0f);
+
+                out_cb[chroma_x] = limited_range(output.cb, 224.0f, 128.0f);
+                out_cr[chroma_x] = limited_range(output.cr, 224.0f, 128.0f);
+            }
+        }
+    }
+
+    /* process function
+     * Description: tone maps the source frame into the destination frame
+     * Parameter: source - a 10 bit HDR frame
+     * Parameter: destination - an allocated YUV420P frame with the same size as source
+     * Return: negative value on failure, a value >= 0 on success
+     */
+    int Tone_Mapper::process(const AVFrame *source, AVFrame *destination)
+    {
+        if(!supported(static_cast<enum AVPixelFormat>(source->format)) ||
+           destination->format != AV_PIX_FMT_YUV420P ||
+           destination->width != source->width ||
+           destination->height != source->height)
+        {
+            return -1;
+        }
+
+        // the peak brightness comes from the content light level, then the mastering display, otherwise it's a guess
+        double peak{DEFAULT_PEAK};
+
+        AVFrameSideData *side_data{av_frame_get_side_data(source, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL)};
+        if(side_data && reinterpret_cast<const AVContentLightMetadata*>(side_data->data)->MaxCLL > 0)
+        {
+            peak = reinterpret_cast<const AVContentLightMetadata*>(side_data->data)->MaxCLL;
+        }
+
+        else
+        {
+            side_data = av_frame_get_side_data(source, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+            if(side_data)
+            {
+                const AVMasteringDisplayMetadata *metadata{reinterpret_cast<const AVMasteringDisplayMetadata*>(side_data->data)};
+
+                if(metadata->has_luminance && metadata->max_luminance.den > 0)
+                {
+                    peak = av_q2d(metadata->max_luminance);
+                }
+            }
+        }
+
+        // HDR that is barely brighter than SDR doesn't need any tone mapping, but the tables still have to make sense
+        peak = std::max(peak, REFERENCE_WHITE);
+
+        if(source->color_trc != m_transfer || peak != m_peak)
+        {
+            build_tables(source->color_trc, peak);
+        }
+
+        int block_rows{(source->height + 1) / 2};
+        int band_count{std::min(m_thread_pool.thread_count() * 2, block_rows)};
+
+        std::function<void(int)> task{[&](int band)
+        {
+            process_rows(source, destination, block_rows * band / band_count, block_rows * (band + 1) / band_count);
+        }};
+
+        m_thread_pool.run(band_count, task);
+
+        destination->pts = source->pts;
+
+        return 0;
+    }
+
+    // getters //
+    Tone_Map_Curve Tone_Mapper::curve() const { return m_curve; }
+
+    // Tone_Mapper class end //
+}
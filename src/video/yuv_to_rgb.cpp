@@ -0,0 +1,194 @@
+#include <video/yuv_to_rgb.h>
+#include <utility/thread_pool.h>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+namespace Video
+{
+    // the coefficients are in 1/8192ths, the samples are shifted up by 5 bits before multiplying,
+    // and the high half of the 16 bit products leaves the result with 2 bits of fraction
+    static const double COEFFICIENT_SCALE{8192.0};
+    static const int SAMPLE_SHIFT{5};
+    static const int RESULT_SHIFT{2};
+
+    // Constructor
+    Yuv_To_Rgb::Yuv_To_Rgb(Utility::Thread_Pool &thread_pool) :
+        m_thread_pool{thread_pool}, m_colorspace{AVCOL_SPC_UNSPECIFIED}, m_range{AVCOL_RANGE_UNSPECIFIED}, m_height{-1},
+        m_luma_offset{0}, m_luma{0}, m_red_v{0}, m_green_u{0}, m_green_v{0}, m_blue_u{0}
+    {}
+
+    // checks if frames of this pixel format can be converted
+    bool Yuv_To_Rgb::supported(enum AVPixelFormat pixel_format)
+    {
+        return pixel_format == AV_PIX_FMT_YUV420P || pixel_format == AV_PIX_FMT_YUVJ420P;
+    }
+
+    // sets the coefficients up for the frame's matrix and range, unknown matrices are guessed from the frame height like most players do
+    void Yuv_To_Rgb::set_matrix(const AVFrame *frame)
+    {
+        m_colorspace = frame->colorspace;
+        m_range = frame->color_range;
+        m_height = frame->height;
+
+        bool bt709{frame->colorspace == AVCOL_SPC_BT709 || (frame->colorspace != AVCOL_SPC_BT470BG &&
+                                                           frame->colorspace != AVCOL_SPC_SMPTE170M &&
+                                                           frame->height >= 720)};
+        bool full_range{frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P};
+
+        double red_weight{bt709 ? 0.2126 : 0.299};
+        double blue_weight{bt709 ? 0.0722 : 0.114};
+        double green_weight{1.0 - red_weight - blue_weight};
+
+        double luma_scale{full_range ? 1.0 : 255.0 / 219.0};
+        double chroma_scale{full_range ? 1.0 : 255.0 / 224.0};
+
+        m_luma_offset = full_range ? 0 : 16;
+        m_luma = static_cast<int16_t>(std::lround(luma_scale * COEFFICIENT_SCALE));
+        m_red_v = static_cast<int16_t>(std::lround(2.0 * (1.0 - red_weight) * chroma_scale * COEFFICIENT_SCALE));
+        m_green_u = static_cast<int16_t>(std::lround(2.0 * (1.0 - blue_weight) * blue_weight / green_weight * chroma_scale * COEFFICIENT_SCALE));
+        m_green_v = static_cast<int16_t>(std::lround(2.0 * (1.0 - red_weight) * red_weight / green_weight * chroma_scale * COEFFICIENT_SCALE));
+        m_blue_u = static_cast<int16_t>(std::lround(2.0 * (1.0 - blue_weight) * chroma_scale * COEFFICIENT_SCALE));
+    }
+
+    // high half of a 16 bit product, like _mm_mulhi_epi16
+    static inline int multiply_high(int sample, int coefficient)
+    {
+        return (sample * coefficient) >> 16;
+    }
+
+    static inline uint8_t clamp_result(int value)
+    {
+        value = (value + (1 << (RESULT_SHIFT - 1))) >> RESULT_SHIFT;
+
+        return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+    }
+
+    /* process_rows function
+     * Description: converts the rows first_row up to last_row, the same fixed point math is used with and without SSE2
+     */
+    void Yuv_To_Rgb::process_rows(const AVFrame *source, uint8_t *pixels, int pitch, int first_row, int last_row)
+    {
+        int width{source->width};
+
+        for(int row{first_row}; row != last_row; ++row)
+        {
+            const uint8_t *y_row{source->data[0] + row * source->linesize[0]};
+            const uint8_t *u_row{source->data[1] + (row / 2) * source->linesize[1]};
+            const uint8_t *v_row{source->data[2] + (row / 2) * source->linesize[2]};
+            uint8_t *output{pixels + row * pitch};
+
+            int x{0};
+
+#ifdef __SSE2__
+            const __m128i zero{_mm_setzero_si128()};
+            const __m128i alpha{_mm_set1_epi8(static_cast<char>(0xFF))};
+            const __m128i luma_offset{_mm_set1_epi16(m_luma_offset)};
+            const __m128i chroma_offset{_mm_set1_epi16(128)};
+            const __m128i rounding{_mm_set1_epi16(1 << (RESULT_SHIFT - 1))};
+
+            const __m128i luma{_mm_set1_epi16(m_luma)};
+            const __m128i red_v{_mm_set1_epi16(m_red_v)};
+            const __m128i green_u{_mm_set1_epi16(m_green_u)};
+            const __m128i green_v{_mm_set1_epi16(m_green_v)};
+            const __m128i blue_u{_mm_set1_epi16(m_blue_u)};
+
+            // 8 pixels at a time, they share 4 chroma samples
+            for(; x + 8 <= width; x += 8)
+            {
+                int32_t u_samples;
+                int32_t v_samples;
+                std::memcpy(&u_samples, u_row + x / 2, sizeof(u_samples));
+                std::memcpy(&v_samples, v_row + x / 2, sizeof(v_samples));
+
+                __m128i y{_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y_row + x)), zero)};
+
+                // every chroma sample is used for two pixels next to each other
+                __m128i u{_mm_cvtsi32_si128(u_samples)};
+                __m128i v{_mm_cvtsi32_si128(v_samples)};
+                u = _mm_unpacklo_epi8(_mm_unpacklo_epi8(u, u), zero);
+                v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(v, v), zero);
+
+                y = _mm_slli_epi16(_mm_sub_epi16(y, luma_offset), SAMPLE_SHIFT);
+                u = _mm_slli_epi16(_mm_sub_epi16(u, chroma_offset), SAMPLE_SHIFT);
+                v = _mm_slli_epi16(_mm_sub_epi16(v, chroma_offset), SAMPLE_SHIFT);
+
+                y = _mm_add_epi16(_mm_mulhi_epi16(y, luma), rounding);
+
+                __m128i red{_mm_add_epi16(y, _mm_mulhi_epi16(v, red_v))};
+                __m128i green{_mm_sub_epi16(_mm_sub_epi16(y, _mm_mulhi_epi16(u, green_u)), _mm_mulhi_epi16(v, green_v))};
+                __m128i blue{_mm_add_epi16(y, _mm_mulhi_epi16(u, blue_u))};
+
+                // back to 8 bits, saturated
+                red = _mm_packus_epi16(_mm_srai_epi16(red, RESULT_SHIFT), zero);
+                green = _mm_packus_epi16(_mm_srai_epi16(green, RESULT_SHIFT), zero);
+                blue = _mm_packus_epi16(_mm_srai_epi16(blue, RESULT_SHIFT), zero);
+
+                // interleave into B G R X bytes
+                __m128i blue_green{_mm_unpacklo_epi8(blue, green)};
+                __m128i red_alpha{_mm_unpacklo_epi8(red, alpha)};
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 4), _mm_unpacklo_epi16(blue_green, red_alpha));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 4 + 16), _mm_unpackhi_epi16(blue_green, red_alpha));
+            }
+#endif
+
+            // whatever is left of the row, or the whole row without SSE2
+            for(; x != width; ++x)
+            {
+                int y{multiply_high((y_row[x] - m_luma_offset) << SAMPLE_SHIFT, m_luma)};
+                int u{(u_row[x / 2] - 128) << SAMPLE_SHIFT};
+                int v{(v_row[x / 2] - 128) << SAMPLE_SHIFT};
+
+                output[x * 4] = clamp_result(y + multiply_high(u, m_blue_u));
+                output[x * 4 + 1] = clamp_result(y - multiply_high(u, m_green_u) - multiply_high(v, m_green_v));
+                output[x * 4 + 2] = clamp_result(y + multiply_high(v, m_red_v));
+                output[x * 4 + 3] = 0xFF;
+            }
+        }
+    }
+
+    /* process function
+     * Description: converts the source frame into BGRX pixels
+     * Parameter: source - a YUV420P frame
+     * Parameter: pixels - the first output pixel, the top left corner of where the frame goes
+     * Parameter: pitch - bytes from one output row to the next
+     * Return: negative value on failure, a value >= 0 on success
+     */
+    int Yuv_To_Rgb::process(const AVFrame *source, uint8_t *pixels, int pitch)
+    {
+        if(!supported(static_cast<enum AVPixelFormat>(source->format)))
+        {
+            return -1;
+        }
+
+        if(source->colorspace != m_colorspace || source->color_range != m_range || source->height != m_height)
+        {
+            set_matrix(source);
+        }
+
+        int band_count{std::min(m_thread_pool.thread_count() * 2, source->height)};
+
+        std::function<void(int)> task{[&](int band)
+        {
+            process_rows(source, pixels, pitch, source->height * band / band_count, source->height * (band + 1) / band_count);
+        }};
+
+        m_thread_pool.run(band_count, task);
+
+        return 0;
+    }
+}